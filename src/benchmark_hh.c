@@ -18,10 +18,13 @@
 #include "hh/ktree.h"
 #include "hh/const_sketch.h"
 #include "hh/sketch.h"
+#include "hh/shared_sketch.h"
 #include "hh/cormode_cmh.h"
+#include "hh/cgt.h"
+#include "hh/adaptive.h"
 #include "util/xutil.h"
 
-#define AMOUNT_OF_IMPLEMENTATIONS 6
+#define AMOUNT_OF_IMPLEMENTATIONS 9
 #define IDX(STEP, x, y, z)  (z) + ((y) * (STEP)) + (N_EVENTS * (STEP) * (x))
 
 typedef enum {
@@ -31,6 +34,9 @@ typedef enum {
 	CORMODE,
 	KMIN,
 	KMEDIAN,
+	SHARED,
+	CGT,
+	ADAPTIVE,
 } hh_impl_t;
 
 typedef struct {
@@ -54,9 +60,18 @@ static void printusage(char *argv[]) {
             "\t[--cormode                {OPTIONAL} (Run HH with Cormode et al.'s Count Min Sketch)]\n"
             "\t[--kmin                   {OPTIONAL} (Run HH with k-tree using Count Min Sketch)]\n"
             "\t[--kmedian                {OPTIONAL} (Run HH with k-tree using Count Median Sketch)]\n"
+            "\t[--shared                 {OPTIONAL} (Run HH with one counter table shared by all layers)]\n"
+            "\t[--cgt                    {OPTIONAL} (Run HH with combinatorial group testing)]\n"
+            "\t[--adaptive               {OPTIONAL} (Run HH with the engine chosen from a sample of the stream)]\n"
             "\t[-1 --seed1    [uint32_t] {OPTIONAL} (First seed value)]\n"
             "\t[-2 --seed2    [uint32_t] {OPTIONAL} (Second seed value)]\n"
             "\t[-r --runs     [uint32_t] {OPTIONAL} (Amount of runs to average over)]\n"
+            "\t[-t --threads  [uint8_t]  {OPTIONAL} (Threads used by the k-tree query)]\n"
+            "\t[-g --gran     [uint8_t]  {OPTIONAL} (Bits of every k-tree layer, 0 chooses them by the caches)]\n"
+            "\t[-x --exact    [uint8_t]  {OPTIONAL} (Exactly counted layers, 0 uses the cache model)]\n"
+            "\t[-c --colocate            {OPTIONAL} (Place siblings in one block of the sketched rows)]\n"
+            "\t[-a --autosize            {OPTIONAL} (Size the sketched inner layers by their prefixes and phi)]\n"
+            "\t[-s --share    [double]   {OPTIONAL} (Size of the shared table relative to one table per layer)]\n"
             "\t[-h --help                {OPTIONAL} (Shows this guideline)]\n"
             , argv[0]);
 }
@@ -73,6 +88,11 @@ int main (int argc, char **argv) {
 	char     *output   = NULL;
 	uint64_t  buf_size = 0;
 	uint32_t  runs     = 5;
+	uint8_t   threads  = 0;
+	uint8_t   exact    = 0;
+	bool      colocate = false;
+	bool      autosize = false;
+	double    share    = 0.25;
 	bool      start    = true;
 
 	alg_t                   alg[AMOUNT_OF_IMPLEMENTATIONS];
@@ -86,12 +106,13 @@ int main (int argc, char **argv) {
 	double    phi      = 0.05;
 	uint32_t  m        = UINT32_MAX;
 	const uint8_t  b   = 4;
-	const uint8_t gran = 8;
+	uint8_t   gran     = 0;
+	uint8_t   grans[KTREE_LAYERS];
 
 	/* getopt */
 	int option_index = 0;
 	static int flag  = 0;
-	static const char *optstring = "1:2:e:d:p:m:f:o:r:h:w:i";
+	static const char *optstring = "1:2:e:d:p:m:f:o:r:t:g:x:h:w:icas:";
 	static const struct option long_options[] = {
 		{"min",            no_argument, &flag,     MIN },
 		{"median",         no_argument, &flag,  MEDIAN },
@@ -99,6 +120,9 @@ int main (int argc, char **argv) {
 		{"cormode",        no_argument, &flag, CORMODE },
 		{"kmin",           no_argument, &flag,    KMIN },
 		{"kmedian",        no_argument, &flag, KMEDIAN },
+		{"shared",         no_argument, &flag,  SHARED },
+		{"cgt",            no_argument, &flag,     CGT },
+		{"adaptive",       no_argument, &flag, ADAPTIVE },
 		{"epsilon",  required_argument,     0,      'e'},
 		{"delta",    required_argument,     0,      'd'},
 		{"phi",      required_argument,     0,      'p'},
@@ -106,6 +130,12 @@ int main (int argc, char **argv) {
 		{"file",     required_argument,     0,      'f'},
 		{"output",   required_argument,     0,      'o'},
 		{"runs",     required_argument,     0,      'r'},
+		{"threads",  required_argument,     0,      't'},
+		{"gran",     required_argument,     0,      'g'},
+		{"exact",    required_argument,     0,      'x'},
+		{"colocate",       no_argument,     0,      'c'},
+		{"autosize",       no_argument,     0,      'a'},
+		{"share",    required_argument,     0,      's'},
 		{"info",           no_argument,     0,      'i'},
         {"seed1",    required_argument,     0,      '1'},
         {"seed2",    required_argument,     0,      '2'},
@@ -141,6 +171,24 @@ int main (int argc, char **argv) {
 			case 'r':
 				runs    = strtol(optarg, NULL, 10);
 				break;
+			case 't':
+				threads = strtol(optarg, NULL, 10);
+				break;
+			case 'g':
+				gran    = strtol(optarg, NULL, 10);
+				break;
+			case 'x':
+				exact   = strtol(optarg, NULL, 10);
+				break;
+			case 'c':
+				colocate = true;
+				break;
+			case 'a':
+				autosize = true;
+				break;
+			case 's':
+				share    = strtod(optarg, NULL);
+				break;
 			case '1':
 				I1 = strtoll(optarg, NULL, 10);
 				break;
@@ -215,38 +263,71 @@ int main (int argc, char **argv) {
 		.phi     = phi,
 	};
 	hh_sketch_params_t params_min = {
-		.b       = b,
-		.epsilon = epsilon,
-		.delta   = delta,
-		.m       = m,
-		.phi     = phi,
-		.f       = &countMin,
+		.b        = b,
+		.epsilon  = epsilon,
+		.delta    = delta,
+		.m        = m,
+		.phi      = phi,
+		.exact    = exact,
+		.colocate = colocate,
+		.autosize = autosize,
+		.f        = &countMin,
+	};
+	hh_const_sketch_params_t params_const = {
+		.b        = b,
+		.epsilon  = epsilon,
+		.delta    = delta,
+		.m        = m,
+		.phi      = phi,
+		.exact    = exact,
+		.colocate = colocate,
+		.f        = &countMin,
+	};
+	hh_shared_sketch_params_t params_shared = {
+		.b        = b,
+		.epsilon  = epsilon,
+		.delta    = delta,
+		.m        = m,
+		.phi      = phi,
+		.exact    = exact,
+		.share    = share,
 	};
 	hh_sketch_params_t params_median = {
-		.b       = (b > 2) ? b : 4, // k = 4 is most space efficient
-		.epsilon = epsilon,
-		.delta   = delta,
-		.m       = m,
-		.phi     = phi,
-		.f       = &countMedian,
+		.b        = (b > 2) ? b : 4, // k = 4 is most space efficient
+		.epsilon  = epsilon,
+		.delta    = delta,
+		.m        = m,
+		.phi      = phi,
+		.exact    = exact,
+		.colocate = colocate,
+		.autosize = autosize,
+		.f        = &countMedian,
 	};
 	hh_ktree_params_t params_kmin = {
-		.b       = b,
-		.epsilon = epsilon,
-		.delta   = delta,
-		.m       = m,
-		.phi     = phi,
-		.gran    = gran,
-		.f       = &countMin,
+		.b        = b,
+		.epsilon  = epsilon,
+		.delta    = delta,
+		.m        = m,
+		.phi      = phi,
+		.gran     = gran,
+		.threads  = threads,
+		.exact    = exact,
+		.colocate = colocate,
+		.autosize = autosize,
+		.f        = &countMin,
 	};
 	hh_ktree_params_t params_kmedian = {
-		.b       = b,
-		.epsilon = epsilon,
-		.delta   = delta,
-		.m       = m,
-		.phi     = phi,
-		.gran    = gran,
-		.f       = &countMedian,
+		.b        = b,
+		.epsilon  = epsilon,
+		.delta    = delta,
+		.m        = m,
+		.phi      = phi,
+		.gran     = gran,
+		.threads  = threads,
+		.exact    = exact,
+		.colocate = colocate,
+		.autosize = autosize,
+		.f        = &countMedian,
 	};
 
 	heavy_hitter_params_t p_min = {
@@ -261,7 +342,7 @@ int main (int argc, char **argv) {
 	};
 	heavy_hitter_params_t p_const = {
 		.hash   = &multiplyShift,
-		.params = &params_min,
+		.params = &params_const,
 		.f      = &hh_const_sketch,
 	};
 	heavy_hitter_params_t p_cormode = {
@@ -269,11 +350,40 @@ int main (int argc, char **argv) {
 		.params = &params_cmh,
 		.f      = &hh_cormode_cmh,
 	};
+	hh_cgt_params_t params_cgt = {
+		.b       = b,
+		.epsilon = epsilon,
+		.delta   = delta,
+		.m       = m,
+		.phi     = phi,
+	};
+	heavy_hitter_params_t p_cgt = {
+		.hash   = &multiplyShift,
+		.params = &params_cgt,
+		.f      = &hh_cgt,
+	};
+	hh_adaptive_params_t params_adaptive = {
+		.b       = b,
+		.epsilon = epsilon,
+		.delta   = delta,
+		.m       = m,
+		.phi     = phi,
+	};
+	heavy_hitter_params_t p_adaptive = {
+		.hash   = &multiplyShift,
+		.params = &params_adaptive,
+		.f      = &hh_adaptive,
+	};
 	heavy_hitter_params_t p_kmin = {
 		.hash   = &multiplyShift,
 		.params = &params_kmin,
 		.f      = &hh_ktree,
 	};
+	heavy_hitter_params_t p_shared = {
+		.hash   = &multiplyShift,
+		.params = &params_shared,
+		.f      = &hh_shared_sketch,
+	};
 	heavy_hitter_params_t p_kmedian = {
 		.hash   = &multiplyShift,
 		.params = &params_kmedian,
@@ -303,6 +413,15 @@ int main (int argc, char **argv) {
 					case KMEDIAN:
 						params[IDX(runs, k, k2, k3)] = &p_kmedian;
 						break;
+					case SHARED:
+						params[IDX(runs, k, k2, k3)] = &p_shared;
+						break;
+					case CGT:
+						params[IDX(runs, k, k2, k3)] = &p_cgt;
+						break;
+					case ADAPTIVE:
+						params[IDX(runs, k, k2, k3)] = &p_adaptive;
+						break;
 					default:
 						free(output);
 						free(filename);
@@ -315,12 +434,15 @@ int main (int argc, char **argv) {
 			switch(alg[k].impl) {
 				case KMIN:
 				case KMEDIAN:
-					logm = floor(log((uint64_t)m)/log((1 << gran))+1);
-					depth = ceil(log((double)(((1 << gran)*logm)/(delta*phi)))/log(b));
+					logm = hh_ktree_granularity(&params_kmin, grans);
+					depth = ceil(log((double)(((1 << grans[logm-1])*logm)/(delta*phi)))/log(b));
 					break;
 				case CONST:
 					depth = ceil(log((double)(16./(pow(delta,2)*phi)))/log(b));
 					break;
+				case CGT:
+					depth = ceil(log((double)(1./(delta*phi)))/log(b));
+					break;
 				default:
 					depth = ceil(log((double)((2.*log2(m))/(delta*phi)))/log(b));
 			}
@@ -0,0 +1,410 @@
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "hh/hh.h"
+#include "hh/adaptive.h"
+#include "hh/cgt.h"
+#include "hh/ktree.h"
+#include "hh/sparse.h"
+#include "sketch/sketch.h"
+#include "util/table.h"
+#include "util/xutil.h"
+
+// Ranks the Zipf exponent is fitted to
+#define ADAPTIVE_RANKS 256
+
+static double hh_adaptive_now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static inline uint32_t hh_adaptive_sample_size(const hh_adaptive_t *restrict
+		hh) {
+	return (hh->params->sample > 0) ? hh->params->sample : 65536;
+}
+
+// Initialization
+hh_adaptive_t *hh_adaptive_create(heavy_hitter_params_t *restrict p) {
+	hh_adaptive_t *restrict hh = xmalloc( sizeof(hh_adaptive_t) );
+
+	hh->params   = (hh_adaptive_params_t *)p->params;
+	hh->hash     = p->hash;
+	hh->sample   = table_create(1024);
+	hh->engine   = NULL;
+	hh->slot     = 0;
+	hh->norm     = 0;
+	hh->seen     = 0;
+	hh->migrated = 0;
+	hh->start    = hh_adaptive_now();
+	memset(&hh->stats, '\0', sizeof(hh_adaptive_stats_t));
+	memset(&hh->choice, '\0', sizeof(hh_adaptive_choice_t));
+
+	return hh;
+}
+
+// Destruction
+void hh_adaptive_destroy(hh_adaptive_t *restrict hh) {
+	if (hh == NULL) {
+		return;
+	}
+
+	table_destroy(hh->sample);
+	heavy_hitter_destroy(hh->engine);
+
+	free(hh);
+	hh = NULL;
+}
+
+static int hh_adaptive_compare(const void *a, const void *b) {
+	const int64_t x = *(const int64_t *)a;
+	const int64_t y = *(const int64_t *)b;
+
+	return (x < y) - (x > y);
+}
+
+// Least squares slope of the log count over the log rank of the most
+// frequent keys of the sample. Keys seen once are left out, as a sample
+// counts the whole tail of the stream as ones.
+static double hh_adaptive_alpha(const table_t *restrict sample) {
+	uint32_t i, n = 0;
+	double x, y, sx = 0, sy = 0, sxx = 0, sxy = 0;
+	int64_t *restrict counts = xmalloc( sizeof(int64_t) * (sample->count+1) );
+
+	for (i = 0; i < sample->size; i++) {
+		if ( sample->keys[i] != TABLE_EMPTY && sample->vals[i] > 1 ) {
+			counts[n++] = sample->vals[i];
+		}
+	}
+
+	qsort(counts, n, sizeof(int64_t), hh_adaptive_compare);
+	n = (n < ADAPTIVE_RANKS) ? n : ADAPTIVE_RANKS;
+
+	for (i = 0; i < n; i++) {
+		x    = log(i+1);
+		y    = log(counts[i]);
+		sx  += x;
+		sy  += y;
+		sxx += x*x;
+		sxy += x*y;
+	}
+
+	free(counts);
+
+	if ( n < 2 ) {
+		return 0;
+	}
+
+	return -(n*sxy - sx*sy) / (n*sxx - sx*sx);
+}
+
+// Statistics of the sample taken since start
+static void hh_adaptive_statistics(hh_adaptive_t *restrict hh) {
+	const double elapsed = hh_adaptive_now() - hh->start;
+
+	hh->stats.distinct = hh->sample->count;
+	hh->stats.alpha    = hh_adaptive_alpha(hh->sample);
+	hh->stats.rate     = (elapsed > 0) ? hh->stats.updates/elapsed : 0;
+}
+
+// Deletions need the linear Count-Median sketch. A skewed stream leaves few
+// prefixes above the threshold, such that the walk of a k-tree is short,
+// while the walk of a flat stream is long and group testing decodes it in
+// time independent of the skew. Fewer and wider layers of the k-tree pay off
+// for very skewed or fast streams, and streams repeating few keys are
+// counted exactly until their keys grow.
+hh_adaptive_choice_t hh_adaptive_choose(const hh_adaptive_params_t *restrict
+		params, const hh_adaptive_stats_t *restrict stats) {
+	hh_adaptive_choice_t choice;
+
+	if ( stats->negative ) {
+		choice.engine = HH_ADAPTIVE_KMEDIAN;
+		choice.gran   = 8;
+	} else if ( stats->alpha >= 0.7 ) {
+		choice.engine = HH_ADAPTIVE_KMIN;
+		choice.gran   = (stats->alpha >= 1.2 || stats->rate > 1e7) ? 8 : 4;
+	} else {
+		choice.engine = HH_ADAPTIVE_CGT;
+		choice.gran   = 0;
+	}
+
+	choice.sparse = !stats->negative && stats->distinct <= 4096 &&
+		16*(uint64_t)stats->distinct <= stats->updates;
+
+	return choice;
+}
+
+// Parameters of the chosen engine in the given config
+static heavy_hitter_params_t *hh_adaptive_configure(hh_adaptive_t *restrict
+		hh, const uint8_t slot) {
+	hh_adaptive_config_t *restrict config = &hh->config[slot];
+	hh_adaptive_params_t *restrict params = hh->params;
+	const hh_adaptive_choice_t choice     = hh->choice;
+
+	memset(config, '\0', sizeof(hh_adaptive_config_t));
+
+	config->inner.hash = hh->hash;
+
+	switch (choice.engine) {
+		case HH_ADAPTIVE_KMIN:
+		case HH_ADAPTIVE_KMEDIAN:
+			config->ktree.phi     = params->phi;
+			config->ktree.epsilon = params->epsilon;
+			config->ktree.delta   = params->delta;
+			config->ktree.m       = params->m;
+			config->ktree.gran    = choice.gran;
+			config->ktree.b       = params->b;
+			config->ktree.f       = &countMin;
+
+			if ( choice.engine == HH_ADAPTIVE_KMEDIAN ) {
+				config->ktree.b = (params->b > 2) ? params->b : 4;
+				config->ktree.f = &countMedian;
+			}
+
+			config->inner.params = &config->ktree;
+			config->inner.f      = &hh_ktree;
+			break;
+		case HH_ADAPTIVE_CGT:
+			config->cgt.phi      = params->phi;
+			config->cgt.epsilon  = params->epsilon;
+			config->cgt.delta    = params->delta;
+			config->cgt.m        = params->m;
+			config->cgt.b        = params->b;
+
+			config->inner.params = &config->cgt;
+			config->inner.f      = &hh_cgt;
+			break;
+		default:
+			xerror("Unknown heavy hitter implementation.", __LINE__, __FILE__);
+	}
+
+	if ( !choice.sparse ) {
+		return &config->inner;
+	}
+
+	config->sparse.phi    = params->phi;
+	config->sparse.engine = &config->inner;
+	config->outer.hash    = hh->hash;
+	config->outer.params  = &config->sparse;
+	config->outer.f       = &hh_sparse;
+
+	return &config->outer;
+}
+
+// Creates the first engine and replays the sample into it
+static void hh_adaptive_migrate(hh_adaptive_t *restrict hh) {
+	uint32_t i;
+	table_t *restrict sample = hh->sample;
+
+	hh_adaptive_statistics(hh);
+	hh->choice   = hh_adaptive_choose(hh->params, &hh->stats);
+	hh->engine   = heavy_hitter_create(hh_adaptive_configure(hh, hh->slot));
+	hh->migrated = hh->seen;
+
+	for (i = 0; i < sample->size; i++) {
+		if ( sample->keys[i] != TABLE_EMPTY && sample->vals[i] != 0 ) {
+			heavy_hitter_update(hh->engine, table_key(sample, i),
+					sample->vals[i]);
+		}
+	}
+
+	table_clear(sample);
+}
+
+// Moves to the engine of the latest sample if it differs. The new engine is
+// given the estimates of the current engine above epsilon. The mass left is
+// spread over the other keys of the sample in proportion to their counts
+// there, such that only keys of the stream gain mass, and none of them more
+// than epsilon. What cannot be placed is left out of the new norm.
+static void hh_adaptive_reconfigure(hh_adaptive_t *restrict hh) {
+	uint32_t i;
+	int64_t rest, share, total = 0, carried = 0;
+	int64_t *restrict val;
+	hh_t *restrict engine;
+	heavy_hitter_estimates_t *restrict est;
+	table_t *restrict sample       = hh->sample;
+	const hh_adaptive_choice_t old = hh->choice;
+	const double epsilon           = hh->params->epsilon;
+	const heavy_hitter_threshold_t floor = { .value = epsilon };
+	const int64_t cap              = epsilon*hh->norm;
+
+	hh_adaptive_statistics(hh);
+	hh->choice = hh_adaptive_choose(hh->params, &hh->stats);
+
+	if ( hh->choice.engine == old.engine && hh->choice.gran == old.gran &&
+			hh->choice.sparse == old.sparse ) {
+		return;
+	}
+
+	engine = heavy_hitter_create(hh_adaptive_configure(hh, hh->slot ^ 1));
+	est    = heavy_hitter_query_thresholds(hh->engine, &floor, 1);
+
+	for (i = 0; i < est->count; i++) {
+		heavy_hitter_update(engine, est->hitters[i].id, est->hitters[i].count);
+		carried += est->hitters[i].count;
+
+		// Carried keys are not given any of the rest
+		if ( (val = table_find(sample, est->hitters[i].id)) != NULL ) {
+			*val = 0;
+		}
+	}
+
+	rest = (int64_t)hh->norm - carried;
+
+	for (i = 0; i < sample->size; i++) {
+		if ( sample->keys[i] != TABLE_EMPTY && sample->vals[i] > 0 ) {
+			total += sample->vals[i];
+		}
+	}
+
+	for (i = 0; rest > 0 && i < sample->size; i++) {
+		if ( sample->keys[i] == TABLE_EMPTY || sample->vals[i] <= 0 ) {
+			continue;
+		}
+
+		share = (double)rest * sample->vals[i] / total;
+		share = (share < cap) ? share : cap;
+
+		if ( share > 0 ) {
+			heavy_hitter_update(engine, table_key(sample, i), share);
+		}
+	}
+
+	heavy_hitter_destroy(hh->engine);
+	hh->engine = engine;
+	hh->slot  ^= 1;
+}
+
+static inline void hh_adaptive_observe(hh_adaptive_t *restrict hh,
+		const uint32_t idx, const int64_t c) {
+	*table_insert(hh->sample, idx) += c;
+	hh->stats.updates++;
+	hh->stats.negative |= (c < 0);
+}
+
+// Update
+void hh_adaptive_update(hh_adaptive_t *restrict hh, const uint32_t idx,
+		const int64_t c) {
+	uint64_t at;
+	const uint32_t size   = hh_adaptive_sample_size(hh);
+	const uint64_t period = (hh->params->period > size) ?
+		hh->params->period : size;
+
+	hh->norm += c;
+	hh->seen++;
+
+	if ( unlikely(hh->engine == NULL) ) {
+		hh_adaptive_observe(hh, idx, c);
+
+		if ( unlikely(hh->seen == size) ) {
+			hh_adaptive_migrate(hh);
+		}
+
+		return;
+	}
+
+	heavy_hitter_update(hh->engine, idx, c);
+
+	if ( hh->params->period == 0 ) {
+		return;
+	}
+
+	// Every period ends with a sample, counted from the first engine, which a
+	// query may create before the sample is complete
+	at = (hh->seen - hh->migrated - 1) % period;
+
+	if ( likely(at < period - size) ) {
+		return;
+	}
+
+	if ( unlikely(at == period - size) ) {
+		memset(&hh->stats, '\0', sizeof(hh_adaptive_stats_t));
+		hh->start = hh_adaptive_now();
+	}
+
+	hh_adaptive_observe(hh, idx, c);
+
+	if ( unlikely(at == period - 1) ) {
+		hh_adaptive_reconfigure(hh);
+		table_clear(hh->sample);
+	}
+}
+
+static inline hh_t *hh_adaptive_engine(hh_adaptive_t *restrict hh) {
+	if ( unlikely(hh->engine == NULL) ) {
+		hh_adaptive_migrate(hh);
+	}
+
+	return hh->engine;
+}
+
+heavy_hitter_t *hh_adaptive_query(hh_adaptive_t *restrict hh) {
+	return heavy_hitter_query(hh_adaptive_engine(hh));
+}
+
+heavy_hitter_t *hh_adaptive_topk(hh_adaptive_t *restrict hh, const uint32_t k) {
+	return heavy_hitter_topk(hh_adaptive_engine(hh), k);
+}
+
+heavy_hitter_estimates_t *hh_adaptive_query_thresholds(
+		hh_adaptive_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	return heavy_hitter_query_thresholds(hh_adaptive_engine(hh), thresholds,
+			n);
+}
+
+// Snapshots, the engine is recreated from the saved choice. The time a
+// sample started does not survive a restart, so its rate restarts as well.
+void hh_adaptive_save(hh_adaptive_t *restrict hh, snapshot_t *restrict snap) {
+	// Sections are only read once the snapshot is written
+	static const uint8_t created[2] = {0, 1};
+
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "seen", 0, &hh->seen, sizeof(uint64_t));
+	snapshot_add(snap, "migrated", 0, &hh->migrated, sizeof(uint64_t));
+	snapshot_add(snap, "stats", 0, &hh->stats, sizeof(hh_adaptive_stats_t));
+	snapshot_add(snap, "choice", 0, &hh->choice, 
+			sizeof(hh_adaptive_choice_t));
+	snapshot_add(snap, "created", 0, &created[hh->engine != NULL], 
+			sizeof(uint8_t));
+	table_save(hh->sample, snap, 0);
+
+	if ( hh->engine != NULL ) {
+		snapshot_nest(snap, "engine");
+		heavy_hitter_snapshot_save(hh->engine, snap);
+		snapshot_unnest(snap);
+	}
+}
+
+void hh_adaptive_load(hh_adaptive_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t created;
+
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "seen", 0, &hh->seen, sizeof(uint64_t));
+	snapshot_read(snap, "migrated", 0, &hh->migrated, sizeof(uint64_t));
+	snapshot_read(snap, "stats", 0, &hh->stats, sizeof(hh_adaptive_stats_t));
+	snapshot_read(snap, "choice", 0, &hh->choice, 
+			sizeof(hh_adaptive_choice_t));
+	snapshot_read(snap, "created", 0, &created, sizeof(uint8_t));
+	table_load(hh->sample, snap, 0);
+
+	hh->start = hh_adaptive_now();
+
+	heavy_hitter_destroy(hh->engine);
+	hh->engine = NULL;
+
+	if ( created ) {
+		hh->engine = heavy_hitter_create(hh_adaptive_configure(hh, hh->slot));
+
+		snapshot_nest(snap, "engine");
+		heavy_hitter_snapshot_load(hh->engine, snap);
+		snapshot_unnest(snap);
+	}
+}
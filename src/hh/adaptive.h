@@ -0,0 +1,106 @@
+#ifndef H_hh_adaptive
+#define H_hh_adaptive
+
+// Standard libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "hh/cgt.h"
+#include "hh/ktree.h"
+#include "hh/sparse.h"
+#include "util/hash.h"
+#include "util/table.h"
+
+// Engines chosen from
+typedef enum {
+	HH_ADAPTIVE_KMIN,    // k-tree of Count-Min sketches, for skewed streams
+	HH_ADAPTIVE_KMEDIAN, // k-tree of Count-Median sketches, for deletions
+	HH_ADAPTIVE_CGT,     // Group testing, for flat streams
+} hh_adaptive_engine_t;
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint32_t        m;
+	uint32_t        b;
+	uint32_t        sample; // Updates observed before choosing, 0 is 65536
+	uint64_t        period; // Updates between the samples of the
+	                        // re-evaluations, 0 never re-evaluates
+} hh_adaptive_params_t;
+
+// Statistics of a sample
+typedef struct {
+	uint64_t        updates;
+	uint32_t        distinct;
+	double          alpha;    // Zipf exponent fitted to the top ranks
+	double          rate;     // Updates per second
+	bool            negative; // Negative updates were seen
+} hh_adaptive_stats_t;
+
+typedef struct {
+	hh_adaptive_engine_t engine;
+	uint8_t              gran;   // Granularity of a k-tree
+	bool                 sparse; // Exact until the distinct keys grow
+} hh_adaptive_choice_t;
+
+// Parameters of a configured engine, kept as long as the engine
+typedef struct {
+	hh_ktree_params_t      ktree;
+	hh_cgt_params_t        cgt;
+	hh_sparse_params_t     sparse;
+	heavy_hitter_params_t  inner;
+	heavy_hitter_params_t  outer;
+} hh_adaptive_config_t;
+
+/**
+ * Chooses the engine by the statistics of the first sample updates, which
+ * are counted exactly and replayed into the chosen engine. Every period
+ * updates another sample is taken, and if it calls for another engine the
+ * estimates of the current engine are carried over to the new one.
+ */
+typedef struct {
+	table_t               *restrict sample;
+	hh_t                  *restrict engine; // NULL while sampling first
+	hash_t                *restrict hash;
+	hh_adaptive_config_t   config[2];       // Of the engine and its successor
+	uint8_t                slot;            // Config of the engine
+	hh_adaptive_choice_t   choice;
+	hh_adaptive_stats_t    stats;
+	uint64_t               norm;
+	uint64_t               seen;
+	uint64_t               migrated;        // Updates seen by the first engine
+	double                 start;           // Time the sample started
+	hh_adaptive_params_t  *restrict params;
+} hh_adaptive_t;
+
+// Initialization
+hh_adaptive_t *hh_adaptive_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_adaptive_destroy(hh_adaptive_t *restrict hh);
+
+// Update
+void hh_adaptive_update(hh_adaptive_t *restrict hh, const uint32_t idx,
+		const int64_t c);
+
+// Engine for the statistics of a sample
+hh_adaptive_choice_t hh_adaptive_choose(const hh_adaptive_params_t *restrict
+		params, const hh_adaptive_stats_t *restrict stats);
+
+// Query, a query before the first sample is complete chooses by the updates
+// seen so far. Top-k under group testing only returns keys above epsilon.
+heavy_hitter_t *hh_adaptive_query(hh_adaptive_t *restrict hh);
+heavy_hitter_t *hh_adaptive_topk(hh_adaptive_t *restrict hh, const uint32_t k);
+heavy_hitter_estimates_t *hh_adaptive_query_thresholds(
+		hh_adaptive_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_adaptive_save(hh_adaptive_t *restrict hh, snapshot_t *restrict snap);
+void hh_adaptive_load(hh_adaptive_t *restrict hh, snapshot_t *restrict snap);
+
+#endif
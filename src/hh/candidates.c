@@ -0,0 +1,91 @@
+// Standard libraries
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// User defined libraries
+#include "hh/candidates.h"
+#include "util/frontier.h"
+#include "util/table.h"
+#include "util/xutil.h"
+
+extern inline void candidates_update(candidates_t *restrict cand, 
+		const uint32_t idx, const int64_t c, const int64_t est, 
+		const double threshold);
+
+candidates_t *candidates_create(const uint32_t size, hh_crossing crossing, 
+		void *arg) {
+	candidates_t *cand = xmalloc( sizeof(candidates_t) );
+
+	cand->table        = table_create(size);
+	cand->crossing     = crossing;
+	cand->arg          = arg;
+	cand->valid        = true;
+
+	return cand;
+}
+
+void candidates_destroy(candidates_t *restrict cand) {
+	if (cand == NULL) {
+		return;
+	}
+
+	table_destroy(cand->table);
+
+	free(cand);
+	cand = NULL;
+}
+
+static int candidates_compare(const void *a, const void *b) {
+	const uint32_t x = *(const uint32_t *)a;
+	const uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+void candidates_collect(candidates_t *restrict cand, 
+		frontier_t *restrict leaves) {
+	uint32_t i;
+	table_t *restrict table = cand->table;
+
+	frontier_clear(leaves);
+	frontier_reserve(leaves, table->count);
+
+	for (i = 0; i < table->size; i++) {
+		if ( table->keys[i] != TABLE_EMPTY ) {
+			leaves->elm[leaves->count++] = table_key(table, i);
+		}
+	}
+
+	qsort(leaves->elm, leaves->count, sizeof(uint32_t), candidates_compare);
+}
+
+void candidates_retain(candidates_t *restrict cand, 
+		frontier_t *restrict leaves, const double threshold) {
+	uint32_t i, j;
+
+	table_clear(cand->table);
+
+	for (i = 0, j = 0; i < leaves->count; i++) {
+		if ( leaves->est[i] >= threshold ) {
+			leaves->elm[j] = leaves->elm[i];
+			leaves->est[j] = leaves->est[i];
+			*table_insert(cand->table, leaves->elm[j]) = leaves->est[j];
+			j++;
+		}
+	}
+	leaves->count = j;
+}
+
+void candidates_reset(candidates_t *restrict cand, 
+		const frontier_t *restrict leaves) {
+	uint32_t i;
+
+	table_clear(cand->table);
+
+	for (i = 0; i < leaves->count; i++) {
+		*table_insert(cand->table, leaves->elm[i]) = leaves->est[i];
+	}
+
+	cand->valid = true;
+}
@@ -0,0 +1,61 @@
+#ifndef H_hh_candidates
+#define H_hh_candidates
+
+// Standard libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/frontier.h"
+#include "util/table.h"
+#include "util/xutil.h"
+
+/**
+ * The set of items whose leaf estimate was at least phi*norm right after one 
+ * of their own updates. Without negative updates the count of an item only 
+ * grows when the item itself is updated, so every heavy hitter is in the set 
+ * and a query only has to re-validate the candidates instead of walking the 
+ * tree. A negative update invalidates the set until the next full walk.
+ */
+typedef struct {
+	table_t     *restrict table;  // Candidate and its estimate when it crossed
+	hh_crossing  crossing;        // Called when an item becomes a candidate
+	void        *arg;
+	bool         valid;
+} candidates_t;
+
+candidates_t *candidates_create(const uint32_t size, hh_crossing crossing, 
+		void *arg);
+
+void candidates_destroy(candidates_t *restrict cand);
+
+inline void candidates_update(candidates_t *restrict cand, const uint32_t idx,
+		const int64_t c, const int64_t est, const double threshold) {
+	if ( unlikely(c < 0) ) {
+		cand->valid = false;
+	}
+
+	if ( unlikely(est >= threshold) && table_find(cand->table, idx) == NULL ) {
+		*table_insert(cand->table, idx) = est;
+
+		if ( cand->crossing != NULL ) {
+			cand->crossing(cand->arg, idx, est);
+		}
+	}
+}
+
+// Writes the candidates to leaves in increasing order
+void candidates_collect(candidates_t *restrict cand, 
+		frontier_t *restrict leaves);
+
+// Keeps the leaves whose fresh estimate is at least the threshold, both in 
+// the frontier and in the candidate set
+void candidates_retain(candidates_t *restrict cand, 
+		frontier_t *restrict leaves, const double threshold);
+
+// Replaces the candidates by the leaves found by a full walk
+void candidates_reset(candidates_t *restrict cand, 
+		const frontier_t *restrict leaves);
+
+#endif
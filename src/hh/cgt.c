@@ -0,0 +1,278 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/cgt.h"
+#include "sketch/sketch.h"
+#include "util/hash.h"
+#include "util/xutil.h"
+
+// Initialization
+hh_cgt_t *hh_cgt_create(heavy_hitter_params_t *restrict p) {
+	uint32_t i;
+	uint64_t size;
+	hh_cgt_params_t *restrict params = (hh_cgt_params_t *)p->params;
+	const double phi      = params->phi;
+	const uint32_t twophi = ceil(2./phi);
+	const uint8_t bits    = ceil(log2((uint64_t)params->m+1));
+	uint32_t w            = ceil(params->b / params->epsilon) * p->hash->c;
+	uint32_t d            = ceil(log2(1. / (params->delta*phi)) /
+			log2(params->b));
+	hh_cgt_t *restrict hh = xmalloc( sizeof(hh_cgt_t) );
+
+	assert(phi > params->epsilon);
+
+	sketch_fixed_size(&d, &w);
+
+	// Hashes into 2^M bins get a power of two
+	if ( w > 0 && p->hash->pow2 ) {
+		w = next_pow_2(w);
+	}
+
+	size               = sizeof(int64_t) * (uint64_t)d * w * (bits+1);
+
+	hh->table          = xmalloc_aligned( 64, size );
+	hh->seeds          = xmalloc( sizeof(uint64_t) * 2 * d );
+	hh->hash           = p->hash;
+	hh->w              = w;
+	hh->d              = d;
+	hh->bits           = bits;
+	hh->norm           = 0;
+	hh->params         = params;
+	hh->result.count   = 0;
+	hh->result.size    = twophi;
+	hh->result.hitters = xmalloc( sizeof(uint32_t) * twophi );
+	heavy_hitter_estimates_init(&hh->estimates, twophi);
+
+	memset(hh->table, '\0', size);
+	hash_init(&hh->M, w);
+
+	for (i = 0; i < d; i++) {
+		hh->seeds[2*i]   = p->hash->agen();
+		hh->seeds[2*i+1] = p->hash->bgen(hh->M);
+	}
+
+	#ifdef SPACE
+	uint64_t space = size + sizeof(uint64_t) * 2 * d +
+		sizeof(uint32_t) * twophi + sizeof(hh_cgt_t);
+	fprintf(stderr, "Space usage: %"PRIu64" bytes\n\n", space);
+	#endif
+
+	return hh;
+}
+
+// Destruction
+void hh_cgt_destroy(hh_cgt_t *restrict hh) {
+	if (hh == NULL) {
+		return;
+	}
+
+	free(hh->table);
+	free(hh->seeds);
+	free(hh->result.hitters);
+	heavy_hitter_estimates_free(&hh->estimates);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Counters of the bucket of idx in row r, the total first
+static inline int64_t *hh_cgt_bucket(hh_cgt_t *restrict hh, const uint32_t r,
+		const uint32_t idx) {
+	const uint32_t k = hh->hash->hash(hh->w, hh->M, idx, hh->seeds[2*r],
+			hh->seeds[2*r+1]);
+
+	return hh->table + ((uint64_t)r*hh->w + k) * (hh->bits+1);
+}
+
+// Update
+void hh_cgt_update(hh_cgt_t *restrict hh, const uint32_t idx,
+		const int64_t c) {
+	uint32_t r, v;
+	int64_t *restrict bucket;
+
+	// Buckets count bits up to those of m
+	if ( unlikely(idx > hh->params->m) ) {
+		xerror("Key out of the range of the heavy hitter implementation", 
+				__LINE__, __FILE__);
+	}
+
+	for (r = 0; r < hh->d; r++) {
+		bucket     = hh_cgt_bucket(hh, r, idx);
+		bucket[0] += c;
+
+		for (v = idx; v != 0; v &= v-1) { // set bits
+			bucket[1 + __builtin_ctz(v)] += c;
+		}
+	}
+
+	hh->norm += c;
+}
+
+int64_t hh_cgt_point(hh_cgt_t *restrict hh, const uint32_t idx) {
+	uint32_t r;
+	int64_t e, estimate = INT64_MAX;
+
+	for (r = 0; r < hh->d; r++) {
+		e        = hh_cgt_bucket(hh, r, idx)[0];
+		estimate = (e < estimate) ? e : estimate;
+	}
+
+	return estimate;
+}
+
+// Key of the heavy hitter dominating a bucket, false if a bit is set in as
+// much or as little of the bucket as the threshold, where it has none or
+// several heavy hitters
+static inline bool hh_cgt_decode(const int64_t *restrict bucket,
+		const uint8_t bits, const double threshold, uint32_t *restrict idx) {
+	uint8_t j;
+	bool one, zero;
+	uint32_t x = 0;
+
+	for (j = 0; j < bits; j++) {
+		one  = bucket[1+j] >= threshold;
+		zero = bucket[0] - bucket[1+j] >= threshold;
+
+		if ( one == zero ) {
+			return false;
+		}
+
+		x |= (uint32_t)one << j;
+	}
+
+	*idx = x;
+
+	return true;
+}
+
+static int hh_cgt_compare(const void *a, const void *b) {
+	const hitter_t *x = (const hitter_t *)a;
+	const hitter_t *y = (const hitter_t *)b;
+
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+// Decodes the heavy buckets of every row into the estimates, sorted by key
+// without duplicates. A key is kept if it hashes back to its bucket and its
+// smallest bucket is heavy as well.
+static void hh_cgt_find(hh_cgt_t *restrict hh, const double threshold) {
+	uint32_t r, k, i, j, x;
+	int64_t est;
+	int64_t *restrict bucket;
+	heavy_hitter_estimates_t *restrict res = &hh->estimates;
+	const uint8_t bits                     = hh->bits;
+
+	res->count = 0;
+
+	for (r = 0; r < hh->d; r++) {
+		bucket = hh->table + (uint64_t)r*hh->w*(bits+1);
+
+		for (k = 0; k < hh->w; k++, bucket += bits+1) {
+			if ( bucket[0] < threshold ||
+					!hh_cgt_decode(bucket, bits, threshold, &x) ) {
+				continue;
+			}
+
+			if ( hh_cgt_bucket(hh, r, x) != bucket ) {
+				continue;
+			}
+
+			est = hh_cgt_point(hh, x);
+
+			if ( est >= threshold ) {
+				heavy_hitter_estimates_push(res, x, est, 0);
+			}
+		}
+	}
+
+	qsort(res->hitters, res->count, sizeof(hitter_t), hh_cgt_compare);
+
+	for (i = 0, j = 0; i < res->count; i++) {
+		if ( j == 0 || res->hitters[j-1].id != res->hitters[i].id ) {
+			res->hitters[j++] = res->hitters[i];
+		}
+	}
+	res->count = j;
+}
+
+heavy_hitter_t *hh_cgt_query(hh_cgt_t *restrict hh) {
+	uint32_t i;
+
+	hh_cgt_find(hh, hh->params->phi*hh->norm);
+
+	if ( unlikely(hh->estimates.count > hh->result.size) ) {
+		hh->result.size    = hh->estimates.count;
+		hh->result.hitters = xrealloc(hh->result.hitters,
+				hh->result.size*sizeof(uint32_t));
+	}
+
+	for (i = 0; i < hh->estimates.count; i++) {
+		hh->result.hitters[i] = hh->estimates.hitters[i].id;
+	}
+	hh->result.count = hh->estimates.count;
+
+	return &hh->result;
+}
+
+// Decodes once at the lowest threshold
+heavy_hitter_estimates_t *hh_cgt_query_thresholds(hh_cgt_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	const int64_t error = ceil(hh->params->epsilon*hh->norm);
+
+	hh_cgt_find(hh, heavy_hitter_min_threshold(thresholds, n, hh->norm));
+
+	for (i = 0; i < hh->estimates.count; i++) {
+		hh->estimates.hitters[i].error = error;
+	}
+
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, hh->norm);
+
+	return &hh->estimates;
+}
+
+// Only keys above epsilon decode, so fewer than k may be returned
+heavy_hitter_t *hh_cgt_topk(hh_cgt_t *restrict hh, const uint32_t k) {
+	uint32_t i;
+	const heavy_hitter_threshold_t floor = { .value = hh->params->epsilon };
+
+	hh_cgt_query_thresholds(hh, &floor, 1);
+
+	if ( unlikely(k > hh->result.size) ) {
+		hh->result.size    = k;
+		hh->result.hitters = xrealloc(hh->result.hitters,
+				hh->result.size*sizeof(uint32_t));
+	}
+
+	for (i = 0; i < k && i < hh->estimates.count; i++) {
+		hh->result.hitters[i] = hh->estimates.hitters[i].id;
+	}
+	hh->result.count = i;
+
+	return &hh->result;
+}
+
+// Snapshots
+void hh_cgt_save(hh_cgt_t *restrict hh, snapshot_t *restrict snap) {
+	const uint64_t size = sizeof(int64_t) * (uint64_t)hh->d * hh->w *
+		(hh->bits+1);
+
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "table", 0, hh->table, size);
+	snapshot_add(snap, "seeds", 0, hh->seeds, sizeof(uint64_t) * 2 * hh->d);
+}
+
+void hh_cgt_load(hh_cgt_t *restrict hh, snapshot_t *restrict snap) {
+	const uint64_t size = sizeof(int64_t) * (uint64_t)hh->d * hh->w *
+		(hh->bits+1);
+
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "table", 0, hh->table, size);
+	snapshot_read(snap, "seeds", 0, hh->seeds, sizeof(uint64_t) * 2 * hh->d);
+}
@@ -0,0 +1,62 @@
+#ifndef H_hh_cgt
+#define H_hh_cgt
+
+// Standard libraries
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/hash.h"
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint32_t        m;
+	uint32_t        b;
+} hh_cgt_params_t;
+
+/**
+ * Combinatorial group testing of Cormode and Muthukrishnan. Every bucket of a
+ * row keeps its total and, for every bit of the keys, the count of its items
+ * with the bit set. A bucket dominated by a heavy hitter spells out the key
+ * of the hitter bit by bit, so a query decodes the heavy buckets instead of
+ * walking a tree, and an update touches a single block of counters per row.
+ */
+typedef struct {
+	int64_t               *restrict table; // d rows of w buckets of bits+1
+	                                       // counters
+	uint64_t              *restrict seeds; // Hash parameters of every row
+	hash_t                *restrict hash;
+	uint32_t               w;
+	uint32_t               d;
+	uint8_t                M;
+	uint8_t                bits;           // Bits of the keys
+	uint64_t               norm;
+	hh_cgt_params_t       *restrict params;
+	heavy_hitter_t         result;
+	heavy_hitter_estimates_t estimates;
+} hh_cgt_t;
+
+// Initialization
+hh_cgt_t *hh_cgt_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_cgt_destroy(hh_cgt_t *restrict hh);
+
+// Update
+void hh_cgt_update(hh_cgt_t *restrict hh, const uint32_t idx, const int64_t c);
+
+// Query
+int64_t hh_cgt_point(hh_cgt_t *restrict hh, const uint32_t idx);
+heavy_hitter_t *hh_cgt_query(hh_cgt_t *restrict hh);
+heavy_hitter_t *hh_cgt_topk(hh_cgt_t *restrict hh, const uint32_t k);
+heavy_hitter_estimates_t *hh_cgt_query_thresholds(hh_cgt_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_cgt_save(hh_cgt_t *restrict hh, snapshot_t *restrict snap);
+void hh_cgt_load(hh_cgt_t *restrict hh, snapshot_t *restrict snap);
+
+#endif
@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/changer.h"
+#include "sketch/count_median.h"
+#include "util/frontier.h"
+#include "util/xutil.h"
+
+// Counter of the prefix x of an exact layer
+static inline uint64_t hh_changer_top(const uint8_t layer, const uint32_t x) {
+	return (((uint64_t)2 << layer) - 2) + x;
+}
+
+// Initialization
+hh_changer_t *hh_changer_create(heavy_hitter_params_t *restrict p) {
+	uint8_t i, e;
+	uint64_t top_size;
+	hh_changer_params_t *restrict params = (hh_changer_params_t *)p->params;
+	const uint8_t logm         = floor(log2((uint64_t)params->m+1));
+	const double phi           = params->phi;
+	const uint32_t twophi      = ceil(2./phi);
+	const double delta         = (params->delta*phi)/(2.*logm);
+	hh_changer_t *restrict hh  = xmalloc( sizeof(hh_changer_t) );
+	count_median_t *restrict s = count_median_create(p->hash, params->b,
+			params->epsilon, delta);
+	uint8_t top_cnt;
+
+	// A layer of fewer prefixes than a row gains nothing from hashing
+	if ( params->exact > 0 ) {
+		top_cnt = params->exact;
+	} else {
+		for (top_cnt = 0; top_cnt < logm &&
+				((uint64_t)2 << top_cnt) <= s->size.w; top_cnt++) {
+		}
+	}
+	top_cnt = (top_cnt > logm) ? logm : top_cnt;
+
+	top_size           = sizeof(int64_t) * (((uint64_t)2 << top_cnt) - 2);
+
+	hh->epoch          = 0;
+	hh->top_cnt        = top_cnt;
+	hh->logm           = logm;
+	hh->norm[0]        = 0;
+	hh->norm[1]        = 0;
+	hh->params         = params;
+	hh->cur            = frontier_create(2*twophi);
+	hh->next           = frontier_create(2*twophi);
+	hh->result.count   = 0;
+	hh->result.size    = twophi;
+	hh->result.hitters = xmalloc( sizeof(changer_t) * twophi );
+
+	for (e = 0; e < 2; e++) {
+		hh->top[e]  = xmalloc( top_size + sizeof(int64_t) );
+		memset(hh->top[e], '\0', top_size);
+		hh->tree[e] = (top_cnt < logm) ?
+			xmalloc( sizeof(count_median_t *) * (logm-top_cnt) ) : NULL;
+	}
+
+	// The previous epoch copies the seeds of the current one
+	for (i = 0; i < logm-top_cnt; i++) {
+		hh->tree[0][i] = (i == logm-top_cnt-1) ? s :
+			count_median_create(p->hash, params->b, params->epsilon, delta);
+		hh->tree[1][i] = count_median_copy_seeds(hh->tree[0][i]);
+	}
+
+	if ( top_cnt == logm ) {
+		count_median_destroy(s);
+	}
+
+	#ifdef SPACE
+	uint64_t space = 2*top_size + sizeof(changer_t) * twophi +
+		sizeof(hh_changer_t);
+	fprintf(stderr, "Space usage excluding sketches: %"PRIu64" bytes\n\n",
+			space);
+	#endif
+
+	return hh;
+}
+
+// Destruction
+void hh_changer_destroy(hh_changer_t *restrict hh) {
+	uint8_t i, e;
+
+	if (hh == NULL) {
+		return;
+	}
+
+	for (e = 0; e < 2; e++) {
+		for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+			count_median_destroy(hh->tree[e][i]);
+		}
+
+		free(hh->tree[e]);
+		free(hh->top[e]);
+	}
+
+	free(hh->result.hitters);
+	frontier_destroy(hh->cur);
+	frontier_destroy(hh->next);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Update
+void hh_changer_update(hh_changer_t *restrict hh, const uint32_t idx,
+		const int64_t c) {
+	int8_t i;
+	uint32_t x                      = idx;
+	count_median_t **restrict tree  = hh->tree[hh->epoch];
+	int64_t *restrict top           = hh->top[hh->epoch];
+	const uint8_t top_cnt           = hh->top_cnt;
+
+	for (i = hh->logm-top_cnt-1; i > -1; i--) {
+		count_median_update(tree[i], x, c);
+		x >>= 1;
+	}
+
+	for (i = top_cnt-1; i > -1; i--) {
+		top[hh_changer_top(i, x)] += c;
+		x >>= 1;
+	}
+
+	hh->norm[hh->epoch] += c;
+}
+
+void hh_changer_epoch(hh_changer_t *restrict hh) {
+	uint8_t i;
+	const uint8_t prev = hh->epoch ^ 1;
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		count_median_clear(hh->tree[prev][i]);
+	}
+
+	memset(hh->top[prev], '\0', sizeof(int64_t) *
+			(((uint64_t)2 << hh->top_cnt) - 2));
+
+	hh->norm[prev] = 0;
+	hh->epoch      = prev;
+}
+
+// Estimate of the prefix x of a layer in an epoch
+static inline int64_t hh_changer_estimate(hh_changer_t *restrict hh,
+		const uint8_t e, const uint8_t layer, const uint32_t x) {
+	if ( layer < hh->top_cnt ) {
+		return hh->top[e][hh_changer_top(layer, x)];
+	}
+
+	return count_median_point(hh->tree[e][layer-hh->top_cnt], x);
+}
+
+// Change of the prefix x of a layer
+static inline int64_t hh_changer_change(hh_changer_t *restrict hh,
+		const uint8_t layer, const uint32_t x) {
+	const uint8_t e = hh->epoch;
+
+	if ( layer < hh->top_cnt ) {
+		return hh->top[e][hh_changer_top(layer, x)] -
+			hh->top[e^1][hh_changer_top(layer, x)];
+	}
+
+	return count_median_point_diff(hh->tree[e][layer-hh->top_cnt],
+			hh->tree[e^1][layer-hh->top_cnt], x);
+}
+
+int64_t hh_changer_point(hh_changer_t *restrict hh, const uint32_t idx) {
+	return hh_changer_change(hh, hh->logm-1, idx);
+}
+
+uint64_t hh_changer_l1(hh_changer_t *restrict hh) {
+	uint64_t x, l1 = 0;
+	const uint8_t e    = hh->epoch;
+	const uint8_t logm = hh->logm;
+
+	if ( hh->top_cnt < logm ) {
+		return count_median_l1_diff(hh->tree[e][logm-hh->top_cnt-1],
+				hh->tree[e^1][logm-hh->top_cnt-1]);
+	}
+
+	for (x = 0; x < (uint64_t)2 << (logm-1); x++) {
+		l1 += llabs(hh->top[e][hh_changer_top(logm-1, x)] -
+				hh->top[e^1][hh_changer_top(logm-1, x)]);
+	}
+
+	return l1;
+}
+
+// Expands the prefixes of cur into their children at the given layer. The
+// change of a prefix sums the changes of its items, which may cancel, but an
+// item cannot change by more than its larger count of the two epochs, so a
+// child is kept while that count reaches the threshold. The clamp is on these
+// counts, which unlike the changes never exceed those of the parent.
+static void hh_changer_expand(hh_changer_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next,
+		const double threshold) {
+	uint32_t i, j, x;
+	int64_t est, prev;
+	const uint8_t e = hh->epoch;
+
+	frontier_clear(next);
+
+	for (i = 0; i < cur->count; i++) {
+		x = 2*cur->elm[i];
+
+		for (j = 0; j < 2; j++) { // branch=2
+			est  = hh_changer_estimate(hh, e, layer, x+j);
+			prev = hh_changer_estimate(hh, e^1, layer, x+j);
+			est  = (prev > est) ? prev : est;
+			est  = (est < cur->est[i]) ? est : cur->est[i];
+
+			if ( est >= threshold && est > 0 ) {
+				frontier_push_back(next, x+j, est);
+			}
+		}
+	}
+}
+
+static int hh_changer_compare(const void *a, const void *b) {
+	const changer_t *x = (const changer_t *)a;
+	const changer_t *y = (const changer_t *)b;
+
+	if ( llabs(x->change) != llabs(y->change) ) {
+		return (llabs(x->change) > llabs(y->change)) ? -1 : 1;
+	}
+
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+heavy_changers_t *hh_changer_query(hh_changer_t *restrict hh,
+		const double phi) {
+	uint8_t layer;
+	uint32_t i;
+	int64_t change;
+	frontier_t *cur    = hh->cur;
+	frontier_t *next   = hh->next;
+	const uint8_t logm = hh->logm;
+	const uint64_t l1  = hh_changer_l1(hh);
+	const double th    = phi*l1;
+	const uint64_t top = (hh->norm[0] > hh->norm[1]) ?
+		hh->norm[0] : hh->norm[1];
+
+	hh->result.count = 0;
+
+	// Nothing changed, the threshold would keep every prefix
+	if ( unlikely(l1 == 0) ) {
+		return &hh->result;
+	}
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, top);
+
+	for (layer = 0; layer < logm-1 && cur->count > 0; layer++) {
+		hh_changer_expand(hh, layer, cur, next, th);
+		frontier_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+
+	// The leaves are tested by their change
+	for (i = 0; i < 2*cur->count; i++) {
+		change = hh_changer_change(hh, logm-1, 2*cur->elm[i/2] + i%2);
+
+		if ( llabs(change) < th || change == 0 ) {
+			continue;
+		}
+
+		if ( unlikely(hh->result.count == hh->result.size) ) {
+			hh->result.size   += hh->result.size;
+			hh->result.hitters = xrealloc(hh->result.hitters,
+					hh->result.size*sizeof(changer_t));
+		}
+
+		hh->result.hitters[hh->result.count].id     = 2*cur->elm[i/2] + i%2;
+		hh->result.hitters[hh->result.count].change = change;
+		hh->result.count++;
+	}
+
+	qsort(hh->result.hitters, hh->result.count, sizeof(changer_t),
+			hh_changer_compare);
+
+	return &hh->result;
+}
@@ -0,0 +1,81 @@
+#ifndef H_hh_changer
+#define H_hh_changer
+
+// Standard libraries
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/frontier.h"
+#include "util/hash.h"
+#include "sketch/count_median.h"
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint32_t        m;
+	uint32_t        b;
+	uint8_t         exact; // Exactly counted top layers, 0 keeps those of
+	                       // fewer prefixes than a row
+} hh_changer_params_t;
+
+// An item and the estimated change of its count from the previous epoch
+typedef struct {
+	uint32_t id;
+	int64_t  change;
+} changer_t;
+
+// Sorted by decreasing absolute change
+typedef struct {
+	changer_t *restrict hitters;
+	uint32_t count;
+	uint32_t size;
+} heavy_changers_t;
+
+/**
+ * Heavy changers between two epochs. Both epochs keep the dyadic tree of
+ * hh_sketch, the layers of the two sharing the seeds of their Count-Median
+ * sketches, such that the change of an item is read as the difference of
+ * the cells of the two without building a third sketch.
+ */
+typedef struct {
+	count_median_t       **restrict tree[2]; // Sketched layers of an epoch
+	int64_t               *restrict top[2];  // Exact layers of an epoch
+	uint8_t                epoch;            // Index of the current epoch
+	uint8_t                top_cnt;
+	uint8_t                logm;
+	uint64_t               norm[2];
+	hh_changer_params_t   *restrict params;
+	frontier_t            *restrict cur;
+	frontier_t            *restrict next;
+	heavy_changers_t       result;
+} hh_changer_t;
+
+// Initialization
+hh_changer_t *hh_changer_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_changer_destroy(hh_changer_t *restrict hh);
+
+// Update of the current epoch
+void hh_changer_update(hh_changer_t *restrict hh, const uint32_t idx,
+		const int64_t c);
+
+// Ends the current epoch, which becomes the previous one
+void hh_changer_epoch(hh_changer_t *restrict hh);
+
+// Estimated change of an item
+int64_t hh_changer_point(hh_changer_t *restrict hh, const uint32_t idx);
+
+// Estimated L1 of the difference of the epochs, a lower bound when the leaves
+// are sketched
+uint64_t hh_changer_l1(hh_changer_t *restrict hh);
+
+// Items whose count changed by a fraction phi of the L1 of the difference at
+// least
+heavy_changers_t *hh_changer_query(hh_changer_t *restrict hh,
+		const double phi);
+
+#endif
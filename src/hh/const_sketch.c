@@ -7,10 +7,29 @@
 #include "hh/hh.h"
 #include "hh/const_sketch.h"
 #include "sketch/sketch.h"
-#include "util/fifo.h"
+#include "util/cache.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
 #include "util/hash.h"
 #include "util/xutil.h"
 
+// Layer i has 2^(i+1) nodes, while every sketched layer is a single row of 
+// w counters. The sketch verifying the leaves is read on every update.
+static uint8_t hh_const_sketch_exact_layers(const uint8_t logm, 
+		const uint32_t w, void *restrict sketch) {
+	uint8_t i;
+	uint64_t nodes[logm];
+	const uint32_t d = sketch_depth(sketch);
+
+	for (i = 0; i < logm; i++) {
+		nodes[i] = (uint64_t)2 << i;
+	}
+
+	return cache_exact_layers(nodes, logm, sizeof(uint64_t)*(w+2), 1, 
+			sizeof(uint64_t)*sketch_width(sketch)*d, d);
+}
+
 // Initialization
 hh_const_sketch_t *hh_const_sketch_create(heavy_hitter_params_t *restrict p) {
 	uint32_t i, size;
@@ -25,9 +44,8 @@ hh_const_sketch_t *hh_const_sketch_create(heavy_hitter_params_t *restrict p) {
 	const uint8_t logm         = log2((uint64_t)m+1);
 	const uint32_t result_size = sizeof(uint32_t) * ceil(2./phi);
 	const uint32_t w           = ceil(1. / (epsilon * error)); // b/(epsilon*error*b)
-	uint8_t np2_base           = MultiplyDeBruijnBitPosition2[
-		(uint32_t)(next_pow_2(w) * 0x077CB531U) >> 27
-	]; //We only do exact when it is below size of sketch
+	uint8_t np2_base;
+	uint8_t gran[logm];
 
 	hh_const_sketch_t *restrict hh  = xmalloc( sizeof(hh_const_sketch_t) );
 	sketch_t          *restrict s   = sketch_create(params->f, p->hash, b,
@@ -36,27 +54,48 @@ hh_const_sketch_t *hh_const_sketch_create(heavy_hitter_params_t *restrict p) {
 
 	hash_init(&hh->M, w);
 
+	if ( params->exact > 0 ) {
+		np2_base = params->exact;
+	} else {
+		np2_base = hh_const_sketch_exact_layers(logm, w, s->sketch);
+	}
+
 	if (np2_base > logm) {
 		np2_base = logm;
 	}
 
-	size               = ( ((1 << (np2_base+1))-2) + ((2+w)*(logm-np2_base)) );
+	memset(gran, 1, sizeof(gran)); // branch=2
+	hh->layout         = layout_create(gran, np2_base+1);
+	hh->exact_size     = hh->layout->size;
+	size               = hh->exact_size + ((2+w)*(logm-np2_base));
 	hh->params         = params;
 	hh->logm           = logm;
+	hh->prune          = params->f->one_sided;
 	hh->norm           = 0;
 	hh->result.count   = 0; 
 	hh->w              = w;
+	hh->g              = (params->colocate && w >= 2) ? 1 : 0; // branch=2
 	hh->hash           = p->hash;
-	hh->fifo           = fifo_create(ceil(3./phi));
+	hh->cur            = frontier_create(ceil(3./phi));
+	hh->next           = frontier_create(ceil(3./phi));
+	hh->heap           = heap_create(ceil(3./phi));
+	hh->candidates     = (params->incremental) ? 
+		candidates_create(ceil(2./phi), params->crossing, params->arg) : NULL;
 	hh->result.hitters = xmalloc(result_size);
 	hh->result.size    = ceil(2./phi);
 	memset(hh->result.hitters, '\0', result_size);
+	heavy_hitter_estimates_init(&hh->estimates, ceil(2./phi));
 	hh->sketch         = s;
+
+	if ( params->colocate ) {
+		sketch_siblings(s->sketch, 1);
+	}
+
 	hh->exact_cnt      = np2_base;
-	hh->tree           = xmalloc( sizeof(uint64_t) * size );
+	hh->tree           = xmalloc_aligned( LAYOUT_ALIGN, sizeof(uint64_t) * size );
 	memset(hh->tree, '\0', sizeof(uint64_t) * size);
 
-	for (i = (1 << (np2_base+1))-2; i < size; i += 2+w) {
+	for (i = hh->exact_size; i < size; i += 2+w) {
 		hh->tree[i]   = (uint64_t) p->hash->agen();
 		hh->tree[i+1] = (uint64_t) p->hash->bgen(hh->M);
 	}
@@ -83,9 +122,29 @@ void hh_const_sketch_destroy(hh_const_sketch_t *restrict hh) {
 		hh->tree = NULL;
 	}
 
-	if (hh->fifo != NULL) {
-		fifo_destroy(hh->fifo);
-		hh->fifo = NULL;
+	if (hh->layout != NULL) {
+		layout_destroy(hh->layout);
+		hh->layout = NULL;
+	}
+
+	if (hh->cur != NULL) {
+		frontier_destroy(hh->cur);
+		hh->cur = NULL;
+	}
+
+	if (hh->next != NULL) {
+		frontier_destroy(hh->next);
+		hh->next = NULL;
+	}
+
+	if (hh->heap != NULL) {
+		heap_destroy(hh->heap);
+		hh->heap = NULL;
+	}
+
+	if (hh->candidates != NULL) {
+		candidates_destroy(hh->candidates);
+		hh->candidates = NULL;
 	}
 
 	if (hh->result.hitters != NULL) {
@@ -93,6 +152,8 @@ void hh_const_sketch_destroy(hh_const_sketch_t *restrict hh) {
 		hh->result.hitters = NULL;
 	}
 
+	heavy_hitter_estimates_free(&hh->estimates);
+
 	free(hh);
 	hh = NULL;
 }
@@ -102,6 +163,7 @@ void hh_const_sketch_update(hh_const_sketch_t *restrict hh, const uint32_t idx,
 		const int64_t c) {
 	int8_t i;
 	uint32_t off, offset, h, x, a, b;
+	int64_t est              = 0;
 	const uint8_t  exact_cnt = hh->exact_cnt;
 	const uint8_t  logm      = hh->logm;
 	const uint8_t  M         = hh->M;
@@ -110,27 +172,41 @@ void hh_const_sketch_update(hh_const_sketch_t *restrict hh, const uint32_t idx,
 	hash hash                = hh->hash->hash;
 
 	x      = idx;
-	offset = (2 << exact_cnt)-2;
+	offset = hh->exact_size;
 
-	sketch_update(hh->sketch, x, c);
+	// Read the leaf estimate while updating it
+	if ( hh->candidates != NULL ) {
+		est = sketch_update_point(hh->sketch, x, c);
+	} else {
+		sketch_update(hh->sketch, x, c);
+	}
 
 	// Use sketches to estimate count instead
 	for (i = logm-exact_cnt-1; i > -1; i--) {
 		off = offset + (2+w)*i;
 		a   = (uint64_t) tree[off];
 		b   = (uint64_t) tree[off + 1];
-		h   = hash(w, M, x, a, b);
+		h   = sketch_bucket(hash, w, M, hh->g, x, a, b);
 		tree[off + 2 + h] += c; 
 		x >>= 1;
 	}
 
 	// Update exact counts as long as |x| <= next_pow_2(wd)
 	for (i = exact_cnt-1; i > -1; i--) {
-		tree[x+(2 << i)-2] += c;
+		tree[layout_index(hh->layout, i+1, x)] += c;
 		x >>= 1;
 	}
 
 	hh->norm += c;
+
+	if ( hh->candidates != NULL ) {
+		if ( unlikely(exact_cnt == logm) ) {
+			est = tree[layout_index(hh->layout, logm, idx)];
+		}
+
+		candidates_update(hh->candidates, idx, c, est, 
+				hh->params->phi*hh->norm);
+	}
 }
 
 // Query
@@ -156,13 +232,13 @@ static void hh_const_sketch_query_bottom_recursive(
 
 	x *= 2;
 
-	offset = (1 << (exact_cnt +1))-2 + ((w+2) * layer);
+	offset = hh->exact_size + ((w+2) * layer);
 
 	for (i = 0; i < 2; i++) {
 		x += i;	
 		a = (uint64_t) tree[offset];
 		b = (uint64_t) tree[offset+1];
-		h = hash(w, M, x, a, b);
+		h = sketch_bucket(hash, w, M, hh->g, x, a, b);
 
 		// Plus one to get away from a and b
 		if ( tree[offset + 2 + h] >= th ) {
@@ -195,7 +271,7 @@ static void hh_const_sketch_query_top_recursive(hh_const_sketch_t *restrict hh,
 	for (i = 0; i < 2; i++) {
 		x += i;	
 
-		if ( tree[x+(1 << (layer+1))-2] >= th ) {
+		if ( tree[layout_index(hh->layout, layer+1, x)] >= th ) {
 			if ( unlikely(layer == logm-1) ) {
 				hh->result.hitters[hh->result.count] = x;
 
@@ -214,70 +290,287 @@ static void hh_const_sketch_query_top_recursive(hh_const_sketch_t *restrict hh,
 }
 
 
-heavy_hitter_t *hh_const_sketch_query(hh_const_sketch_t *restrict hh) {
-	uint32_t x, idx, offset, a, b, h;
-	uint8_t i, layer;
-	elm_t *res;
-	uint8_t  M               = hh->M;
-	uint32_t w               = hh->w;
-	uint8_t  exact_cnt       = hh->exact_cnt;
-	const uint8_t logm       = hh->logm;
-	const double threshold   = hh->params->phi*hh->norm;
+// Expands the children of the frontier cur at the given layer into next, 
+// keeping only those above the threshold. Where the parent is counted 
+// exactly, the children are scanned until the mass left of the parent cannot 
+// make another child heavy. This needs non-negative counts, so the children 
+// are all scanned over Count-Median, which is used for deletions.
+static void hh_const_sketch_expand(hh_const_sketch_t *restrict hh, 
+		const uint8_t layer, frontier_t *restrict cur, 
+		frontier_t *restrict next, const double threshold) {
+	uint32_t i, j, n, x, offset, a, b, h;
+	int64_t est, budget;
+	const uint8_t  M         = hh->M;
+	const uint32_t w         = hh->w;
+	const uint8_t  exact_cnt = hh->exact_cnt;
+	const bool     prune     = hh->prune;
 	uint64_t *restrict tree  = hh->tree;
-	fifo_t    *restrict fifo = hh->fifo;
 	hash hash                = hh->hash->hash;
 
+	n = 2*cur->count;
+
+	frontier_clear(next);
+	frontier_reserve(next, n);
+
+	if ( layer < exact_cnt ) {
+		for (i = 0; i < cur->count; i++) {
+			x      = cur->elm[i] << 1;
+			budget = cur->est[i];
+
+			for (j = 0; j < 2 && (!prune || budget >= threshold); j++) {
+				est     = tree[layout_index(hh->layout, layer+1, x+j)];
+				budget -= est;
+
+				if ( est >= threshold ) {
+					frontier_push_back(next, x+j, est);
+				}
+			}
+		}
+
+		return;
+	}
+
+	for (i = 0; i < cur->count; i++) { // branch=2
+		next->elm[2*i]   = cur->elm[i] << 1;
+		next->elm[2*i+1] = (cur->elm[i] << 1) + 1;
+	}
+
+	offset = hh->exact_size + ((w+2) * (layer-exact_cnt));
+	a      = (uint64_t) tree[offset];
+	b      = (uint64_t) tree[offset+1];
+
+	// Hash the whole level and prefetch the cells before reading them. The 
+	// cell index is temporarily stored in the estimate array.
+	for (i = 0; i < n; i++) {
+		// Plus two to get away from a and b
+		h            = offset + 2 + sketch_bucket(hash, w, M, hh->g, 
+				next->elm[i], a, b);
+		next->est[i] = h;
+
+		__builtin_prefetch(&tree[h], 0, 1);
+	}
+
+	for (i = 0, j = 0; i < n; i++) {
+		est = tree[next->est[i]];
+		if ( est >= threshold ) {
+			next->elm[j] = next->elm[i];
+			next->est[j] = est;
+			j++;
+		}
+	}
+	next->count = j;
+
+	// Verify the surviving leaves in the underlying sketch
+	if ( unlikely(layer == hh->logm-1) ) {
+		n = next->count;
+
+		sketch_points(hh->sketch, next->elm, next->est, n);
+
+		for (i = 0, j = 0; i < n; i++) {
+			if ( next->est[i] >= threshold ) {
+				next->elm[j] = next->elm[i];
+				next->est[j] = next->est[i];
+				j++;
+			}
+		}
+		next->count = j;
+	}
+}
+
+// Expand one whole level at a time, such that all point queries of a level 
+// are independent and can be batched. The surviving leaves and their 
+// estimates are left in hh->cur.
+static void hh_const_sketch_walk(hh_const_sketch_t *restrict hh, 
+		const double threshold) {
+	uint8_t layer;
+	const uint8_t logm       = hh->logm;
+	frontier_t *cur          = hh->cur;
+	frontier_t *next         = hh->next;
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, hh->norm);
+
+	for (layer = 0; layer < logm && cur->count > 0; layer++) {
+		hh_const_sketch_expand(hh, layer, cur, next, threshold);
+		frontier_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+}
+
+// Estimates the leaves without clamping them to their ancestors
+static void hh_const_sketch_leaves(hh_const_sketch_t *restrict hh, 
+		frontier_t *restrict leaves) {
+	uint32_t i;
+	const uint8_t logm       = hh->logm;
+
+	if ( hh->exact_cnt < logm ) {
+		sketch_points(hh->sketch, leaves->elm, leaves->est, leaves->count);
+	} else {
+		for (i = 0; i < leaves->count; i++) {
+			leaves->est[i] = hh->tree[layout_index(hh->layout, logm, 
+					leaves->elm[i])];
+		}
+	}
+}
+
+// In incremental mode only the candidates have to be validated, unless a 
+// negative update has invalidated them
+static void hh_const_sketch_find(hh_const_sketch_t *restrict hh, 
+		const double threshold) {
+	candidates_t *restrict cand = hh->candidates;
+
+	if ( cand != NULL && cand->valid ) {
+		candidates_collect(cand, hh->cur);
+		hh_const_sketch_leaves(hh, hh->cur);
+		candidates_retain(cand, hh->cur, threshold);
+	} else {
+		hh_const_sketch_walk(hh, threshold);
+
+		if ( cand != NULL ) {
+			candidates_reset(cand, hh->cur);
+		}
+	}
+}
+
+heavy_hitter_t *hh_const_sketch_query(hh_const_sketch_t *restrict hh) {
+	uint32_t i;
+	frontier_t *leaves;
+
 	hh->result.count         = 0;
 
 	memset(hh->result.hitters, '\0', hh->result.size); 
 
-	fifo_push_back(fifo, 0, 0);
+	hh_const_sketch_find(hh, hh->params->phi*hh->norm);
+	leaves = hh->cur;
 
-	while ( !fifo_empty(fifo) ) {
-		res   = fifo_pop_front(fifo);
-		idx   = res->elm;
-		layer = res->layer;
+	for (i = 0; i < leaves->count; i++) {
+		hh->result.hitters[hh->result.count] = leaves->elm[i];
 
-		for (i = 0; i < 2; i++) { // branch=2
-			x = idx+i;
+		assert( leaves->elm[i] <= hh->params->m );
 
-			if ( layer < exact_cnt ) {
-				if ( tree[x+(2 << layer)-2] >= threshold ) {
-					if ( unlikely(layer == logm-1) ) {
-						hh->result.hitters[hh->result.count] = x;
+		hh->result.count++;
 
-						assert( x <= hh->params->m );
+		hh_const_sketch_resize_result(&hh->result);
+	}
 
-						hh->result.count++;
+	return &hh->result;
+}
 
-						hh_const_sketch_resize_result(&hh->result);
-					} else {
-						fifo_push_back(fifo, x<<1, layer+1);
-					}
-				}
-			} else {
-				offset = (2 << exact_cnt)-2 + ((w+2) * (layer-exact_cnt));
-				a = (uint64_t) tree[offset];
-				b = (uint64_t) tree[offset+1];
-				h = hash(w, M, x, a, b);
-
-				// Plus two to get away from a and b
-				if ( tree[offset + 2 + h] >= threshold ) {
-					if ( unlikely( layer == logm-1 ) ) {
-						if ( sketch_above_thresshold(hh->sketch, x, 
-									threshold) ) {
-							hh->result.hitters[hh->result.count] = x;
-
-							assert( x <= hh->params->m );
-
-							hh->result.count++;
-
-							hh_const_sketch_resize_result(&hh->result);
-						}
-					} else {
-						fifo_push_back(fifo, x<<1, layer+1);
-					}
-				}
+// Walks the tree once at the lowest threshold, the estimates of the leaves 
+// are kept from the walk
+heavy_hitter_estimates_t *hh_const_sketch_query_thresholds(
+		hh_const_sketch_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	frontier_t *leaves;
+	const int64_t error = ( hh->exact_cnt < hh->logm ) ? 
+		ceil(hh->params->epsilon*hh->norm) : 0;
+
+	hh->estimates.count = 0;
+
+	hh_const_sketch_walk(hh, heavy_hitter_min_threshold(thresholds, n, hh->norm));
+	leaves = hh->cur;
+
+	for (i = 0; i < leaves->count; i++) {
+		heavy_hitter_estimates_push(&hh->estimates, leaves->elm[i], 
+				leaves->est[i], error);
+	}
+
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, hh->norm);
+
+	return &hh->estimates;
+}
+
+// Estimates all children of the node x at the given layer, clamped to the 
+// estimate of the node. Leaves are verified in the underlying sketch.
+static void hh_const_sketch_children(hh_const_sketch_t *restrict hh, 
+		const uint8_t layer, const uint32_t x, const int64_t est, 
+		frontier_t *restrict children) {
+	uint32_t j, offset, a, b;
+	int64_t e[2];
+	const uint8_t  exact_cnt = hh->exact_cnt;
+	const uint32_t w         = hh->w;
+	uint64_t *restrict tree  = hh->tree;
+
+	frontier_clear(children);
+	frontier_reserve(children, 2);
+
+	for (j = 0; j < 2; j++) { // branch=2
+		children->elm[j] = 2*x+j;
+	}
+	children->count = 2;
+
+	if ( layer < exact_cnt ) {
+		for (j = 0; j < 2; j++) {
+			children->est[j] = tree[layout_index(hh->layout, layer+1, 
+					children->elm[j])];
+		}
+	} else {
+		offset = hh->exact_size + ((w+2) * (layer-exact_cnt));
+		a      = (uint64_t) tree[offset];
+		b      = (uint64_t) tree[offset+1];
+
+		for (j = 0; j < 2; j++) {
+			children->est[j] = tree[offset + 2 + sketch_bucket(hh->hash->hash, 
+					w, hh->M, hh->g, children->elm[j], a, b)];
+		}
+
+		if ( unlikely(layer == hh->logm-1) ) {
+			sketch_points(hh->sketch, children->elm, e, 2);
+
+			for (j = 0; j < 2; j++) {
+				children->est[j] = (e[j] < children->est[j]) ? 
+					e[j] : children->est[j];
+			}
+		}
+	}
+
+	for (j = 0; j < 2; j++) {
+		children->est[j] = (children->est[j] < est) ? children->est[j] : est;
+	}
+}
+
+// Walks the tree best-first, always expanding the node with the largest 
+// estimate. Since no child is estimated above its parent, the leaves are 
+// popped in order of decreasing estimate, and the walk stops after k leaves.
+heavy_hitter_t *hh_const_sketch_topk(hh_const_sketch_t *restrict hh, 
+		const uint32_t k) {
+	uint32_t j, x;
+	uint8_t layer;
+	int64_t est;
+	node_t *node;
+	const uint8_t logm       = hh->logm;
+	heap_t *restrict heap    = hh->heap;
+	frontier_t *children     = hh->next;
+
+	hh->result.count         = 0;
+
+	heap_clear(heap);
+	heap_push(heap, 0, 0, hh->norm);
+
+	while ( hh->result.count < k && (node = heap_pop(heap)) != NULL ) {
+		x     = node->elm;
+		layer = node->layer;
+		est   = node->est;
+
+		if ( unlikely(layer == logm) ) {
+			hh->result.hitters[hh->result.count] = x;
+
+			assert( x <= hh->params->m );
+
+			hh->result.count++;
+
+			hh_const_sketch_resize_result(&hh->result);
+			continue;
+		}
+
+		hh_const_sketch_children(hh, layer, x, est, children);
+
+		for (j = 0; j < children->count; j++) {
+			if ( children->est[j] > 0 ) {
+				heap_push(heap, children->elm[j], layer+1, children->est[j]);
 			}
 		}
 	}
@@ -295,3 +588,31 @@ heavy_hitter_t *hh_const_sketch_query_recursive(hh_const_sketch_t *restrict hh)
 
 	return &hh->result;
 }
+
+// Snapshots
+void hh_const_sketch_save(hh_const_sketch_t *restrict hh, 
+		snapshot_t *restrict snap) {
+	const uint64_t size = hh->exact_size + 
+		(uint64_t)(2+hh->w)*(hh->logm-hh->exact_cnt);
+
+	snapshot_add(snap, "exact_cnt", 0, &hh->exact_cnt, sizeof(uint8_t));
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "tree", 0, hh->tree, sizeof(uint64_t) * size);
+	sketch_save(hh->sketch, snap, 0);
+}
+
+void hh_const_sketch_load(hh_const_sketch_t *restrict hh, 
+		snapshot_t *restrict snap) {
+	const uint64_t size = hh->exact_size + 
+		(uint64_t)(2+hh->w)*(hh->logm-hh->exact_cnt);
+
+	snapshot_check(snap, "exact_cnt", 0, &hh->exact_cnt, sizeof(uint8_t));
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "tree", 0, hh->tree, sizeof(uint64_t) * size);
+	sketch_load(hh->sketch, snap, 0);
+
+	// Candidates are not saved, the next query walks the tree
+	if ( hh->candidates != NULL ) {
+		hh->candidates->valid = false;
+	}
+}
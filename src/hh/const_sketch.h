@@ -2,12 +2,16 @@
 #define H_hh_const_sketch
 
 // Standard libraries
+#include <stdbool.h>
 #include <stdint.h>
 
 // User defined libraries
 #include "hh/hh.h"
+#include "hh/candidates.h"
 #include "sketch/sketch.h"
-#include "util/fifo.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
 #include "util/hash.h"
 
 // Structures
@@ -17,6 +21,14 @@ typedef struct {
 	double          delta;
 	uint32_t        m;
 	uint32_t        b;
+	uint8_t         exact;       // Exactly counted top layers, 0 chooses them
+	                             // by the cache cost model
+	bool            incremental; // Maintain heavy hitter candidates during 
+	                             // updates, valid for non-negative updates
+	bool            colocate;    // Place the children of a node in one 
+	                             // block of every sketched row
+	hh_crossing     crossing;    // Called when an item becomes a candidate
+	void           *arg;         // Passed to crossing
 	sketch_func_t *f;
 } hh_const_sketch_params_t;
 
@@ -25,13 +37,24 @@ typedef struct {
 	sketch_t                 *restrict sketch;
 	hash_t                   *restrict hash;
 	uint8_t                   exact_cnt;
+	uint32_t                  exact_size; // Slots of the exact layers, the 
+	                                      // sketched rows follow them
+	layout_t                 *restrict layout;
 	uint32_t                  w;
 	uint8_t                   M;
+	uint8_t                   g;          // Sibling bits, see sketch_bucket
 	uint8_t                   logm;
+	bool                      prune;      // Scans of exact children stop 
+	                                      // once the mass of the parent is 
+	                                      // used up
 	uint64_t                  norm;
 	hh_const_sketch_params_t *restrict params;
-	fifo_t                   *restrict fifo;
+	frontier_t               *restrict cur;
+	frontier_t               *restrict next;
+	heap_t                   *restrict heap;
+	candidates_t             *restrict candidates;
 	heavy_hitter_t            result;
+	heavy_hitter_estimates_t  estimates;
 } hh_const_sketch_t; 
 
 // Initialization
@@ -46,6 +69,17 @@ void hh_const_sketch_update(hh_const_sketch_t *restrict hh, const uint32_t idx,
 
 // Query
 heavy_hitter_t *hh_const_sketch_query(hh_const_sketch_t *restrict hh);
+heavy_hitter_t *hh_const_sketch_topk(hh_const_sketch_t *restrict hh,
+		const uint32_t k);
+heavy_hitter_estimates_t *hh_const_sketch_query_thresholds(
+		hh_const_sketch_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
 heavy_hitter_t *hh_const_sketch_query_recursive(hh_const_sketch_t *restrict hh);
 
+// Snapshots
+void hh_const_sketch_save(hh_const_sketch_t *restrict hh, 
+		snapshot_t *restrict snap);
+void hh_const_sketch_load(hh_const_sketch_t *restrict hh, 
+		snapshot_t *restrict snap);
+
 #endif
@@ -128,8 +128,11 @@ CMH_type *hh_cormode_cmh_create(heavy_hitter_params_t *restrict p) {
 	fprintf(stderr, "Space CORMODE: %d\n", CMH_Size(cmh));
 #endif
 
-	cmh->phi = params->phi;
-	cmh->L1  = 0;
+	cmh->phi     = params->phi;
+	cmh->epsilon = params->epsilon;
+	cmh->L1      = 0;
+
+	heavy_hitter_estimates_init(&cmh->estimates, ceil(2./params->phi));
 
 	return cmh;
 }
@@ -142,6 +145,7 @@ void hh_cormode_cmh_destroy(CMH_type *restrict cmh) {
 ///////////////////////////////////////////////////////////////////////////////
 	int i;
 	if (!cmh) return;
+	heavy_hitter_estimates_free(&cmh->estimates);
 	for (i=0;i<cmh->levels;i++)
 	{
 		if (i>=cmh->freelim)
@@ -199,13 +203,13 @@ void hh_cormode_cmh_update(CMH_type *restrict cmh, const uint32_t idx,
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-static int CMH_count(CMH_type * cmh, int depth, int item)
+static int64_t CMH_count(CMH_type * cmh, int depth, unsigned int item)
 {
 	// return an estimate of item at level depth
 
 	int j;
 	int offset;
-	int estimate;
+	int64_t estimate;
 
 	if (depth>=cmh->levels) return(cmh->count);
 	if (depth>=cmh->freelim)
@@ -296,3 +300,85 @@ heavy_hitter_t *hh_cormode_cmh_query(CMH_type *restrict cmh) {
 
 	return hitters;
 }
+
+// Descends like CMH_recursive, but keeps the estimates of the leaves
+static void hh_cormode_cmh_descend(CMH_type *restrict cmh, const int depth, 
+		const uint32_t start, const double threshold, const int64_t error) {
+	int i;
+	const int64_t est = CMH_count(cmh, depth, start);
+
+	if ( est < threshold ) {
+		return;
+	}
+
+	if ( depth == 0 ) {
+		heavy_hitter_estimates_push(&cmh->estimates, start, est, error);
+		return;
+	}
+
+	for (i = 0; i < (1 << cmh->gran); i++) {
+		hh_cormode_cmh_descend(cmh, depth-1, (start << cmh->gran)+i, 
+				threshold, error);
+	}
+}
+
+heavy_hitter_estimates_t *hh_cormode_cmh_query_thresholds(
+		CMH_type *restrict cmh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	const int64_t error = ( cmh->freelim > 0 ) ? 
+		ceil(cmh->epsilon*cmh->L1) : 0;
+
+	cmh->estimates.count = 0;
+
+	hh_cormode_cmh_descend(cmh, cmh->levels, 0, 
+			heavy_hitter_min_threshold(thresholds, n, cmh->L1), error);
+
+	heavy_hitter_estimates_finish(&cmh->estimates, thresholds, n, cmh->L1);
+
+	return &cmh->estimates;
+}
+
+// Snapshots, every level is a section, exact levels hold no hashes
+void hh_cormode_cmh_save(CMH_type *restrict cmh, snapshot_t *restrict snap) {
+	int i;
+	const uint64_t row = sizeof(unsigned int) * cmh->depth;
+
+	snapshot_add(snap, "freelim", 0, &cmh->freelim, sizeof(int));
+	snapshot_add(snap, "count", 0, &cmh->count, sizeof(int64_t));
+	snapshot_add(snap, "L1", 0, &cmh->L1, sizeof(int));
+
+	for (i = 0; i < cmh->levels; i++) {
+		if ( i >= cmh->freelim ) {
+			snapshot_add(snap, "counts", i, cmh->counts[i], sizeof(int64_t) * 
+					((uint64_t)1 << (cmh->gran*(cmh->levels-i))));
+			continue;
+		}
+
+		snapshot_add(snap, "counts", i, cmh->counts[i], 
+				sizeof(int64_t) * cmh->depth * cmh->width);
+		snapshot_add(snap, "hasha", i, cmh->hasha[i], row);
+		snapshot_add(snap, "hashb", i, cmh->hashb[i], row);
+	}
+}
+
+void hh_cormode_cmh_load(CMH_type *restrict cmh, snapshot_t *restrict snap) {
+	int i;
+	const uint64_t row = sizeof(unsigned int) * cmh->depth;
+
+	snapshot_check(snap, "freelim", 0, &cmh->freelim, sizeof(int));
+	snapshot_read(snap, "count", 0, &cmh->count, sizeof(int64_t));
+	snapshot_read(snap, "L1", 0, &cmh->L1, sizeof(int));
+
+	for (i = 0; i < cmh->levels; i++) {
+		if ( i >= cmh->freelim ) {
+			snapshot_read(snap, "counts", i, cmh->counts[i], sizeof(int64_t) * 
+					((uint64_t)1 << (cmh->gran*(cmh->levels-i))));
+			continue;
+		}
+
+		snapshot_read(snap, "counts", i, cmh->counts[i], 
+				sizeof(int64_t) * cmh->depth * cmh->width);
+		snapshot_read(snap, "hasha", i, cmh->hasha[i], row);
+		snapshot_read(snap, "hashb", i, cmh->hashb[i], row);
+	}
+}
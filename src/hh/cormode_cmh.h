@@ -27,6 +27,8 @@ typedef struct CMH_type{
   unsigned int **hasha, **hashb;
   int L1;
   double phi;
+  double epsilon;
+  heavy_hitter_estimates_t estimates;
 } CMH_type;
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -42,5 +44,12 @@ void hh_cormode_cmh_update(CMH_type *restrict hh, const uint32_t idx,
 
 // Query
 heavy_hitter_t *hh_cormode_cmh_query(CMH_type *restrict hh);
+heavy_hitter_estimates_t *hh_cormode_cmh_query_thresholds(
+		CMH_type *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_cormode_cmh_save(CMH_type *restrict cmh, snapshot_t *restrict snap);
+void hh_cormode_cmh_load(CMH_type *restrict cmh, snapshot_t *restrict snap);
 
 #endif
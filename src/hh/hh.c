@@ -1,42 +1,165 @@
 // Standard libraries
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 
 // User defined libraries
 #include "hh/hh.h"
+#include "hh/adaptive.h"
+#include "hh/cgt.h"
 #include "hh/const_sketch.h"
 #include "hh/cormode_cmh.h"
 #include "hh/ktree.h"
+#include "hh/ktree64.h"
+#include "hh/shared_sketch.h"
+#include "hh/sample.h"
+#include "hh/sparse.h"
 #include "hh/sketch.h"
+#include "hh/window.h"
 #include "util/xutil.h"
 
 hh_func_t hh_sketch = {
-	.create     = (hh_create)  hh_sketch_create,
-	.destroy    = (hh_destroy) hh_sketch_destroy,
-	.update     = (hh_update)  hh_sketch_update,
-	.query      = (hh_query)   hh_sketch_query,
-//	.query      = (hh_query)   hh_sketch_query_recursive,
+	.create     = (hh_create)     hh_sketch_create,
+	.destroy    = (hh_destroy)    hh_sketch_destroy,
+	.update     = (hh_update)     hh_sketch_update,
+	.query      = (hh_query)      hh_sketch_query,
+	.topk       = (hh_topk)       hh_sketch_topk,
+	.thresholds = (hh_thresholds) hh_sketch_query_thresholds,
+	.hhh        = (hh_hhh)        hh_sketch_query_hhh,
+	.save       = (hh_save)       hh_sketch_save,
+	.load       = (hh_load)       hh_sketch_load,
+	.name       = "sketch",
+//	.query      = (hh_query)      hh_sketch_query_recursive,
 };
 
 hh_func_t hh_const_sketch = {
-	.create   = (hh_create)  hh_const_sketch_create,
-	.destroy  = (hh_destroy) hh_const_sketch_destroy,
-	.update   = (hh_update)  hh_const_sketch_update,
-	.query    = (hh_query)   hh_const_sketch_query,
-//	.query    = (hh_query)   hh_const_sketch_query_recursive,
+	.create     = (hh_create)     hh_const_sketch_create,
+	.destroy    = (hh_destroy)    hh_const_sketch_destroy,
+	.update     = (hh_update)     hh_const_sketch_update,
+	.query      = (hh_query)      hh_const_sketch_query,
+	.topk       = (hh_topk)       hh_const_sketch_topk,
+	.thresholds = (hh_thresholds) hh_const_sketch_query_thresholds,
+	.save       = (hh_save)       hh_const_sketch_save,
+	.load       = (hh_load)       hh_const_sketch_load,
+	.name       = "const_sketch",
+//	.query      = (hh_query)      hh_const_sketch_query_recursive,
 };
 
 hh_func_t hh_cormode_cmh = {
-	.create   = (hh_create)  hh_cormode_cmh_create,
-	.destroy  = (hh_destroy) hh_cormode_cmh_destroy,
-	.update   = (hh_update)  hh_cormode_cmh_update,
-	.query    = (hh_query)   hh_cormode_cmh_query,
+	.create     = (hh_create)     hh_cormode_cmh_create,
+	.destroy    = (hh_destroy)    hh_cormode_cmh_destroy,
+	.update     = (hh_update)     hh_cormode_cmh_update,
+	.query      = (hh_query)      hh_cormode_cmh_query,
+	.topk       = NULL,
+	.thresholds = (hh_thresholds) hh_cormode_cmh_query_thresholds,
+	.save       = (hh_save)       hh_cormode_cmh_save,
+	.load       = (hh_load)       hh_cormode_cmh_load,
+	.name       = "cormode_cmh",
 };
 
 hh_func_t hh_ktree = {
-	.create   = (hh_create)  hh_ktree_create,
-	.destroy  = (hh_destroy) hh_ktree_destroy,
-	.update   = (hh_update)  hh_ktree_update,
-	.query    = (hh_query)   hh_ktree_query,
+	.create     = (hh_create)     hh_ktree_create,
+	.destroy    = (hh_destroy)    hh_ktree_destroy,
+	.update     = (hh_update)     hh_ktree_update,
+	.query      = (hh_query)      hh_ktree_query,
+	.topk       = (hh_topk)       hh_ktree_topk,
+	.thresholds = (hh_thresholds) hh_ktree_query_thresholds,
+	.hhh        = (hh_hhh)        hh_ktree_query_hhh,
+	.save       = (hh_save)       hh_ktree_save,
+	.load       = (hh_load)       hh_ktree_load,
+	.name       = "ktree",
+};
+
+hh_func_t hh_shared_sketch = {
+	.create     = (hh_create)     hh_shared_sketch_create,
+	.destroy    = (hh_destroy)    hh_shared_sketch_destroy,
+	.update     = (hh_update)     hh_shared_sketch_update,
+	.query      = (hh_query)      hh_shared_sketch_query,
+	.topk       = (hh_topk)       hh_shared_sketch_topk,
+	.thresholds = (hh_thresholds) hh_shared_sketch_query_thresholds,
+	.save       = (hh_save)       hh_shared_sketch_save,
+	.load       = (hh_load)       hh_shared_sketch_load,
+	.name       = "shared_sketch",
+};
+
+hh_func_t hh_cgt = {
+	.create     = (hh_create)     hh_cgt_create,
+	.destroy    = (hh_destroy)    hh_cgt_destroy,
+	.update     = (hh_update)     hh_cgt_update,
+	.query      = (hh_query)      hh_cgt_query,
+	.topk       = (hh_topk)       hh_cgt_topk,
+	.thresholds = (hh_thresholds) hh_cgt_query_thresholds,
+	.save       = (hh_save)       hh_cgt_save,
+	.load       = (hh_load)       hh_cgt_load,
+	.name       = "cgt",
+};
+
+// Exact until the wrapped engine is needed
+hh_func_t hh_sparse = {
+	.create     = (hh_create)     hh_sparse_create,
+	.destroy    = (hh_destroy)    hh_sparse_destroy,
+	.update     = (hh_update)     hh_sparse_update,
+	.query      = (hh_query)      hh_sparse_query,
+	.topk       = (hh_topk)       hh_sparse_topk,
+	.thresholds = (hh_thresholds) hh_sparse_query_thresholds,
+	.save       = (hh_save)       hh_sparse_save,
+	.load       = (hh_load)       hh_sparse_load,
+	.name       = "sparse",
+};
+
+// Forwards a sample of the updates
+hh_func_t hh_sample = {
+	.create     = (hh_create)     hh_sample_create,
+	.destroy    = (hh_destroy)    hh_sample_destroy,
+	.update     = (hh_update)     hh_sample_update,
+	.query      = (hh_query)      hh_sample_query,
+	.topk       = (hh_topk)       hh_sample_topk,
+	.thresholds = (hh_thresholds) hh_sample_query_thresholds,
+	.save       = (hh_save)       hh_sample_save,
+	.load       = (hh_load)       hh_sample_load,
+	.name       = "sample",
+};
+
+// Last epochs of the stream
+hh_func_t hh_window = {
+	.create     = (hh_create)     hh_window_create,
+	.destroy    = (hh_destroy)    hh_window_destroy,
+	.update     = (hh_update)     hh_window_update,
+	.query      = (hh_query)      hh_window_query,
+	.topk       = NULL,
+	.thresholds = (hh_thresholds) hh_window_query_thresholds,
+	.save       = (hh_save)       hh_window_save,
+	.load       = (hh_load)       hh_window_load,
+	.name       = "window",
+};
+
+// Chooses among the engines above by a sample of the stream
+hh_func_t hh_adaptive = {
+	.create     = (hh_create)     hh_adaptive_create,
+	.destroy    = (hh_destroy)    hh_adaptive_destroy,
+	.update     = (hh_update)     hh_adaptive_update,
+	.query      = (hh_query)      hh_adaptive_query,
+	.topk       = (hh_topk)       hh_adaptive_topk,
+	.thresholds = (hh_thresholds) hh_adaptive_query_thresholds,
+	.save       = (hh_save)       hh_adaptive_save,
+	.load       = (hh_load)       hh_adaptive_load,
+	.name       = "adaptive",
+};
+
+// Keys of 64 bits only
+hh_func_t hh_ktree64 = {
+	.create     = (hh_create)     hh_ktree64_create,
+	.destroy    = (hh_destroy)    hh_ktree64_destroy,
+	.update     = NULL,
+	.query      = NULL,
+	.topk       = NULL,
+	.thresholds = NULL,
+	.update64   = (hh_update64)   hh_ktree64_update,
+	.query64    = (hh_query64)    hh_ktree64_query,
+	.save       = (hh_save)       hh_ktree64_save,
+	.load       = (hh_load)       hh_ktree64_load,
+	.name       = "ktree64",
 };
 
 hh_t *heavy_hitter_create(heavy_hitter_params_t *restrict params) {
@@ -48,6 +171,54 @@ hh_t *heavy_hitter_create(heavy_hitter_params_t *restrict params) {
 	return hh;
 }
 
+void heavy_hitter_snapshot_save(hh_t *restrict hh, snapshot_t *restrict snap) {
+	const char *name = hh->funcs->name;
+
+	if ( hh->funcs->save == NULL ) {
+		xerror("The engine has no snapshots.", __LINE__, __FILE__);
+	}
+
+	snapshot_add(snap, "engine", 0, name, strlen(name)+1);
+	hh->funcs->save(hh->hh, snap);
+}
+
+void heavy_hitter_snapshot_load(hh_t *restrict hh, snapshot_t *restrict snap) {
+	const char *name = hh->funcs->name;
+
+	if ( hh->funcs->load == NULL ) {
+		xerror("The engine has no snapshots.", __LINE__, __FILE__);
+	}
+
+	snapshot_check(snap, "engine", 0, name, strlen(name)+1);
+	hh->funcs->load(hh->hh, snap);
+}
+
+void heavy_hitter_save(hh_t *restrict hh, const char *path) {
+	snapshot_t *restrict snap = snapshot_create(hh->funcs->name);
+
+	heavy_hitter_snapshot_save(hh, snap);
+	snapshot_write(snap, path);
+
+	snapshot_destroy(snap);
+}
+
+hh_t *heavy_hitter_load(heavy_hitter_params_t *restrict params,
+		const char *path) {
+	snapshot_t *restrict snap = snapshot_open(path);
+	hh_t *hh;
+
+	if ( strncmp(snap->engine, params->f->name, SNAPSHOT_NAME) != 0 ) {
+		xerror("Snapshot of another engine.", __LINE__, __FILE__);
+	}
+
+	hh = heavy_hitter_create(params);
+	heavy_hitter_snapshot_load(hh, snap);
+
+	snapshot_destroy(snap);
+
+	return hh;
+}
+
 void heavy_hitter_destroy(hh_t *restrict hh) {
 	if (hh == NULL) {
 		return;
@@ -60,10 +231,253 @@ void heavy_hitter_destroy(hh_t *restrict hh) {
 }
 
 void heavy_hitter_update(hh_t *restrict hh, const uint32_t i, const int64_t c) {
+	if ( unlikely(hh->funcs->update == NULL) ) {
+		xerror("Updates are not supported by the heavy hitter implementation", 
+				__LINE__, __FILE__);
+	}
+
 	hh->funcs->update(hh->hh, i, c);
 }
 
+void heavy_hitter_update64(hh_t *restrict hh, const uint64_t i, 
+		const int64_t c) {
+	if ( unlikely(hh->funcs->update64 == NULL) ) {
+		xerror("64-bit keys are not supported by the heavy hitter "
+				"implementation", __LINE__, __FILE__);
+	}
+
+	hh->funcs->update64(hh->hh, i, c);
+}
+
 heavy_hitter_t *heavy_hitter_query(hh_t *restrict hh) {
+	if ( unlikely(hh->funcs->query == NULL) ) {
+		xerror("Queries are not supported by the heavy hitter implementation", 
+				__LINE__, __FILE__);
+	}
+
 	return hh->funcs->query(hh->hh);
 }
 
+heavy_hitter64_t *heavy_hitter_query64(hh_t *restrict hh) {
+	if ( unlikely(hh->funcs->query64 == NULL) ) {
+		xerror("64-bit keys are not supported by the heavy hitter "
+				"implementation", __LINE__, __FILE__);
+	}
+
+	return hh->funcs->query64(hh->hh);
+}
+
+
+heavy_hitter_t *heavy_hitter_topk(hh_t *restrict hh, const uint32_t k) {
+	if ( unlikely(hh->funcs->topk == NULL) ) {
+		xerror("Top-k is not supported by the heavy hitter implementation", 
+				__LINE__, __FILE__);
+	}
+
+	return hh->funcs->topk(hh->hh, k);
+}
+
+heavy_hitter_estimates_t *heavy_hitter_query_threshold(hh_t *restrict hh, 
+		const heavy_hitter_threshold_t threshold) {
+	return heavy_hitter_query_thresholds(hh, &threshold, 1);
+}
+
+heavy_hitter_estimates_t *heavy_hitter_query_thresholds(hh_t *restrict hh, 
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	if ( unlikely(n == 0) ) {
+		xerror("At least one threshold is required", __LINE__, __FILE__);
+	}
+
+	if ( unlikely(hh->funcs->thresholds == NULL) ) {
+		xerror("Thresholds are not supported by the heavy hitter "
+				"implementation", __LINE__, __FILE__);
+	}
+
+	return hh->funcs->thresholds(hh->hh, thresholds, n);
+}
+
+heavy_hitter_hhh_t *heavy_hitter_query_hhh(hh_t *restrict hh, 
+		const double phi) {
+	if ( unlikely(hh->funcs->hhh == NULL) ) {
+		xerror("Hierarchical heavy hitters are not supported by the heavy "
+				"hitter implementation", __LINE__, __FILE__);
+	}
+
+	return hh->funcs->hhh(hh->hh, phi);
+}
+
+extern inline double heavy_hitter_threshold(
+		const heavy_hitter_threshold_t threshold, const uint64_t norm);
+extern inline double heavy_hitter_layer_epsilon(const double epsilon, 
+		const uint32_t b, const uint64_t nodes, const double phi);
+
+double heavy_hitter_min_threshold(
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n,
+		const uint64_t norm) {
+	uint32_t i;
+	double th, min = heavy_hitter_threshold(thresholds[0], norm);
+
+	for (i = 1; i < n; i++) {
+		th  = heavy_hitter_threshold(thresholds[i], norm);
+		min = (th < min) ? th : min;
+	}
+
+	return min;
+}
+
+void heavy_hitter_estimates_init(heavy_hitter_estimates_t *restrict res, 
+		const uint32_t size) {
+	res->count       = 0;
+	res->size        = (size > 0) ? size : 1;
+	res->hitters     = xmalloc(res->size * sizeof(hitter_t));
+	res->nested_size = 1;
+	res->nested      = xmalloc(res->nested_size * sizeof(uint32_t));
+}
+
+void heavy_hitter_estimates_free(heavy_hitter_estimates_t *restrict res) {
+	if (res->hitters != NULL) {
+		free(res->hitters);
+		res->hitters = NULL;
+	}
+
+	if (res->nested != NULL) {
+		free(res->nested);
+		res->nested = NULL;
+	}
+}
+
+void heavy_hitter_estimates_push(heavy_hitter_estimates_t *restrict res, 
+		const uint32_t id, const int64_t count, const int64_t error) {
+	if ( unlikely(res->count >= res->size) ) { 
+		res->size   += res->size;
+		res->hitters = xrealloc(res->hitters, res->size*sizeof(hitter_t));
+	}
+
+	res->hitters[res->count].id    = id;
+	res->hitters[res->count].count = count;
+	res->hitters[res->count].error = error;
+	res->count++;
+}
+
+static int heavy_hitter_compare(const void *a, const void *b) {
+	const hitter_t *x = (const hitter_t *)a;
+	const hitter_t *y = (const hitter_t *)b;
+
+	if (x->count != y->count) {
+		return (x->count > y->count) ? -1 : 1;
+	}
+
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+// Sorts the hitters found at the lowest threshold and counts how many of 
+// them are above each of the thresholds
+void heavy_hitter_estimates_finish(heavy_hitter_estimates_t *restrict res, 
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n, 
+		const uint64_t norm) {
+	uint32_t i, j;
+	double th;
+
+	qsort(res->hitters, res->count, sizeof(hitter_t), heavy_hitter_compare);
+
+	if ( unlikely(n > res->nested_size) ) {
+		res->nested_size = n;
+		res->nested      = xrealloc(res->nested, n*sizeof(uint32_t));
+	}
+
+	for (i = 0; i < n; i++) {
+		th = heavy_hitter_threshold(thresholds[i], norm);
+
+		for (j = 0; j < res->count && res->hitters[j].count >= th; j++) {
+		}
+
+		res->nested[i] = j;
+	}
+}
+
+void heavy_hitter_hhh_init(heavy_hitter_hhh_t *restrict res, 
+		const uint32_t size) {
+	res->count   = 0;
+	res->bits    = 0;
+	res->size    = (size > 0) ? size : 1;
+	res->hitters = xmalloc(res->size * sizeof(hhh_t));
+}
+
+void heavy_hitter_hhh_free(heavy_hitter_hhh_t *restrict res) {
+	if (res->hitters != NULL) {
+		free(res->hitters);
+		res->hitters = NULL;
+	}
+}
+
+static void heavy_hitter_hhh_push(heavy_hitter_hhh_t *restrict res, 
+		const uint32_t prefix, const uint8_t bits, const int64_t count, 
+		const int64_t discounted) {
+	if ( unlikely(res->count >= res->size) ) { 
+		res->size   += res->size;
+		res->hitters = xrealloc(res->hitters, res->size*sizeof(hhh_t));
+	}
+
+	res->hitters[res->count].prefix     = prefix;
+	res->hitters[res->count].bits       = bits;
+	res->hitters[res->count].count      = count;
+	res->hitters[res->count].discounted = discounted;
+	res->count++;
+}
+
+// The heavy prefixes of depth d are levels[offsets[d], offsets[d+1]), sorted, 
+// and grans[d] bits extend a prefix of depth d to depth d+1. Since a prefix 
+// below the threshold has no heavy descendants, every heavy prefix has its 
+// parent in the level above. From the leaves up, every prefix passes to its 
+// parent its count if it is a hierarchical heavy hitter, or else the count 
+// of the hierarchical heavy hitters below it.
+void heavy_hitter_hhh_finish(heavy_hitter_hhh_t *restrict res, 
+		const frontier_t *restrict levels, const uint32_t *restrict offsets,
+		const uint8_t *restrict grans, const uint8_t depths, 
+		const double threshold) {
+	uint32_t i, p;
+	uint32_t parent;
+	uint8_t d, bits[depths];
+	int64_t discounted;
+	int64_t *restrict covered = xmalloc( (offsets[depths]+1)*sizeof(int64_t) );
+
+	memset(covered, '\0', (offsets[depths]+1)*sizeof(int64_t));
+
+	for (d = 1, bits[0] = 0; d < depths; d++) {
+		bits[d] = bits[d-1] + grans[d-1];
+	}
+
+	res->count = 0;
+	res->bits  = bits[depths-1];
+
+	for (d = depths-1; d > 0; d--) {
+		p = offsets[d-1];
+
+		for (i = offsets[d]; i < offsets[d+1]; i++) {
+			parent = levels->elm[i] >> grans[d-1];
+
+			while ( levels->elm[p] != parent ) {
+				p++;
+			}
+
+			assert( p < offsets[d] );
+
+			discounted  = levels->est[i] - covered[i];
+			covered[p] += (discounted >= threshold) ? 
+				levels->est[i] : covered[i];
+		}
+	}
+
+	for (d = depths; d > 0; d--) {
+		for (i = offsets[d-1]; i < offsets[d]; i++) {
+			discounted = levels->est[i] - covered[i];
+
+			if ( discounted >= threshold ) {
+				heavy_hitter_hhh_push(res, levels->elm[i], bits[d-1], 
+						levels->est[i], discounted);
+			}
+		}
+	}
+
+	free(covered);
+}
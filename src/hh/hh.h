@@ -2,9 +2,12 @@
 #define H_hh
 
 #include <stdint.h>
+#include <stdbool.h>
 
 // User defined libraries
 #include "util/hash.h"
+#include "util/frontier.h"
+#include "util/snapshot.h"
 
 typedef struct {
 	uint32_t *restrict hitters;
@@ -12,16 +15,82 @@ typedef struct {
 	uint32_t size;
 } heavy_hitter_t;
 
+typedef struct {
+	uint64_t *restrict hitters;
+	uint32_t count;
+	uint32_t size;
+} heavy_hitter64_t;
+
+typedef struct {
+	uint32_t id;
+	int64_t  count; // Estimated count
+	int64_t  error; // Bound on the error of the estimate, 0 if exact
+} hitter_t;
+
+// Hitters are sorted by decreasing count, such that the hitters above the 
+// i'th threshold are the first nested[i] hitters
+typedef struct {
+	hitter_t *restrict hitters;
+	uint32_t count;
+	uint32_t size;
+	uint32_t *restrict nested;
+	uint32_t nested_size;
+} heavy_hitter_estimates_t;
+
+// A hierarchical heavy hitter, a prefix of the given bits whose count stays 
+// heavy after discounting the counts of the hierarchical heavy hitters below it
+typedef struct {
+	uint32_t prefix;
+	uint8_t  bits;       // Bits of the prefix, 0 is the root
+	int64_t  count;      // Estimated count of the prefix
+	int64_t  discounted; // Count not covered by heavy prefixes below it
+} hhh_t;
+
+// Sorted by decreasing bits, then by prefix
+typedef struct {
+	hhh_t   *restrict hitters;
+	uint32_t count;
+	uint32_t size;
+	uint8_t  bits;        // Bits of the leaves
+} heavy_hitter_hhh_t;
+
+// A threshold on the counts, absolute or a fraction of the norm
+typedef struct {
+	double value;
+	bool   absolute;
+} heavy_hitter_threshold_t;
+
+// Called with the item and its estimate when the item becomes heavy during an
+// update of an incremental engine
+typedef void(*hh_crossing)(void *arg, const uint32_t idx, const int64_t est);
+
 typedef void*(*hh_create)(void *restrict params);
 typedef void(*hh_destroy)(void *restrict hh);
 typedef void(*hh_update)(void *restrict hh, const uint32_t idx, const int64_t c);
 typedef heavy_hitter_t*(*hh_query)();
+typedef heavy_hitter_t*(*hh_topk)(void *restrict hh, const uint32_t k);
+typedef heavy_hitter_estimates_t*(*hh_thresholds)(void *restrict hh, 
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+typedef heavy_hitter_hhh_t*(*hh_hhh)(void *restrict hh, const double phi);
+typedef void(*hh_update64)(void *restrict hh, const uint64_t idx, 
+		const int64_t c);
+typedef heavy_hitter64_t*(*hh_query64)(void *restrict hh);
+typedef void(*hh_save)(void *restrict hh, snapshot_t *restrict snap);
+typedef void(*hh_load)(void *restrict hh, snapshot_t *restrict snap);
 
 typedef struct {
 	hh_create   create;
 	hh_destroy  destroy;
 	hh_update   update;
 	hh_query    query;
+	hh_topk     topk;
+	hh_thresholds thresholds;
+	hh_hhh      hhh;      // NULL if not supported
+	hh_update64 update64; // 64-bit keys, NULL if not supported
+	hh_query64  query64;
+	hh_save     save;     // Adds the tables of the engine to a snapshot
+	hh_load     load;     // Reads them into an engine of the same params
+	const char *name;     // Of the engine in its snapshots
 } hh_func_t;
 
 typedef struct {
@@ -43,12 +112,84 @@ void heavy_hitter_destroy(hh_t *restrict hh);
 // Update
 void heavy_hitter_update(hh_t *restrict hh, const uint32_t idx, const int64_t c);
 
+void heavy_hitter_update64(hh_t *restrict hh, const uint64_t idx, 
+		const int64_t c);
+
 // Query
 heavy_hitter_t *heavy_hitter_query(hh_t *restrict hh);
+heavy_hitter64_t *heavy_hitter_query64(hh_t *restrict hh);
+heavy_hitter_t *heavy_hitter_topk(hh_t *restrict hh, const uint32_t k);
+
+heavy_hitter_estimates_t *heavy_hitter_query_threshold(hh_t *restrict hh, 
+		const heavy_hitter_threshold_t threshold);
+heavy_hitter_estimates_t *heavy_hitter_query_thresholds(hh_t *restrict hh, 
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Heavy prefixes at every level of the tree in a single walk, phi is a 
+// fraction of the norm
+heavy_hitter_hhh_t *heavy_hitter_query_hhh(hh_t *restrict hh, 
+		const double phi);
+
+// Snapshot of the state of the engine, written as a whole to path
+void heavy_hitter_save(hh_t *restrict hh, const char *path);
+
+// Engine created from params holding the state saved to path, which must be
+// of the same engine and params
+hh_t *heavy_hitter_load(heavy_hitter_params_t *restrict params,
+		const char *path);
+
+// Sections of an engine nested in another one
+void heavy_hitter_snapshot_save(hh_t *restrict hh, snapshot_t *restrict snap);
+void heavy_hitter_snapshot_load(hh_t *restrict hh, snapshot_t *restrict snap);
+
+// Shared by the implementations
+inline double heavy_hitter_threshold(const heavy_hitter_threshold_t threshold,
+		const uint64_t norm) {
+	return threshold.absolute ? threshold.value : threshold.value*norm;
+}
+
+// Epsilon of a sketched inner layer with the given amount of prefixes. A row 
+// of more than twice as many counters as prefixes spreads them no further.
+// An inner layer only prunes the walk, and a one-sided sketch drops no heavy
+// prefix at any width, so at phi/2 the walk keeps the at most 2/phi prefixes
+// above half the threshold. phi is 0 for sketches erring either way.
+inline double heavy_hitter_layer_epsilon(const double epsilon, 
+		const uint32_t b, const uint64_t nodes, const double phi) {
+	const double capped = (double)b / (2.*nodes);
+	const double pruned = (capped > phi/2) ? capped : phi/2;
+
+	return (pruned > epsilon) ? pruned : epsilon;
+}
+
+double heavy_hitter_min_threshold(
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n,
+		const uint64_t norm);
+void heavy_hitter_estimates_init(heavy_hitter_estimates_t *restrict res, 
+		const uint32_t size);
+void heavy_hitter_estimates_free(heavy_hitter_estimates_t *restrict res);
+void heavy_hitter_estimates_push(heavy_hitter_estimates_t *restrict res, 
+		const uint32_t id, const int64_t count, const int64_t error);
+void heavy_hitter_estimates_finish(heavy_hitter_estimates_t *restrict res, 
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n, 
+		const uint64_t norm);
+void heavy_hitter_hhh_init(heavy_hitter_hhh_t *restrict res, 
+		const uint32_t size);
+void heavy_hitter_hhh_free(heavy_hitter_hhh_t *restrict res);
+void heavy_hitter_hhh_finish(heavy_hitter_hhh_t *restrict res, 
+		const frontier_t *restrict levels, const uint32_t *restrict offsets,
+		const uint8_t *restrict grans, const uint8_t depths, 
+		const double threshold);
 
 extern hh_func_t hh_sketch;
 extern hh_func_t hh_const_sketch;
 extern hh_func_t hh_cormode_cmh;
 extern hh_func_t hh_ktree;
+extern hh_func_t hh_shared_sketch;
+extern hh_func_t hh_cgt;
+extern hh_func_t hh_sparse;
+extern hh_func_t hh_sample;
+extern hh_func_t hh_window;
+extern hh_func_t hh_adaptive;
+extern hh_func_t hh_ktree64;
 
 #endif
@@ -4,76 +4,230 @@
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "util/xutil.h"
-#include "util/fifo.h"
+#include "util/cache.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
+#include "util/pool.h"
 #include "hh/hh.h"
 #include "hh/ktree.h"
 #include "sketch/sketch.h"
 
+static void hh_ktree_kernels(hh_ktree_t *restrict hh);
+
+// Nodes of a layer, the prefixes of its bits and the last layer m
+static inline uint64_t hh_ktree_nodes(const uint8_t *restrict grans, 
+		const uint8_t layer, const uint32_t m) {
+	uint8_t i, bits = 0;
+
+	for (i = 0; i <= layer; i++) {
+		bits += grans[i];
+	}
+
+	return ( bits < 32 && ((uint64_t)1 << bits) < m ) ? 
+		((uint64_t)1 << bits) : m;
+}
+
+// Every sketched layer holds a w*d sketch
+static uint8_t hh_ktree_exact_layers(const uint8_t logm, 
+		const uint8_t *restrict grans, const uint32_t m, const uint32_t w, 
+		const uint32_t d) {
+	uint8_t i;
+	uint64_t nodes[logm];
+
+	for (i = 0; i < logm; i++) {
+		nodes[i] = hh_ktree_nodes(grans, i, m);
+	}
+
+	return cache_exact_layers(nodes, logm, sizeof(uint64_t)*w*d, d, 0, 0);
+}
+
+// Fills the bits of every layer below its parent and returns the amount of 
+// layers. The layers are filled from the leaves, and the top layer takes the 
+// bits of m that remain. Unless given, the layers below the top are as wide 
+// as keeps the frontier of a layer, k/phi nodes, in the L1 cache, while the 
+// exactly counted top layer may grow to the L2 cache.
+uint8_t hh_ktree_granularity(const hh_ktree_params_t *restrict params, 
+		uint8_t *restrict grans) {
+	uint8_t i, bits, gran, top, logm, sum;
+	uint8_t fill[KTREE_LAYERS];
+	const uint32_t m = params->m;
+
+	for (bits = 1; bits < 32 && ((uint64_t)1 << bits) <= m; bits++);
+
+	if ( params->grans != NULL ) {
+		for (logm = 0, sum = 0; sum < bits && logm < KTREE_LAYERS; logm++) {
+			grans[logm] = params->grans[logm];
+			sum        += grans[logm];
+		}
+
+		// Surplus bits are taken from the top layer
+		if ( sum > bits && grans[0] > sum-bits ) {
+			grans[0] -= sum-bits;
+		}
+
+		return logm;
+	}
+
+	if ( params->gran > 0 ) {
+		gran = params->gran;
+		top  = gran;
+	} else {
+		gran = floor(log2(cache_size(1) * params->phi / 
+					(sizeof(uint32_t) + sizeof(int64_t))));
+		gran = (gran < 1) ? 1 : (gran > 8) ? 8 : gran;
+		top  = floor(log2(cache_size(2) / sizeof(uint64_t)));
+		top  = (top < gran) ? gran : top;
+	}
+
+	for (logm = 0; bits > top; logm++) {
+		fill[logm] = gran;
+		bits      -= gran;
+	}
+	fill[logm++] = bits;
+
+	for (i = 0; i < logm; i++) {
+		grans[i] = fill[logm-1-i];
+	}
+
+	return logm;
+}
+
+// Sketch of a layer with the type and size given by the per layer policies of
+// the parameters, autosize narrows the inner layers but never the leaves
+static sketch_t *hh_ktree_layer(heavy_hitter_params_t *restrict p, 
+		const uint8_t *restrict grans, const uint8_t layer, 
+		const uint8_t logm) {
+	hh_ktree_params_t *restrict params = (hh_ktree_params_t *)p->params;
+	sketch_func_t *restrict f = (params->fs != NULL) ? 
+		params->fs[layer] : params->f;
+	double epsilon = (params->epsilons != NULL) ? 
+		params->epsilons[layer] : params->epsilon;
+	double delta   = (params->deltas != NULL) ? 
+		params->deltas[layer] : params->delta;
+
+	if ( params->autosize && layer < logm-1 ) {
+		epsilon = heavy_hitter_layer_epsilon(epsilon, params->b, 
+				hh_ktree_nodes(grans, layer, params->m), 
+				f->one_sided ? params->phi : 0);
+	}
+
+	delta = (delta*params->phi)/(((uint32_t)1 << grans[layer])*logm);
+
+	return sketch_create(f, p->hash, params->b, epsilon, delta);
+}
+
 hh_ktree_t *hh_ktree_create(heavy_hitter_params_t *restrict p) {
 	int8_t i;
-	uint32_t w, d, wd, top_tree_size, size;
+	uint32_t t, k;
+	uint32_t w, d, top_tree_size;
 	hh_ktree_params_t *restrict params = (hh_ktree_params_t *)p->params;
-	uint8_t top_cnt            = 1;
-	const uint8_t gran         = params->gran;
-	const uint32_t k           = (1 << gran);
+	uint8_t top_cnt;
+	uint8_t grans[KTREE_LAYERS];
 	const uint32_t m           = params->m;
-	const uint8_t logm         = floor(log((uint64_t)m)/log(k)+1);
+	const uint8_t logm         = hh_ktree_granularity(params, grans);
 	const double phi           = params->phi;
-	const double epsilon       = params->epsilon;
-	const uint32_t queries     = ceil((double)k/phi);
-	double delta               = (double)((params->delta*phi)/(k*logm));
-	const uint32_t b           = params->b;
 	const uint32_t result_cnt  = ceil(1./phi);
 	const uint32_t result_size = sizeof(uint32_t) * result_cnt;
 	hh_ktree_t *restrict hh    = xmalloc( sizeof(hh_ktree_t) );
-	sketch_t   *restrict s     = sketch_create(params->f, p->hash, b, epsilon, 
-			delta);
+	sketch_t   *restrict s     = hh_ktree_layer(p, grans, logm-1, logm);
+	uint32_t queries;
 
-	assert(phi > epsilon);
+	// The frontiers hold k/phi nodes of the widest layer below the top, whose
+	// children are pruned by their exact counts
+	for (i = (logm > 1) ? 1 : 0, k = 0; i < logm; i++) {
+		k = (((uint32_t)1 << grans[i]) > k) ? (uint32_t)1 << grans[i] : k;
+	}
+	queries = ceil((double)k/phi);
+
+	assert(phi > params->epsilon);
 	
 	// This only works since the sketch_size_t appears first in the *_sketch_t 
 	// structures!
 	w                  = sketch_width(s->sketch);
 	d                  = sketch_depth(s->sketch);
-	wd                 = w*d;
 
 	hh->logm           = logm;
+	hh->prune          = s->funcs->one_sided;
 	hh->params         = params;
-	hh->gran           = gran;
-	hh->k              = k;
+	hh->grans          = xmalloc( sizeof(uint8_t) * logm );
+	memcpy(hh->grans, grans, sizeof(uint8_t) * logm);
 	hh->norm           = 0;
 	hh->result.count   = 0; 
-	hh->fifo           = fifo_create(queries);
+	hh->cur            = frontier_create(queries);
+	hh->next           = frontier_create(queries);
+	hh->levels         = frontier_create(queries);
+	hh->heap           = heap_create(queries);
+	hh->candidates     = (params->incremental) ? 
+		candidates_create(result_cnt, params->crossing, params->arg) : NULL;
 	hh->result.size    = result_cnt;
 	hh->result.hitters = xmalloc( result_size );
 	memset(hh->result.hitters, '\0', result_size);
+	heavy_hitter_estimates_init(&hh->estimates, result_cnt);
+	heavy_hitter_hhh_init(&hh->hhh, result_cnt);
+
+	if ( params->exact > 0 ) {
+		top_cnt = params->exact;
+	} else {
+		top_cnt = hh_ktree_exact_layers(logm, grans, m, w, d);
+	}
 
-	// Find the base of the next power of k of w*d
-	for (i = 1; ((uint64_t)k << i*gran) <= wd; i++) {
-		top_cnt++;
+	if ( unlikely(top_cnt < 1) ) {
+		top_cnt = 1;
 	}
 
 	if ( unlikely(top_cnt >= logm) ) {
 		top_cnt = logm;
-		size    = (uint32_t)(floor((pow(k,top_cnt)-1)/(k-1))-1)+m;
-	} else {
-		size    = (uint32_t)(floor((pow(k,top_cnt+1)-1)/(k-1))-1);
 	}
 
-	top_tree_size = sizeof(uint64_t) * size;
-	hh->top       = xmalloc( top_tree_size );
+	hh->layout    = layout_create(grans, top_cnt+1);
+	top_tree_size = sizeof(uint64_t) * hh->layout->size;
+	hh->top       = xmalloc_aligned( LAYOUT_ALIGN, top_tree_size );
 	memset(hh->top, '\0', top_tree_size);
 	hh->top_cnt   = top_cnt;
 
+	hh_ktree_kernels(hh);
+
+	// The frontier of the split layer is partitioned among a pool of threads,
+	// each descending its own subtrees with private frontiers
+	hh->pool    = NULL;
+	hh->workers = NULL;
+	hh->args    = NULL;
+	hh->split   = 0;
+
+	if ( params->threads > 1 && logm > 1 ) {
+		hh->split = (params->split > 0) ? params->split : top_cnt;
+		if ( hh->split > logm-1 ) {
+			hh->split = logm-1;
+		}
+
+		hh->pool    = pool_create(params->threads);
+		hh->workers = xmalloc( sizeof(hh_ktree_worker_t) * params->threads );
+		hh->args    = xmalloc( sizeof(void *) * params->threads );
+
+		for (t = 0; t < params->threads; t++) {
+			hh->workers[t].hh   = hh;
+			hh->workers[t].cur  = frontier_create(queries);
+			hh->workers[t].next = frontier_create(queries);
+			hh->args[t]         = &hh->workers[t];
+		}
+	}
 
 	if ( top_cnt < logm ) {
 		hh->tree = xmalloc( sizeof(sketch_t *) * (logm-top_cnt) );
-		for (i = logm-top_cnt-1; i > 0; i--) {
-			hh->tree[i] = sketch_create(params->f, p->hash, b, epsilon, delta);
+		for (i = 0; i < logm-top_cnt-1; i++) {
+			hh->tree[i] = hh_ktree_layer(p, grans, top_cnt+i, logm);
 		}
 		hh->tree[i] = s;
+
+		for (i = 0; params->colocate && i < logm-top_cnt; i++) {
+			sketch_siblings(hh->tree[i]->sketch, grans[top_cnt+i]);
+		}
 	} else {
 		hh->tree = NULL;
 		sketch_destroy(s);
@@ -101,9 +255,39 @@ void hh_ktree_destroy(hh_ktree_t *restrict hh) {
 		hh->top = NULL;
 	}
 
-	if (hh->fifo != NULL) {
-		fifo_destroy(hh->fifo);
-		hh->fifo = NULL;
+	if (hh->layout != NULL) {
+		layout_destroy(hh->layout);
+		hh->layout = NULL;
+	}
+
+	if (hh->grans != NULL) {
+		free(hh->grans);
+		hh->grans = NULL;
+	}
+
+	if (hh->cur != NULL) {
+		frontier_destroy(hh->cur);
+		hh->cur = NULL;
+	}
+
+	if (hh->next != NULL) {
+		frontier_destroy(hh->next);
+		hh->next = NULL;
+	}
+
+	if (hh->levels != NULL) {
+		frontier_destroy(hh->levels);
+		hh->levels = NULL;
+	}
+
+	if (hh->heap != NULL) {
+		heap_destroy(hh->heap);
+		hh->heap = NULL;
+	}
+
+	if (hh->candidates != NULL) {
+		candidates_destroy(hh->candidates);
+		hh->candidates = NULL;
 	}
 
 	if (hh->result.hitters != NULL) {
@@ -111,6 +295,21 @@ void hh_ktree_destroy(hh_ktree_t *restrict hh) {
 		hh->result.hitters = NULL;
 	}
 
+	heavy_hitter_estimates_free(&hh->estimates);
+	heavy_hitter_hhh_free(&hh->hhh);
+
+	if (hh->pool != NULL) {
+		for (i = 0; i < pool_size(hh->pool); i++) {
+			frontier_destroy(hh->workers[i].cur);
+			frontier_destroy(hh->workers[i].next);
+		}
+
+		pool_destroy(hh->pool);
+		free(hh->workers);
+		free(hh->args);
+		hh->pool = NULL;
+	}
+
 	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
 		sketch_destroy(hh->tree[i]);
 	}
@@ -119,32 +318,87 @@ void hh_ktree_destroy(hh_ktree_t *restrict hh) {
 	hh = NULL;
 }
 
-// Update
-void hh_ktree_update(hh_ktree_t *restrict hh, const uint32_t idx, 
-		const int64_t c) {
+// Update of every layer, those below the top by gran bits each or by their 
+// own bits when gran is 0. Above two bits every depth below the first is a 
+// band of its own, whose counters are addressed by its base alone.
+static inline __attribute__((always_inline)) void hh_ktree_update_gran(
+		hh_ktree_t *restrict hh, const uint32_t idx, const int64_t c, 
+		const uint8_t gran) {
 	int8_t i;
 	uint32_t x;
+	int64_t est              = 0;
 	sketch_t **restrict tree = hh->tree;
 	uint64_t  *restrict top  = hh->top;
 	const uint8_t top_cnt    = hh->top_cnt; 
 	const uint8_t logm       = hh->logm;
-	const uint8_t gran       = hh->gran; 
-	const uint32_t k         = hh->k;
+	const uint8_t *restrict grans = hh->grans;
+	layout_t *restrict layout = hh->layout;
 
 	x = idx;
+	i = logm-top_cnt-1;
+
+	// Read the leaf estimate while updating it
+	if ( hh->candidates != NULL && i > -1 ) {
+		est = sketch_update_point(tree[i], x, c);
+		x >>= (gran > 0) ? gran : grans[top_cnt+i];
+		i--;
+	}
 
 	// Use sketches to estimate count instead
-	for (i = logm-top_cnt-1; i > -1; i--) {
+	for (; i > -1; i--) {
 		sketch_update(tree[i], x, c);
-		x >>= gran;
+		x >>= (gran > 0) ? gran : grans[top_cnt+i];
 	}
 
 	for (i = top_cnt-1; i > -1; i--) {
-		top[x + (uint32_t)((k << (i*gran))-1)/(k-1) - 1] += c;
-		x >>= gran;
+		if ( gran > 2 && i > 0 ) {
+			top[layout->base[i+1] + x] += c;
+		} else {
+			top[layout_index(layout, i+1, x)] += c;
+		}
+		x >>= (gran > 0) ? gran : grans[i];
 	}
 
 	hh->norm += c;
+
+	if ( hh->candidates != NULL ) {
+		if ( unlikely(top_cnt == logm) ) {
+			est = top[layout_index(layout, logm, idx)];
+		}
+
+		candidates_update(hh->candidates, idx, c, est, 
+				hh->params->phi*hh->norm);
+	}
+}
+
+static void hh_ktree_update_any(hh_ktree_t *restrict hh, const uint32_t idx, 
+		const int64_t c) {
+	hh_ktree_update_gran(hh, idx, c, 0);
+}
+
+static void hh_ktree_update_1(hh_ktree_t *restrict hh, const uint32_t idx, 
+		const int64_t c) {
+	hh_ktree_update_gran(hh, idx, c, 1);
+}
+
+static void hh_ktree_update_2(hh_ktree_t *restrict hh, const uint32_t idx, 
+		const int64_t c) {
+	hh_ktree_update_gran(hh, idx, c, 2);
+}
+
+static void hh_ktree_update_4(hh_ktree_t *restrict hh, const uint32_t idx, 
+		const int64_t c) {
+	hh_ktree_update_gran(hh, idx, c, 4);
+}
+
+static void hh_ktree_update_8(hh_ktree_t *restrict hh, const uint32_t idx, 
+		const int64_t c) {
+	hh_ktree_update_gran(hh, idx, c, 8);
+}
+
+void hh_ktree_update(hh_ktree_t *restrict hh, const uint32_t idx, 
+		const int64_t c) {
+	hh->update(hh, idx, c);
 }
 	
 //Query
@@ -156,65 +410,514 @@ static inline void hh_ktree_resize_result(heavy_hitter_t *res) {
 	}
 }
 
-heavy_hitter_t *hh_ktree_query(hh_ktree_t *restrict hh) {
-	uint32_t x, idx, tmp, i;
-	uint8_t layer;
-	elm_t *res;
+// Pushes the children of x, whose 256 counters are contiguous, that reach the
+// threshold. With AVX2 four counters are compared at once and the budget is 
+// checked every 16 of them, which keeps the same children since no child 
+// after the budget ran out can reach the threshold. Without prune the budget 
+// is ignored.
+static void hh_ktree_scan_256(const uint64_t *restrict counters, 
+		const uint32_t x, int64_t budget, const double threshold, 
+		const bool prune, frontier_t *restrict next) {
+	uint32_t j;
+#ifdef __AVX2__
+	uint32_t l, bits;
+	int64_t sums[4];
+	__m256i v, sum;
+	const __m256i t = _mm256_set1_epi64x((int64_t)ceil(threshold) - 1);
+
+	for (j = 0; j < 256 && (!prune || budget >= threshold); j += 16) {
+		sum  = _mm256_setzero_si256();
+		bits = 0;
+
+		for (l = 0; l < 16; l += 4) {
+			v     = _mm256_loadu_si256((const __m256i *)(counters+j+l));
+			sum   = _mm256_add_epi64(sum, v);
+			bits |= (uint32_t)_mm256_movemask_pd(
+					_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, t))) << l;
+		}
+
+		for (; bits != 0; bits &= bits-1) {
+			l = __builtin_ctz(bits);
+			frontier_push_back(next, x+j+l, counters[j+l]);
+		}
+
+		_mm256_storeu_si256((__m256i *)sums, sum);
+		budget -= sums[0] + sums[1] + sums[2] + sums[3];
+	}
+#else
+	int64_t est;
+
+	for (j = 0; j < 256 && (!prune || budget >= threshold); j++) {
+		est     = counters[j];
+		budget -= est;
+
+		if ( est >= threshold ) {
+			frontier_push_back(next, x+j, est);
+		}
+	}
+#endif
+}
+
+// Expands the children of the frontier cur at the given layer into next, 
+// keeping only those above the threshold. Where the parent is counted 
+// exactly, the children are scanned until the mass left of the parent cannot 
+// make another child heavy. This needs non-negative counts, so the children 
+// are all scanned over Count-Median, which is used for deletions. A gran above
+// 0 is the constant bits of a layer below the top.
+static inline __attribute__((always_inline)) void hh_ktree_expand_gran(
+		hh_ktree_t *restrict hh, const uint8_t layer, frontier_t *restrict cur,
+		frontier_t *restrict next, const double threshold, const uint8_t g) {
+	uint32_t i, j, n, x;
+	int64_t est, budget;
 	const uint8_t top_cnt    = hh->top_cnt; 
-	const uint8_t logm       = hh->logm;
-	const uint8_t gran       = hh->gran;
-	const uint32_t k         = hh->k;
-	const double threshold   = hh->params->phi*hh->norm;
+	const uint8_t gran       = (g > 0) ? g : hh->grans[layer];
+	const uint32_t k         = (uint32_t)1 << gran;
+	const bool prune         = hh->prune;
 	sketch_t **restrict tree = hh->tree;
 	uint64_t  *restrict top  = hh->top;
-	fifo_t    *restrict fifo = hh->fifo;
+	layout_t  *restrict layout = hh->layout;
+
+	n = k*cur->count;
+
+	frontier_clear(next);
+	frontier_reserve(next, n);
+
+	if ( layer < top_cnt ) {
+		for (i = 0; i < cur->count; i++) {
+			x      = cur->elm[i] << gran;
+			budget = cur->est[i];
+
+			if ( g == 8 ) {
+				hh_ktree_scan_256(top + layout->base[layer+1] + x, x, budget, 
+						threshold, prune, next);
+				continue;
+			}
+
+			for (j = 0; j < k && (!prune || budget >= threshold); j++) {
+				est     = (g > 2) ? top[layout->base[layer+1] + x+j] : 
+					top[layout_index(layout, layer+1, x+j)];
+				budget -= est;
+
+				if ( est >= threshold ) {
+					frontier_push_back(next, x+j, est);
+				}
+			}
+		}
+	} else {
+		for (i = 0; i < cur->count; i++) { // branches
+			x = cur->elm[i] << gran;
+			for (j = 0; j < k; j++) {
+				next->elm[i*k+j] = x+j;
+			}
+		}
+
+		sketch_points(tree[layer-top_cnt], next->elm, next->est, n);
+
+		for (i = 0, j = 0; i < n; i++) {
+			if ( next->est[i] >= threshold ) {
+				next->elm[j] = next->elm[i];
+				next->est[j] = next->est[i];
+				j++;
+			}
+		}
+		next->count = j;
+	}
+}
+
+static void hh_ktree_expand_any(hh_ktree_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next, 
+		const double threshold) {
+	hh_ktree_expand_gran(hh, layer, cur, next, threshold, 0);
+}
+
+// The top layer may have other bits than the layers below it
+static void hh_ktree_expand_1(hh_ktree_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next, 
+		const double threshold) {
+	if ( layer > 0 ) {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 1);
+	} else {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 0);
+	}
+}
+
+static void hh_ktree_expand_2(hh_ktree_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next, 
+		const double threshold) {
+	if ( layer > 0 ) {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 2);
+	} else {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 0);
+	}
+}
+
+static void hh_ktree_expand_4(hh_ktree_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next, 
+		const double threshold) {
+	if ( layer > 0 ) {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 4);
+	} else {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 0);
+	}
+}
+
+static void hh_ktree_expand_8(hh_ktree_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next, 
+		const double threshold) {
+	if ( layer > 0 ) {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 8);
+	} else {
+		hh_ktree_expand_gran(hh, layer, cur, next, threshold, 0);
+	}
+}
+
+// Layers below the top of one granularity use kernels with constant shifts
+static void hh_ktree_kernels(hh_ktree_t *restrict hh) {
+	uint8_t i;
+
+	for (i = 2; i < hh->logm && hh->grans[i] == hh->grans[1]; i++) {
+	}
+
+	switch ( (hh->logm > 1 && i >= hh->logm) ? hh->grans[1] : 0 ) {
+		case 1:
+			hh->update = hh_ktree_update_1;
+			hh->expand = hh_ktree_expand_1;
+			break;
+		case 2:
+			hh->update = hh_ktree_update_2;
+			hh->expand = hh_ktree_expand_2;
+			break;
+		case 4:
+			hh->update = hh_ktree_update_4;
+			hh->expand = hh_ktree_expand_4;
+			break;
+		case 8:
+			hh->update = hh_ktree_update_8;
+			hh->expand = hh_ktree_expand_8;
+			break;
+		default:
+			hh->update = hh_ktree_update_any;
+			hh->expand = hh_ktree_expand_any;
+	}
+}
+
+// Expands the layers [from, to[ one whole level at a time, such that all 
+// point queries of a level are independent and can be batched. The surviving
+// nodes of the last layer are left in *cur.
+static void hh_ktree_descend(hh_ktree_t *restrict hh, const uint8_t from, 
+		const uint8_t to, frontier_t **cur, frontier_t **next, 
+		const double threshold) {
+	uint8_t layer;
+
+	for (layer = from; layer < to && (*cur)->count > 0; layer++) {
+		hh->expand(hh, layer, *cur, *next, threshold);
+		frontier_swap(cur, next);
+	}
+}
+
+static void hh_ktree_worker(void *arg) {
+	hh_ktree_worker_t *worker = (hh_ktree_worker_t *)arg;
+	frontier_t *cur           = worker->cur;
+	frontier_t *next          = worker->next;
+
+	hh_ktree_descend(worker->hh, worker->layer, worker->hh->logm, &cur, &next, 
+			worker->threshold);
+
+	worker->cur  = cur;
+	worker->next = next;
+}
+
+// Appends the leaves found by a worker to the frontier
+static void hh_ktree_collect(frontier_t *restrict leaves, 
+		const frontier_t *restrict found) {
+	uint32_t i;
+
+	for (i = 0; i < found->count; i++) {
+		frontier_push_back(leaves, found->elm[i], found->est[i]);
+	}
+}
+
+// Walks the tree at the given threshold, the surviving leaves and their 
+// estimates are left in hh->cur
+static void hh_ktree_walk(hh_ktree_t *restrict hh, const double threshold) {
+	uint32_t i, t, n, chunk, from;
+	hh_ktree_worker_t *worker;
+	const uint8_t logm       = hh->logm;
+	frontier_t *cur          = hh->cur;
+	frontier_t *next         = hh->next;
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, hh->norm);
+
+	if ( hh->pool == NULL ) {
+		hh_ktree_descend(hh, 0, logm, &cur, &next, threshold);
+	} else {
+		hh_ktree_descend(hh, 0, hh->split, &cur, &next, threshold);
+
+		// Partition the frontier into contiguous chunks, such that the 
+		// concatenated results of the workers remain sorted
+		chunk = (cur->count + pool_size(hh->pool) - 1) / pool_size(hh->pool);
+
+		for (t = 0, from = 0; from < cur->count; t++, from += chunk) {
+			n      = (cur->count - from < chunk) ? cur->count - from : chunk;
+			worker = &hh->workers[t];
+
+			frontier_clear(worker->cur);
+			frontier_reserve(worker->cur, n);
+
+			for (i = 0; i < n; i++) {
+				worker->cur->elm[i] = cur->elm[from+i];
+				worker->cur->est[i] = cur->est[from+i];
+			}
+
+			worker->cur->count = n;
+			worker->layer      = hh->split;
+			worker->threshold  = threshold;
+		}
+
+		pool_run(hh->pool, hh_ktree_worker, hh->args, t);
+
+		frontier_clear(cur);
+
+		for (i = 0; i < t; i++) {
+			hh_ktree_collect(cur, hh->workers[i].cur);
+		}
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+}
+
+// Estimates the leaves without clamping them to their ancestors
+static void hh_ktree_leaves(hh_ktree_t *restrict hh, 
+		frontier_t *restrict leaves) {
+	uint32_t i;
+	const uint8_t top_cnt    = hh->top_cnt; 
+	const uint8_t logm       = hh->logm;
+
+	if ( top_cnt < logm ) {
+		sketch_points(hh->tree[logm-top_cnt-1], leaves->elm, leaves->est, 
+				leaves->count);
+	} else {
+		for (i = 0; i < leaves->count; i++) {
+			leaves->est[i] = hh->top[layout_index(hh->layout, logm, 
+					leaves->elm[i])];
+		}
+	}
+}
+
+// In incremental mode only the candidates have to be validated, unless a 
+// negative update has invalidated them
+static void hh_ktree_find(hh_ktree_t *restrict hh, const double threshold) {
+	candidates_t *restrict cand = hh->candidates;
+
+	if ( cand != NULL && cand->valid ) {
+		candidates_collect(cand, hh->cur);
+		hh_ktree_leaves(hh, hh->cur);
+		candidates_retain(cand, hh->cur, threshold);
+	} else {
+		hh_ktree_walk(hh, threshold);
+
+		if ( cand != NULL ) {
+			candidates_reset(cand, hh->cur);
+		}
+	}
+}
+
+heavy_hitter_t *hh_ktree_query(hh_ktree_t *restrict hh) {
+	uint32_t i;
+	frontier_t *leaves;
 
 	hh->result.count         = 0;
 
 	memset(hh->result.hitters, '\0', hh->result.size); 
 
-	fifo_push_back(fifo, 0, 0);
+	hh_ktree_find(hh, hh->params->phi*hh->norm);
+	leaves = hh->cur;
 
-	while ( !fifo_empty(fifo) ) {
-		res   = fifo_pop_front(fifo);
-		idx   = res->elm;
-		layer = res->layer;
+	for (i = 0; i < leaves->count; i++) {
+		hh->result.hitters[hh->result.count] = leaves->elm[i];
 
-		for (i = 0; i < k; i++) { // branches
-			x = idx+i;
+		assert( leaves->elm[i] <= hh->params->m );
 
-			if ( layer < top_cnt  ) {
-				tmp = (uint32_t)((k << (layer*gran))-1)/(k-1) - 1;
-				if ( top[x+tmp] >= threshold ) {
-					if ( unlikely(layer == logm-1) ) {
-						hh->result.hitters[hh->result.count] = x;
+		hh->result.count++;
 
-						assert( x <= hh->params->m );
+		hh_ktree_resize_result(&hh->result);
+	}
 
-						hh->result.count++;
+	return &hh->result;
+}
 
-						hh_ktree_resize_result(&hh->result);
-					} else {
-						fifo_push_back(fifo, x<<gran, layer+1);
-					}
-				}
-			} else {
-				if ( sketch_point(tree[layer-top_cnt], x) >= threshold ) {
-					if ( unlikely( layer == logm-1 ) ) {
-						hh->result.hitters[hh->result.count] = x;
+// Walks the tree once at the lowest threshold, the estimates of the leaves 
+// are kept from the walk
+heavy_hitter_estimates_t *hh_ktree_query_thresholds(hh_ktree_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	frontier_t *leaves;
+	const int64_t error = ( hh->top_cnt < hh->logm ) ? 
+		sketch_error(hh->tree[hh->logm-hh->top_cnt-1], hh->norm) : 0;
+
+	hh->estimates.count = 0;
+
+	hh_ktree_walk(hh, heavy_hitter_min_threshold(thresholds, n, hh->norm));
+	leaves = hh->cur;
+
+	for (i = 0; i < leaves->count; i++) {
+		heavy_hitter_estimates_push(&hh->estimates, leaves->elm[i], 
+				leaves->est[i], error);
+	}
+
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, hh->norm);
+
+	return &hh->estimates;
+}
+
+// Walks the tree once at the threshold, keeping the heavy prefixes of every 
+// depth in hh->levels for the discounting
+heavy_hitter_hhh_t *hh_ktree_query_hhh(hh_ktree_t *restrict hh, 
+		const double phi) {
+	uint8_t layer;
+	uint32_t i, offsets[KTREE_LAYERS+2];
+	frontier_t *cur          = hh->cur;
+	frontier_t *next         = hh->next;
+	frontier_t *levels       = hh->levels;
+	const uint8_t logm       = hh->logm;
+	const double th          = phi*hh->norm;
+
+	frontier_clear(levels);
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, hh->norm);
+
+	for (layer = 0; layer <= logm; layer++) {
+		offsets[layer] = levels->count;
+
+		for (i = 0; i < cur->count; i++) {
+			frontier_push_back(levels, cur->elm[i], cur->est[i]);
+		}
+
+		if ( layer < logm ) {
+			hh->expand(hh, layer, cur, next, th);
+			frontier_swap(&cur, &next);
+		}
+	}
+	offsets[layer] = levels->count;
+
+	hh->cur  = cur;
+	hh->next = next;
+
+	heavy_hitter_hhh_finish(&hh->hhh, levels, offsets, hh->grans, logm+1, th);
+
+	return &hh->hhh;
+}
+
+// Estimates all children of the node x at the given layer, clamped to the 
+// estimate of the node
+static void hh_ktree_children(hh_ktree_t *restrict hh, const uint8_t layer,
+		const uint32_t x, const int64_t est, frontier_t *restrict children) {
+	uint32_t j;
+	const uint8_t top_cnt = hh->top_cnt; 
+	const uint8_t gran    = hh->grans[layer];
+	const uint32_t k      = (uint32_t)1 << gran;
+
+	frontier_clear(children);
+	frontier_reserve(children, k);
+
+	for (j = 0; j < k; j++) { // branches
+		children->elm[j] = (x << gran)+j;
+	}
+	children->count = k;
+
+	if ( layer < top_cnt ) {
+		for (j = 0; j < k; j++) {
+			children->est[j] = hh->top[layout_index(hh->layout, layer+1, 
+					children->elm[j])];
+		}
+	} else {
+		sketch_points(hh->tree[layer-top_cnt], children->elm, children->est, k);
+	}
+
+	for (j = 0; j < k; j++) {
+		children->est[j] = (children->est[j] < est) ? children->est[j] : est;
+	}
+}
+
+// Walks the tree best-first, always expanding the node with the largest 
+// estimate. Since no child is estimated above its parent, the leaves are 
+// popped in order of decreasing estimate, and the walk stops after n leaves.
+heavy_hitter_t *hh_ktree_topk(hh_ktree_t *restrict hh, const uint32_t n) {
+	uint32_t j, x;
+	uint8_t layer;
+	int64_t est;
+	node_t *node;
+	const uint8_t logm       = hh->logm;
+	heap_t *restrict heap    = hh->heap;
+	frontier_t *children     = hh->next;
 
-						assert( x <= hh->params->m );
+	hh->result.count         = 0;
+
+	heap_clear(heap);
+	heap_push(heap, 0, 0, hh->norm);
+
+	while ( hh->result.count < n && (node = heap_pop(heap)) != NULL ) {
+		x     = node->elm;
+		layer = node->layer;
+		est   = node->est;
+
+		if ( unlikely(layer == logm) ) {
+			hh->result.hitters[hh->result.count] = x;
+
+			assert( x <= hh->params->m );
+
+			hh->result.count++;
+
+			hh_ktree_resize_result(&hh->result);
+			continue;
+		}
 
-						hh->result.count++;
+		hh_ktree_children(hh, layer, x, est, children);
 
-						hh_ktree_resize_result(&hh->result);
-					} else {
-						fifo_push_back(fifo, x<<gran, layer+1);
-					}
-				} 
+		for (j = 0; j < children->count; j++) {
+			if ( children->est[j] > 0 ) {
+				heap_push(heap, children->elm[j], layer+1, children->est[j]);
 			}
 		}
 	}
 
 	return &hh->result;
 }
+
+// Snapshots
+void hh_ktree_save(hh_ktree_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i;
+
+	snapshot_add(snap, "grans", 0, hh->grans, sizeof(uint8_t) * hh->logm);
+	snapshot_add(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "top", 0, hh->top, 
+			sizeof(uint64_t) * hh->layout->size);
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_save(hh->tree[i], snap, i);
+	}
+}
+
+void hh_ktree_load(hh_ktree_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i;
+
+	// Granularities and exact layers chosen by the cache sizes may differ 
+	// between machines
+	snapshot_check(snap, "grans", 0, hh->grans, sizeof(uint8_t) * hh->logm);
+	snapshot_check(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "top", 0, hh->top, 
+			sizeof(uint64_t) * hh->layout->size);
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_load(hh->tree[i], snap, i);
+	}
+
+	// Candidates are not saved, the next query walks the tree
+	if ( hh->candidates != NULL ) {
+		hh->candidates->valid = false;
+	}
+}
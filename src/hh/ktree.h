@@ -2,14 +2,22 @@
 #define H_hh_ktree
 
 // Standard libraries
+#include <stdbool.h>
 #include <stdint.h>
 
 // User defined libraries
 #include "util/hash.h"
-#include "util/fifo.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
+#include "util/pool.h"
 #include "hh/hh.h"
+#include "hh/candidates.h"
 #include "sketch/sketch.h"
 
+// Most layers of a tree, every layer spans one bit at least
+#define KTREE_LAYERS 32
+
 // Structures
 typedef struct {
 	double          phi;
@@ -17,23 +25,75 @@ typedef struct {
 	double          delta;
 	uint32_t        m;
 	uint32_t        b;
-	uint8_t         gran;
+	uint8_t         gran;    // Bits of every layer below its parent, 0 chooses
+	                         // them by m, phi and the cache sizes
+	const uint8_t  *grans;   // Bits of every layer from the top, replacing 
+	                         // gran when not NULL
+	uint8_t         threads; // Threads used by the query, 0 or 1 is serial
+	uint8_t         split;   // Layer whose frontier is partitioned among the 
+	                         // threads, 0 is the first sketched layer
+	uint8_t         exact;       // Exactly counted top layers, 0 chooses them
+	                             // by the cache cost model
+	bool            incremental; // Maintain heavy hitter candidates during 
+	                             // updates, valid for non-negative updates
+	bool            colocate;    // Place the children of a node in one 
+	                             // block of every sketched row
+	const double   *epsilons;    // Epsilon of every layer, NULL uses epsilon
+	const double   *deltas;      // Delta of every layer, NULL uses delta
+	bool            autosize;    // Derive the epsilon of the sketched inner 
+	                             // layers from their amount of prefixes and
+	                             // from phi, see heavy_hitter_layer_epsilon
+	hh_crossing     crossing;    // Called when an item becomes a candidate
+	void           *arg;         // Passed to crossing
+	sketch_func_t **fs;          // Sketch of every layer, NULL uses f
 	sketch_func_t  *restrict f;
 } hh_ktree_params_t;
 
+struct hh_ktree_s;
+
 typedef struct {
+	struct hh_ktree_s     *hh;
+	frontier_t            *restrict cur;
+	frontier_t            *restrict next;
+	uint8_t                layer;
+	double                 threshold;
+} hh_ktree_worker_t;
+
+typedef struct hh_ktree_s {
 	sketch_t             **restrict tree;
 	uint64_t              *restrict top;
+	layout_t              *restrict layout;
 	uint8_t                top_cnt;
 	uint8_t                logm;
-	uint8_t                gran;
-	uint32_t               k;
+	bool                   prune;  // Scans of exact children stop once the
+	                               // mass of the parent is used up
+	uint8_t               *restrict grans; // Bits of every layer below its
+	                                       // parent
 	uint64_t               norm;
 	hh_ktree_params_t     *restrict params;
-	fifo_t                *restrict fifo;
+	frontier_t            *restrict cur;
+	frontier_t            *restrict next;
+	frontier_t            *restrict levels; // Heavy prefixes of every depth
+	heap_t                *restrict heap;
+	candidates_t          *restrict candidates;
+	pool_t                *restrict pool;
+	hh_ktree_worker_t     *restrict workers;
+	void                 **restrict args;
+	uint8_t                split;
+	void                 (*update)(struct hh_ktree_s *restrict hh, 
+			const uint32_t idx, const int64_t c); // Kernel of the granularity
+	void                 (*expand)(struct hh_ktree_s *restrict hh, 
+			const uint8_t layer, frontier_t *restrict cur, 
+			frontier_t *restrict next, const double threshold);
 	heavy_hitter_t         result;
+	heavy_hitter_estimates_t estimates;
+	heavy_hitter_hhh_t     hhh;
 } hh_ktree_t; 
 
+// Granularity
+uint8_t hh_ktree_granularity(const hh_ktree_params_t *restrict params, 
+		uint8_t *restrict grans);
+
 // Initialization
 hh_ktree_t *hh_ktree_create(heavy_hitter_params_t *restrict p);
 
@@ -46,6 +106,15 @@ void hh_ktree_update(hh_ktree_t *restrict hh, const uint32_t idx,
 
 // Query
 heavy_hitter_t *hh_ktree_query(hh_ktree_t *restrict hh);
+heavy_hitter_t *hh_ktree_topk(hh_ktree_t *restrict hh, const uint32_t n);
+heavy_hitter_estimates_t *hh_ktree_query_thresholds(hh_ktree_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+heavy_hitter_hhh_t *hh_ktree_query_hhh(hh_ktree_t *restrict hh, 
+		const double phi);
 heavy_hitter_t *hh_ktree_query_recursive(hh_ktree_t *restrict hh);
 
+// Snapshots
+void hh_ktree_save(hh_ktree_t *restrict hh, snapshot_t *restrict snap);
+void hh_ktree_load(hh_ktree_t *restrict hh, snapshot_t *restrict snap);
+
 #endif
@@ -0,0 +1,303 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "util/xutil.h"
+#include "util/cache.h"
+#include "util/frontier.h"
+#include "util/layout.h"
+#include "hh/hh.h"
+#include "hh/ktree64.h"
+#include "sketch/sketch.h"
+
+// Nodes of a layer, saturated at 2^64-1
+static inline uint64_t hh_ktree64_nodes(const uint8_t *restrict grans,
+		const uint8_t layer) {
+	uint8_t i, bits = 0;
+
+	for (i = 0; i <= layer; i++) {
+		bits += grans[i];
+	}
+
+	return (bits < 64) ? ((uint64_t)1 << bits) : UINT64_MAX;
+}
+
+// Fills the bits of every layer below its parent from the leaves, the top
+// layer takes the bits that remain. Chosen as hh_ktree_granularity does.
+uint8_t hh_ktree64_granularity(const hh_ktree64_params_t *restrict params,
+		uint8_t *restrict grans) {
+	uint8_t i, gran, top, logm;
+	uint8_t fill[KTREE64_LAYERS];
+	uint8_t bits = (params->bits > 0 && params->bits < 64) ? params->bits : 64;
+
+	if ( params->gran > 0 ) {
+		gran = params->gran;
+		top  = gran;
+	} else {
+		gran = floor(log2(cache_size(1) * params->phi /
+					(sizeof(uint64_t) + sizeof(int64_t))));
+		gran = (gran < 1) ? 1 : (gran > 8) ? 8 : gran;
+		top  = floor(log2(cache_size(2) / sizeof(uint64_t)));
+		top  = (top < gran) ? gran : top;
+	}
+
+	for (logm = 0; bits > top; logm++) {
+		fill[logm] = gran;
+		bits      -= gran;
+	}
+	fill[logm++] = bits;
+
+	for (i = 0; i < logm; i++) {
+		grans[i] = fill[logm-1-i];
+	}
+
+	return logm;
+}
+
+hh_ktree64_t *hh_ktree64_create(heavy_hitter_params_t *restrict p) {
+	uint8_t i, top_cnt;
+	uint32_t k, w, d;
+	uint64_t top_tree_size;
+	uint8_t grans[KTREE64_LAYERS];
+	uint64_t nodes[KTREE64_LAYERS];
+	hh_ktree64_params_t *restrict params = (hh_ktree64_params_t *)p->params;
+	const uint8_t logm         = hh_ktree64_granularity(params, grans);
+	const double phi           = params->phi;
+	const uint32_t result_cnt  = ceil(1./phi);
+	hh_ktree64_t *restrict hh  = xmalloc( sizeof(hh_ktree64_t) );
+	sketch_t *restrict s       = sketch_create(params->f, p->hash, params->b,
+			params->epsilon, (params->delta*phi)/
+			(((uint32_t)1 << grans[logm-1])*logm));
+	uint32_t queries;
+
+	assert(phi > params->epsilon);
+
+	for (i = (logm > 1) ? 1 : 0, k = 0; i < logm; i++) {
+		k = (((uint32_t)1 << grans[i]) > k) ? (uint32_t)1 << grans[i] : k;
+	}
+	queries = ceil((double)k/phi);
+
+	w = sketch_width(s->sketch);
+	d = sketch_depth(s->sketch);
+
+	for (i = 0; i < logm; i++) {
+		nodes[i] = hh_ktree64_nodes(grans, i);
+	}
+
+	top_cnt = (params->exact > 0) ? params->exact :
+		cache_exact_layers(nodes, logm, sizeof(uint64_t)*w*d, d, 0, 0);
+
+	if ( unlikely(top_cnt < 1) ) {
+		top_cnt = 1;
+	}
+
+	if ( unlikely(top_cnt >= logm) ) {
+		top_cnt = logm;
+	}
+
+	hh->logm           = logm;
+	hh->prune          = params->f->one_sided;
+	hh->params         = params;
+	hh->grans          = xmalloc( sizeof(uint8_t) * logm );
+	memcpy(hh->grans, grans, sizeof(uint8_t) * logm);
+	hh->norm           = 0;
+	hh->cur            = frontier64_create(queries);
+	hh->next           = frontier64_create(queries);
+	hh->result.count   = 0;
+	hh->result.size    = result_cnt;
+	hh->result.hitters = xmalloc( sizeof(uint64_t) * result_cnt );
+	memset(hh->result.hitters, '\0', sizeof(uint64_t) * result_cnt);
+
+	hh->layout    = layout_create(grans, top_cnt+1);
+	top_tree_size = sizeof(uint64_t) * hh->layout->size;
+	hh->top       = xmalloc_aligned( LAYOUT_ALIGN, top_tree_size );
+	memset(hh->top, '\0', top_tree_size);
+	hh->top_cnt   = top_cnt;
+
+	if ( top_cnt < logm ) {
+		hh->tree = xmalloc( sizeof(sketch_t *) * (logm-top_cnt) );
+		for (i = 0; i < logm-top_cnt-1; i++) {
+			hh->tree[i] = sketch_create(params->f, p->hash, params->b,
+					params->epsilon, (params->delta*phi)/
+					(((uint32_t)1 << grans[top_cnt+i])*logm));
+		}
+		hh->tree[i] = s;
+	} else {
+		hh->tree = NULL;
+		sketch_destroy(s);
+	}
+
+	#ifdef SPACE
+	uint64_t space = top_tree_size + sizeof(uint64_t) * result_cnt +
+		sizeof(sketch_t *) * (logm-top_cnt) + sizeof(hh_ktree64_t);
+	fprintf(stderr, "Space usage excluding sketches: %"PRIu64" bytes\n\n", space);
+	#endif
+
+	return hh;
+}
+
+// Destuction
+void hh_ktree64_destroy(hh_ktree64_t *restrict hh) {
+	uint8_t i;
+
+	if (hh == NULL) {
+		return;
+	}
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_destroy(hh->tree[i]);
+	}
+
+	free(hh->tree);
+	free(hh->top);
+	free(hh->grans);
+	free(hh->result.hitters);
+	layout_destroy(hh->layout);
+	frontier64_destroy(hh->cur);
+	frontier64_destroy(hh->next);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Update
+void hh_ktree64_update(hh_ktree64_t *restrict hh, const uint64_t idx,
+		const int64_t c) {
+	int8_t i;
+	uint64_t x                    = idx;
+	sketch_t **restrict tree      = hh->tree;
+	uint64_t  *restrict top       = hh->top;
+	const uint8_t top_cnt         = hh->top_cnt;
+	const uint8_t *restrict grans = hh->grans;
+	layout_t *restrict layout     = hh->layout;
+
+	for (i = hh->logm-top_cnt-1; i > -1; i--) {
+		sketch_update64(tree[i], x, c);
+		x >>= grans[top_cnt+i];
+	}
+
+	for (i = top_cnt-1; i > -1; i--) {
+		top[layout_index(layout, i+1, x)] += c;
+		x >>= grans[i];
+	}
+
+	hh->norm += c;
+}
+
+// Expands the children of cur at the given layer into next, as
+// hh_ktree_expand does
+static void hh_ktree64_expand(hh_ktree64_t *restrict hh, const uint8_t layer,
+		frontier64_t *restrict cur, frontier64_t *restrict next,
+		const double threshold) {
+	uint32_t i, j, n;
+	uint64_t x;
+	int64_t est, budget;
+	const uint8_t top_cnt    = hh->top_cnt;
+	const uint8_t gran       = hh->grans[layer];
+	const uint32_t k         = (uint32_t)1 << gran;
+	const bool prune         = hh->prune;
+	uint64_t  *restrict top  = hh->top;
+
+	n = k*cur->count;
+
+	next->count = 0;
+	frontier64_reserve(next, n);
+
+	if ( layer < top_cnt ) {
+		for (i = 0; i < cur->count; i++) {
+			x      = cur->elm[i] << gran;
+			budget = cur->est[i];
+
+			for (j = 0; j < k && (!prune || budget >= threshold); j++) {
+				est     = top[layout_index(hh->layout, layer+1, x+j)];
+				budget -= est;
+
+				if ( est >= threshold ) {
+					frontier64_push_back(next, x+j, est);
+				}
+			}
+		}
+	} else {
+		for (i = 0; i < cur->count; i++) { // branches
+			x = cur->elm[i] << gran;
+			for (j = 0; j < k; j++) {
+				next->elm[i*k+j] = x+j;
+			}
+		}
+
+		sketch_points64(hh->tree[layer-top_cnt], next->elm, next->est, n);
+
+		for (i = 0, j = 0; i < n; i++) {
+			if ( next->est[i] >= threshold ) {
+				next->elm[j] = next->elm[i];
+				next->est[j] = next->est[i];
+				j++;
+			}
+		}
+		next->count = j;
+	}
+}
+
+heavy_hitter64_t *hh_ktree64_query(hh_ktree64_t *restrict hh) {
+	uint8_t layer;
+	uint32_t i;
+	frontier64_t *cur        = hh->cur;
+	frontier64_t *next       = hh->next;
+	const double threshold   = hh->params->phi*hh->norm;
+
+	cur->count = 0;
+	frontier64_push_back(cur, 0, hh->norm);
+
+	for (layer = 0; layer < hh->logm && cur->count > 0; layer++) {
+		hh_ktree64_expand(hh, layer, cur, next, threshold);
+		frontier64_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+
+	if ( unlikely(cur->count > hh->result.size) ) {
+		hh->result.size    = cur->count;
+		hh->result.hitters = xrealloc(hh->result.hitters,
+				hh->result.size*sizeof(uint64_t));
+	}
+
+	for (i = 0; i < cur->count; i++) {
+		hh->result.hitters[i] = cur->elm[i];
+	}
+	hh->result.count = cur->count;
+
+	return &hh->result;
+}
+
+// Snapshots
+void hh_ktree64_save(hh_ktree64_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i;
+
+	snapshot_add(snap, "grans", 0, hh->grans, sizeof(uint8_t) * hh->logm);
+	snapshot_add(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "top", 0, hh->top, 
+			sizeof(uint64_t) * hh->layout->size);
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_save(hh->tree[i], snap, i);
+	}
+}
+
+void hh_ktree64_load(hh_ktree64_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i;
+
+	snapshot_check(snap, "grans", 0, hh->grans, sizeof(uint8_t) * hh->logm);
+	snapshot_check(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "top", 0, hh->top, 
+			sizeof(uint64_t) * hh->layout->size);
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_load(hh->tree[i], snap, i);
+	}
+}
@@ -0,0 +1,72 @@
+#ifndef H_hh_ktree64
+#define H_hh_ktree64
+
+// Standard libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// User defined libraries
+#include "util/hash.h"
+#include "util/frontier.h"
+#include "util/layout.h"
+#include "hh/hh.h"
+#include "sketch/sketch.h"
+
+// Most layers of a tree, every layer spans one bit at least
+#define KTREE64_LAYERS 64
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint8_t         bits;  // Bits of the keys, at most 64
+	uint32_t        b;
+	uint8_t         gran;  // Bits of every layer below its parent, 0 chooses
+	                       // them by phi and the cache sizes
+	uint8_t         exact; // Exactly counted top layers, 0 chooses them by
+	                       // the cache cost model
+	sketch_func_t  *restrict f;
+} hh_ktree64_params_t;
+
+// The k-ary tree of hh_ktree over keys of up to 64 bits, kept apart such that
+// the 32-bit engine keeps its narrower keys and frontiers
+typedef struct {
+	sketch_t             **restrict tree;
+	uint64_t              *restrict top;
+	layout_t              *restrict layout;
+	uint8_t                top_cnt;
+	uint8_t                logm;
+	bool                   prune;  // Scans of exact children stop once the
+	                               // mass of the parent is used up
+	uint8_t               *restrict grans; // Bits of every layer below its
+	                                       // parent
+	uint64_t               norm;
+	hh_ktree64_params_t   *restrict params;
+	frontier64_t          *restrict cur;
+	frontier64_t          *restrict next;
+	heavy_hitter64_t       result;
+} hh_ktree64_t;
+
+// Granularity
+uint8_t hh_ktree64_granularity(const hh_ktree64_params_t *restrict params,
+		uint8_t *restrict grans);
+
+// Initialization
+hh_ktree64_t *hh_ktree64_create(heavy_hitter_params_t *restrict p);
+
+// Destuction
+void hh_ktree64_destroy(hh_ktree64_t *restrict hh);
+
+// Update
+void hh_ktree64_update(hh_ktree64_t *restrict hh, const uint64_t idx,
+		const int64_t c);
+
+// Query
+heavy_hitter64_t *hh_ktree64_query(hh_ktree64_t *restrict hh);
+
+// Snapshots
+void hh_ktree64_save(hh_ktree64_t *restrict hh, snapshot_t *restrict snap);
+void hh_ktree64_load(hh_ktree64_t *restrict hh, snapshot_t *restrict snap);
+
+#endif
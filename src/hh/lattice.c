@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/lattice.h"
+#include "sketch/sketch.h"
+#include "util/frontier.h"
+#include "util/hash.h"
+#include "util/layout.h"
+#include "util/xutil.h"
+
+// Prefix of the given levels of a key
+static inline uint32_t hh_lattice_prefix(const uint32_t key,
+		const uint8_t level, const uint8_t gran) {
+	return (level > 0) ? key >> (32 - level*gran) : 0;
+}
+
+// Initialization
+hh_lattice_t *hh_lattice_create(heavy_hitter_params_t *restrict p) {
+	uint32_t i, j, n, size, sketched = 0;
+	hh_lattice_params_t *restrict params = (hh_lattice_params_t *)p->params;
+	const uint8_t  gran    = (params->gran > 0) ? params->gran : 8;
+	const uint8_t  exact   = (params->exact > 0) ? params->exact : 16;
+	const double   share   = (params->share > 0) ? params->share : 1.;
+	const uint8_t  levels  = 32/gran + 1;
+	const uint32_t nodes   = levels*levels;
+	uint32_t w             = ceil(params->b / params->epsilon) * p->hash->c;
+	uint32_t d             = ceil(log2(1 / params->delta) / log2(params->b));
+
+	if ( unlikely(gran > 16 || 32 % gran != 0) ) {
+		xerror("The granularity must divide 32 and be at most 16", __LINE__,
+				__FILE__);
+	}
+
+	hh_lattice_t *restrict hh = xmalloc( sizeof(hh_lattice_t) );
+
+	hh->exact = xmalloc( sizeof(uint64_t *) * nodes );
+
+	for (i = 0; i < levels; i++) {
+		for (j = 0; j < levels; j++) {
+			n = i*levels + j;
+
+			if ( (i+j)*gran <= exact ) {
+				size         = (uint32_t)1 << ((i+j)*gran);
+				hh->exact[n] = xmalloc( sizeof(uint64_t) * size );
+				memset(hh->exact[n], '\0', sizeof(uint64_t) * size);
+			} else {
+				hh->exact[n] = NULL;
+				sketched++;
+			}
+		}
+	}
+
+	sketch_fixed_size(&d, &w);
+
+	// Every sketched node adds the whole mass to the shared table, hashes into
+	// 2^M bins get a power of two
+	w = (sketched > 0) ? ceil(share*sketched*w) : 0;
+
+	if ( w > 0 && p->hash->pow2 ) {
+		w = next_pow_2(w);
+	}
+
+	size               = w*d;
+
+	hh->table          = (size > 0) ?
+		xmalloc_aligned( LAYOUT_ALIGN, sizeof(uint64_t) * size ) : NULL;
+	hh->seeds          = xmalloc( sizeof(uint64_t) * 3 * nodes * d );
+	hh->hash           = p->hash;
+	hh->w              = w;
+	hh->d              = d;
+	hh->M              = 0;
+	hh->gran           = gran;
+	hh->levels         = levels;
+	hh->norm           = 0;
+	hh->params         = params;
+	hh->cur            = frontier64_create(1 << gran);
+	hh->next           = frontier64_create(1 << gran);
+	hh->result.count   = 0;
+	hh->result.size    = 1 << gran;
+	hh->result.hitters = xmalloc( sizeof(pair_t) * hh->result.size );
+
+	if ( size > 0 ) {
+		memset(hh->table, '\0', sizeof(uint64_t) * size);
+		hash_init(&hh->M, w);
+	}
+
+	// Salting the hash by node keeps the pairs of the nodes apart
+	for (i = 0; i < nodes*d; i++) {
+		hh->seeds[3*i]   = p->hash->agen();
+		hh->seeds[3*i+1] = p->hash->bgen(hh->M);
+		hh->seeds[3*i+2] = xuni_rand64();
+	}
+
+	#ifdef SPACE
+	uint64_t space = sizeof(uint64_t) * (size + 3*nodes*d) +
+		sizeof(hh_lattice_t);
+	fprintf(stderr, "Space usage excluding exact nodes: %"PRIu64" bytes\n\n",
+			space);
+	#endif
+
+	return hh;
+}
+
+// Destruction
+void hh_lattice_destroy(hh_lattice_t *restrict hh) {
+	uint32_t n;
+
+	if (hh == NULL) {
+		return;
+	}
+
+	for (n = 0; n < (uint32_t)hh->levels*hh->levels; n++) {
+		free(hh->exact[n]);
+	}
+
+	free(hh->exact);
+	free(hh->table);
+	free(hh->seeds);
+	free(hh->result.hitters);
+	frontier64_destroy(hh->cur);
+	frontier64_destroy(hh->next);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Counter of the pair key in row r, hashed with the parameters of the node
+static inline uint32_t hh_lattice_cell(hh_lattice_t *restrict hh,
+		const uint32_t n, const uint32_t r, const uint64_t key) {
+	const uint64_t *restrict seed = hh->seeds + 3*(n*hh->d + r);
+
+	return r*hh->w + hh->hash->hash64(hh->w, hh->M, key ^ seed[2], seed[0],
+			seed[1]);
+}
+
+// Update
+void hh_lattice_update(hh_lattice_t *restrict hh, const uint32_t src,
+		const uint32_t dst, const int64_t c) {
+	uint8_t i, j;
+	uint32_t r, n, s, t;
+	uint64_t key;
+	uint64_t *restrict table = hh->table;
+	const uint8_t levels     = hh->levels;
+	const uint8_t gran       = hh->gran;
+	const uint32_t d         = hh->d;
+
+	hh->norm += c;
+
+	for (i = 0; i < levels; i++) {
+		s = hh_lattice_prefix(src, i, gran);
+
+		for (j = 0; j < levels; j++) {
+			t = hh_lattice_prefix(dst, j, gran);
+			n = i*levels + j;
+
+			if ( hh->exact[n] != NULL ) {
+				hh->exact[n][((uint64_t)s << (j*gran)) | t] += c;
+			} else {
+				key = ((uint64_t)s << 32) | t;
+
+				for (r = 0; r < d; r++) {
+					table[hh_lattice_cell(hh, n, r, key)] += c;
+				}
+			}
+		}
+	}
+}
+
+// Estimate of the pair of prefixes (s, t) at node (i, j)
+static int64_t hh_lattice_estimate(hh_lattice_t *restrict hh,
+		const uint8_t i, const uint8_t j, const uint32_t s, const uint32_t t) {
+	uint32_t r;
+	uint64_t e, estimate    = UINT64_MAX;
+	const uint32_t n        = i*hh->levels + j;
+	const uint64_t key      = ((uint64_t)s << 32) | t;
+
+	if ( hh->exact[n] != NULL ) {
+		return hh->exact[n][((uint64_t)s << (j*hh->gran)) | t];
+	}
+
+	for (r = 0; r < hh->d; r++) {
+		e        = hh->table[hh_lattice_cell(hh, n, r, key)];
+		estimate = (e < estimate) ? e : estimate;
+	}
+
+	return estimate;
+}
+
+int64_t hh_lattice_point(hh_lattice_t *restrict hh, const uint8_t src_bits,
+		const uint8_t dst_bits, const uint32_t src, const uint32_t dst) {
+	const uint8_t gran = hh->gran;
+
+	if ( unlikely(src_bits % gran != 0 || dst_bits % gran != 0 ||
+				src_bits > 32 || dst_bits > 32) ) {
+		xerror("Prefix bits must be multiples of the granularity", __LINE__,
+				__FILE__);
+	}
+
+	return hh_lattice_estimate(hh, src_bits/gran, dst_bits/gran, src, dst);
+}
+
+// Expands the pairs of cur into the pairs of node (i, j), refining the source
+// prefix if src is set and the destination prefix otherwise. Children of an
+// exactly counted node are scanned until the mass left of the parent cannot
+// make another child heavy. Like the minimum over the rows, this assumes that
+// no count is negative.
+static void hh_lattice_expand(hh_lattice_t *restrict hh, const uint8_t i,
+		const uint8_t j, const bool src, frontier64_t *restrict cur,
+		frontier64_t *restrict next, const double threshold) {
+	uint32_t x, k, s, t;
+	int64_t est, budget;
+	const uint8_t gran  = hh->gran;
+	const uint32_t kids = (uint32_t)1 << gran;
+	const bool exact    = hh->exact[i*hh->levels + j] != NULL;
+
+	next->count = 0;
+
+	for (x = 0; x < cur->count; x++) {
+		s      = cur->elm[x] >> 32;
+		t      = (uint32_t)cur->elm[x];
+		budget = cur->est[x];
+
+		for (k = 0; k < kids && (!exact || budget >= threshold); k++) {
+			if ( src ) {
+				est = hh_lattice_estimate(hh, i, j, (s << gran) | k, t);
+			} else {
+				est = hh_lattice_estimate(hh, i, j, s, (t << gran) | k);
+			}
+
+			budget -= est;
+
+			if ( est >= threshold ) {
+				frontier64_push_back(next, src ?
+						((uint64_t)((s << gran) | k) << 32) | t :
+						((uint64_t)s << 32) | ((t << gran) | k), est);
+			}
+		}
+	}
+}
+
+// Refines the source prefixes down to src_bits first and the destination
+// prefixes after, every node on the way is an ancestor of the queried node
+heavy_hitter_pairs_t *hh_lattice_query(hh_lattice_t *restrict hh,
+		const uint8_t src_bits, const uint8_t dst_bits, const double phi) {
+	uint8_t i, j;
+	uint32_t x;
+	frontier64_t *cur   = hh->cur;
+	frontier64_t *next  = hh->next;
+	const uint8_t gran  = hh->gran;
+	const uint8_t a     = src_bits/gran;
+	const uint8_t b     = dst_bits/gran;
+	const double th     = phi*hh->norm;
+
+	if ( unlikely(src_bits % gran != 0 || dst_bits % gran != 0 ||
+				src_bits > 32 || dst_bits > 32) ) {
+		xerror("Prefix bits must be multiples of the granularity", __LINE__,
+				__FILE__);
+	}
+
+	cur->count = 0;
+	frontier64_push_back(cur, 0, hh->norm);
+
+	for (i = 1; i <= a && cur->count > 0; i++) {
+		hh_lattice_expand(hh, i, 0, true, cur, next, th);
+		frontier64_swap(&cur, &next);
+	}
+
+	for (j = 1; j <= b && cur->count > 0; j++) {
+		hh_lattice_expand(hh, a, j, false, cur, next, th);
+		frontier64_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+
+	if ( unlikely(cur->count > hh->result.size) ) {
+		hh->result.size    = cur->count;
+		hh->result.hitters = xrealloc(hh->result.hitters,
+				hh->result.size*sizeof(pair_t));
+	}
+
+	for (x = 0; x < cur->count; x++) {
+		hh->result.hitters[x].src   = cur->elm[x] >> 32;
+		hh->result.hitters[x].dst   = (uint32_t)cur->elm[x];
+		hh->result.hitters[x].count = cur->est[x];
+	}
+
+	hh->result.count    = (a+b > 0 || hh->norm >= th) ? cur->count : 0;
+	hh->result.src_bits = src_bits;
+	hh->result.dst_bits = dst_bits;
+
+	return &hh->result;
+}
@@ -0,0 +1,84 @@
+#ifndef H_hh_lattice
+#define H_hh_lattice
+
+// Standard libraries
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/frontier.h"
+#include "util/hash.h"
+
+// Structures
+typedef struct {
+	double          epsilon;
+	double          delta;
+	uint32_t        b;
+	uint8_t         gran;  // Bits of a prefix level of either key, dividing
+	                       // 32, 0 is 8
+	uint8_t         exact; // Most bits of a pair of prefixes counted exactly,
+	                       // 0 is 16
+	double          share; // Counters of the shared table relative to one
+	                       // table per sketched node, 0 is 1
+} hh_lattice_params_t;
+
+// A heavy pair of a source and a destination prefix
+typedef struct {
+	uint32_t src;
+	uint32_t dst;
+	int64_t  count; // Estimated count
+} pair_t;
+
+// Sorted by source, then by destination prefix
+typedef struct {
+	pair_t  *restrict hitters;
+	uint32_t count;
+	uint32_t size;
+	uint8_t  src_bits;
+	uint8_t  dst_bits;
+} heavy_hitter_pairs_t;
+
+/**
+ * Heavy hitters over pairs of 32-bit keys, such as the source and destination
+ * of a flow, at every combination of prefix lengths. Node (i, j) of the
+ * lattice counts the pairs of the source prefixes of i levels and the
+ * destination prefixes of j levels. Nodes of few prefixes are counted
+ * exactly, while all others share a single table, each salting its hashes.
+ */
+typedef struct {
+	uint64_t             **restrict exact;  // Counters of every node, NULL if
+	                                        // the node is sketched
+	uint64_t              *restrict table;  // d rows of w counters shared by
+	                                        // the sketched nodes
+	uint64_t              *restrict seeds;  // Hash parameters and salt of
+	                                        // every node and row
+	hash_t                *restrict hash;
+	uint32_t               w;
+	uint32_t               d;
+	uint8_t                M;
+	uint8_t                gran;
+	uint8_t                levels; // Prefix lengths of a key, 0 included
+	uint64_t               norm;
+	hh_lattice_params_t   *restrict params;
+	frontier64_t          *restrict cur;
+	frontier64_t          *restrict next;
+	heavy_hitter_pairs_t   result;
+} hh_lattice_t;
+
+// Initialization
+hh_lattice_t *hh_lattice_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_lattice_destroy(hh_lattice_t *restrict hh);
+
+// Update
+void hh_lattice_update(hh_lattice_t *restrict hh, const uint32_t src,
+		const uint32_t dst, const int64_t c);
+
+// Query, the bits are multiples of gran and phi is a fraction of the norm
+heavy_hitter_pairs_t *hh_lattice_query(hh_lattice_t *restrict hh,
+		const uint8_t src_bits, const uint8_t dst_bits, const double phi);
+int64_t hh_lattice_point(hh_lattice_t *restrict hh, const uint8_t src_bits,
+		const uint8_t dst_bits, const uint32_t src, const uint32_t dst);
+
+#endif
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/sample.h"
+#include "util/xutil.h"
+
+// Updates or units dropped before the next kept one
+static inline uint64_t hh_sample_skip(const hh_sample_t *restrict hh) {
+	const double skip = floor(log(1. - xuni_rand()) / hh->logq);
+
+	return (skip < (double)UINT64_MAX) ? (uint64_t)skip : UINT64_MAX;
+}
+
+// Units kept of n, each with probability p. A small mean counts the gaps
+// between kept units, a large one is drawn by the transformed rejection with
+// squeeze of Hormann (BTRS), in constant expected time.
+static uint64_t hh_sample_binomial(const uint64_t n, const double p) {
+	uint64_t k = 0;
+	double x, u, v, us, logq;
+
+	if ( p > 0.5 ) {
+		return n - hh_sample_binomial(n, 1. - p);
+	}
+
+	if ( n == 0 || p <= 0 ) {
+		return 0;
+	}
+
+	if ( n*p < 10 ) {
+		logq = log(1. - p);
+
+		for (x = floor(log(1. - xuni_rand()) / logq); x < n; k++) {
+			x += floor(log(1. - xuni_rand()) / logq) + 1;
+		}
+
+		return k;
+	}
+
+	const double spq   = sqrt(n*p*(1. - p));
+	const double b     = 1.15 + 2.53*spq;
+	const double a     = -0.0873 + 0.0248*b + 0.01*p;
+	const double c     = n*p + 0.5;
+	const double vr    = 0.92 - 4.2/b;
+	const double alpha = (2.83 + 5.1/b)*spq;
+	const double lpq   = log(p/(1. - p));
+	const double m     = floor((n + 1)*p);
+	const double h     = lgamma(m + 1) + lgamma(n - m + 1);
+
+	while (true) {
+		u  = xuni_rand() - 0.5;
+		v  = xuni_rand();
+		us = 0.5 - fabs(u);
+		x  = floor((2*a/us + b)*u + c);
+
+		if ( x < 0 || x > n ) {
+			continue;
+		}
+
+		if ( us >= 0.07 && v <= vr ) {
+			return (uint64_t)x;
+		}
+
+		v = log(v*alpha/(a/(us*us) + b));
+
+		if ( v <= h - lgamma(x + 1) - lgamma(n - x + 1) + (x - m)*lpq ) {
+			return (uint64_t)x;
+		}
+	}
+}
+
+// Initialization
+hh_sample_t *hh_sample_create(heavy_hitter_params_t *restrict p) {
+	hh_sample_params_t *restrict params = (hh_sample_params_t *)p->params;
+	hh_sample_t *restrict hh = xmalloc( sizeof(hh_sample_t) );
+
+	assert(params->p > 0 && params->p <= 1);
+
+	hh->engine          = heavy_hitter_create(params->engine);
+	hh->logq            = log(1. - params->p);
+	hh->max             = 0;
+	hh->params          = params;
+	hh->thresholds_size = 1;
+	hh->thresholds      = xmalloc( sizeof(heavy_hitter_threshold_t) );
+	hh->skip            = hh_sample_skip(hh);
+	heavy_hitter_estimates_init(&hh->estimates, 1);
+
+	return hh;
+}
+
+// Destruction
+void hh_sample_destroy(hh_sample_t *restrict hh) {
+	if (hh == NULL) {
+		return;
+	}
+
+	heavy_hitter_destroy(hh->engine);
+	heavy_hitter_estimates_free(&hh->estimates);
+	free(hh->thresholds);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Update
+void hh_sample_update(hh_sample_t *restrict hh, const uint32_t idx,
+		const int64_t c) {
+	uint64_t units, kept;
+
+	if ( !hh->params->weighted ) {
+		if ( likely(hh->skip > 0) ) {
+			hh->skip--;
+			return;
+		}
+
+		hh->skip = hh_sample_skip(hh);
+		hh->max  = ((uint64_t)llabs(c) > hh->max) ? (uint64_t)llabs(c) : hh->max;
+		heavy_hitter_update(hh->engine, idx, c);
+
+		return;
+	}
+
+	units = llabs(c);
+
+	if ( likely(units <= hh->skip) ) {
+		hh->skip -= units;
+		return;
+	}
+
+	// The unit after the skip is kept, and each of the units left is kept
+	// independently. The next skip starts after the last unit.
+	units   -= hh->skip + 1;
+	kept     = 1 + hh_sample_binomial(units, hh->params->p);
+	hh->skip = hh_sample_skip(hh);
+	hh->max  = 1;
+	heavy_hitter_update(hh->engine, idx, (c < 0) ? -(int64_t)kept :
+			(int64_t)kept);
+}
+
+heavy_hitter_t *hh_sample_query(hh_sample_t *restrict hh) {
+	return heavy_hitter_query(hh->engine);
+}
+
+heavy_hitter_t *hh_sample_topk(hh_sample_t *restrict hh, const uint32_t k) {
+	return heavy_hitter_topk(hh->engine, k);
+}
+
+// The estimate of a kept count f is f/p, whose error grows by three standard
+// deviations of the sampling, sqrt(f*max*(1-p)/p) for counts of at most max
+heavy_hitter_estimates_t *hh_sample_query_thresholds(hh_sample_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	double count, error;
+	heavy_hitter_estimates_t *restrict res;
+	const double p = hh->params->p;
+
+	if ( unlikely(n > hh->thresholds_size) ) {
+		hh->thresholds_size = n;
+		hh->thresholds      = xrealloc(hh->thresholds, 
+				n*sizeof(heavy_hitter_threshold_t));
+	}
+
+	for (i = 0; i < n; i++) {
+		hh->thresholds[i] = thresholds[i];
+
+		if ( thresholds[i].absolute ) {
+			hh->thresholds[i].value *= p;
+		}
+	}
+
+	res = heavy_hitter_query_thresholds(hh->engine, hh->thresholds, n);
+
+	// Scaling keeps the order, so the nesting of the engine holds
+	hh->estimates.count = 0;
+
+	for (i = 0; i < res->count; i++) {
+		count = res->hitters[i].count / p;
+		error = res->hitters[i].error / p + ((count > 0) ?
+			3*sqrt(count*hh->max*(1-p)/p) : 0);
+
+		heavy_hitter_estimates_push(&hh->estimates, res->hitters[i].id,
+				llround(count), ceil(error));
+	}
+
+	if ( unlikely(n > hh->estimates.nested_size) ) {
+		hh->estimates.nested_size = n;
+		hh->estimates.nested      = xrealloc(hh->estimates.nested,
+				n*sizeof(uint32_t));
+	}
+
+	memcpy(hh->estimates.nested, res->nested, n*sizeof(uint32_t));
+
+	return &hh->estimates;
+}
+
+// Snapshots
+void hh_sample_save(hh_sample_t *restrict hh, snapshot_t *restrict snap) {
+	snapshot_add(snap, "skip", 0, &hh->skip, sizeof(uint64_t));
+	snapshot_add(snap, "max", 0, &hh->max, sizeof(uint64_t));
+
+	snapshot_nest(snap, "engine");
+	heavy_hitter_snapshot_save(hh->engine, snap);
+	snapshot_unnest(snap);
+}
+
+void hh_sample_load(hh_sample_t *restrict hh, snapshot_t *restrict snap) {
+	snapshot_read(snap, "skip", 0, &hh->skip, sizeof(uint64_t));
+	snapshot_read(snap, "max", 0, &hh->max, sizeof(uint64_t));
+
+	snapshot_nest(snap, "engine");
+	heavy_hitter_snapshot_load(hh->engine, snap);
+	snapshot_unnest(snap);
+}
@@ -0,0 +1,61 @@
+#ifndef H_hh_sample
+#define H_hh_sample
+
+// Standard libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+
+// Structures
+typedef struct {
+	double                 p;        // Probability of keeping an update, in
+	                                 // (0, 1]
+	bool                   weighted; // Keep every unit of the count of an
+	                                 // update with probability p instead
+	heavy_hitter_params_t *engine;   // Engine of the kept updates
+} hh_sample_params_t;
+
+/**
+ * Forwards a random sample of the updates to the configured engine. The
+ * updates dropped between two kept ones are drawn from a geometric
+ * distribution, such that dropping costs a decrement rather than a random
+ * number. Weighted sampling keeps every unit of a count independently, as a
+ * binomial draw of the count. Fractional thresholds hold for the sample as
+ * well, absolute ones are scaled by p, and the estimates are scaled by 1/p
+ * with their error widened by the sampling error.
+ */
+typedef struct {
+	hh_t                  *restrict engine;
+	uint64_t               skip;     // Updates or units dropped before the
+	                                 // next kept one
+	double                 logq;     // Logarithm of 1-p
+	uint64_t               max;      // Largest count kept
+	hh_sample_params_t    *restrict params;
+	heavy_hitter_threshold_t *restrict thresholds;
+	uint32_t               thresholds_size;
+	heavy_hitter_estimates_t estimates;
+} hh_sample_t;
+
+// Initialization
+hh_sample_t *hh_sample_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_sample_destroy(hh_sample_t *restrict hh);
+
+// Update
+void hh_sample_update(hh_sample_t *restrict hh, const uint32_t idx,
+		const int64_t c);
+
+// Query, the queries by phi compare the sample to its own norm
+heavy_hitter_t *hh_sample_query(hh_sample_t *restrict hh);
+heavy_hitter_t *hh_sample_topk(hh_sample_t *restrict hh, const uint32_t k);
+heavy_hitter_estimates_t *hh_sample_query_thresholds(hh_sample_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_sample_save(hh_sample_t *restrict hh, snapshot_t *restrict snap);
+void hh_sample_load(hh_sample_t *restrict hh, snapshot_t *restrict snap);
+
+#endif
@@ -0,0 +1,485 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/shared_sketch.h"
+#include "sketch/sketch.h"
+#include "util/cache.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
+#include "util/hash.h"
+#include "util/xutil.h"
+
+// Layer i has 2^(i+1) nodes, while every sketched layer owns its share of the
+// shared table
+static uint8_t hh_shared_sketch_exact_layers(const uint8_t logm,
+		const uint64_t bytes, const uint32_t d) {
+	uint8_t i;
+	uint64_t nodes[logm];
+
+	for (i = 0; i < logm; i++) {
+		nodes[i] = (uint64_t)2 << i;
+	}
+
+	return cache_exact_layers(nodes, logm, bytes, d, 0, 0);
+}
+
+// Initialization
+hh_shared_sketch_t *hh_shared_sketch_create(heavy_hitter_params_t *restrict p) {
+	uint32_t i, size;
+	hh_shared_sketch_params_t *restrict params =
+		(hh_shared_sketch_params_t *)p->params;
+	const double   phi         = params->phi;
+	const double   epsilon     = params->epsilon;
+	const uint32_t m           = params->m;
+	const uint32_t b           = params->b;
+	const double   share       = (params->share > 0) ? params->share : 1.;
+	const uint8_t  logm        = floor(log2((uint64_t)m+1));
+	const double   delta       = (params->delta*phi)/(2.*logm);
+	const uint32_t twophi      = ceil(2./phi);
+	const uint32_t result_size = sizeof(uint32_t) * twophi;
+	uint32_t w                 = ceil(b / epsilon) * p->hash->c;
+	uint32_t d                 = ceil(log2(1 / delta) / log2(b));
+	uint8_t top_cnt, layers;
+	uint8_t gran[logm];
+
+	hh_shared_sketch_t *restrict hh = xmalloc( sizeof(hh_shared_sketch_t) );
+
+	assert(phi > epsilon);
+
+	sketch_fixed_size(&d, &w);
+
+	if ( params->exact > 0 ) {
+		top_cnt = params->exact;
+	} else {
+		top_cnt = hh_shared_sketch_exact_layers(logm,
+				share*sizeof(uint64_t)*w*d, d);
+	}
+
+	if (top_cnt > logm) {
+		top_cnt = logm;
+	}
+
+	// Every sketched layer adds the whole mass to the shared table, so its
+	// error grows as the table shrinks below one table per layer. Hashes into
+	// 2^M bins get a power of two, the error is that of the width used
+	layers = logm-top_cnt;
+	w      = (layers > 0) ? ceil(share*layers*w) : 0;
+
+	if ( w > 0 && p->hash->pow2 ) {
+		w = next_pow_2(w);
+	}
+
+	size   = w*d;
+
+	memset(gran, 1, sizeof(gran)); // branch=2
+	hh->layout         = layout_create(gran, top_cnt+1);
+	hh->top            = xmalloc_aligned( LAYOUT_ALIGN,
+			sizeof(uint64_t) * hh->layout->size );
+	memset(hh->top, '\0', sizeof(uint64_t) * hh->layout->size);
+	hh->table          = (size > 0) ?
+		xmalloc_aligned( LAYOUT_ALIGN, sizeof(uint64_t) * size ) : NULL;
+	hh->seeds          = (size > 0) ?
+		xmalloc( sizeof(uint64_t) * 3 * layers * d ) : NULL;
+	hh->hash           = p->hash;
+	hh->w              = w;
+	hh->d              = d;
+	hh->M              = 0;
+	hh->top_cnt        = top_cnt;
+	hh->logm           = logm;
+	hh->epsilon        = (layers > 0) ? (double)b*p->hash->c*layers/w : 0;
+	hh->norm           = 0;
+	hh->params         = params;
+	hh->cur            = frontier_create(2*twophi);
+	hh->next           = frontier_create(2*twophi);
+	hh->heap           = heap_create(2*twophi);
+	hh->result.count   = 0;
+	hh->result.size    = twophi;
+	hh->result.hitters = xmalloc( result_size );
+	memset(hh->result.hitters, '\0', result_size);
+	heavy_hitter_estimates_init(&hh->estimates, twophi);
+
+	if ( size > 0 ) {
+		memset(hh->table, '\0', sizeof(uint64_t) * size);
+		hash_init(&hh->M, w);
+
+		// Salting the hash by layer keeps the prefixes of the layers apart
+		for (i = 0; i < layers*d; i++) {
+			hh->seeds[3*i]   = p->hash->agen();
+			hh->seeds[3*i+1] = p->hash->bgen(hh->M);
+			hh->seeds[3*i+2] = (uint32_t)(xuni_rand() * UINT32_MAX);
+		}
+	}
+
+	#ifdef SPACE
+	uint64_t space = sizeof(uint64_t) * (hh->layout->size + size +
+			3*layers*d) + result_size + sizeof(hh_shared_sketch_t);
+	fprintf(stderr, "Space usage: %"PRIu64" bytes\n\n", space);
+	#endif
+
+	return hh;
+}
+
+// Destruction
+void hh_shared_sketch_destroy(hh_shared_sketch_t *restrict hh) {
+	if (hh == NULL) {
+		return;
+	}
+
+	if (hh->top != NULL) {
+		free(hh->top);
+		hh->top = NULL;
+	}
+
+	if (hh->table != NULL) {
+		free(hh->table);
+		hh->table = NULL;
+	}
+
+	if (hh->seeds != NULL) {
+		free(hh->seeds);
+		hh->seeds = NULL;
+	}
+
+	if (hh->layout != NULL) {
+		layout_destroy(hh->layout);
+		hh->layout = NULL;
+	}
+
+	if (hh->cur != NULL) {
+		frontier_destroy(hh->cur);
+		hh->cur = NULL;
+	}
+
+	if (hh->next != NULL) {
+		frontier_destroy(hh->next);
+		hh->next = NULL;
+	}
+
+	if (hh->heap != NULL) {
+		heap_destroy(hh->heap);
+		hh->heap = NULL;
+	}
+
+	if (hh->result.hitters != NULL) {
+		free(hh->result.hitters);
+		hh->result.hitters = NULL;
+	}
+
+	heavy_hitter_estimates_free(&hh->estimates);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Counter of x in row r, hashed with the parameters of the sketched layer. The
+// key is salted as well, since hashes like multiply-shift map 0 to 0 under 
+// any parameters.
+static inline uint32_t hh_shared_sketch_cell(hh_shared_sketch_t *restrict hh,
+		const uint8_t layer, const uint32_t r, const uint32_t x) {
+	const uint64_t *restrict seed = hh->seeds + 3*(layer*hh->d + r);
+
+	return r*hh->w + hh->hash->hash(hh->w, hh->M, x ^ (uint32_t)seed[2], 
+			seed[0], seed[1]);
+}
+
+// Update
+void hh_shared_sketch_update(hh_shared_sketch_t *restrict hh,
+		const uint32_t idx, const int64_t c) {
+	int8_t i;
+	uint32_t r;
+	uint32_t x               = idx;
+	uint64_t *restrict table = hh->table;
+	uint64_t *restrict top   = hh->top;
+	const uint8_t top_cnt    = hh->top_cnt;
+	const uint8_t logm       = hh->logm;
+	const uint32_t d         = hh->d;
+
+	hh->norm += c;
+
+	for (i = logm-top_cnt-1; i > -1; i--) {
+		for (r = 0; r < d; r++) {
+			table[hh_shared_sketch_cell(hh, i, r, x)] += c;
+		}
+		x >>= 1;
+	}
+
+	for (i = top_cnt-1; i > -1; i--) {
+		top[layout_index(hh->layout, i+1, x)] += c;
+		x >>= 1;
+	}
+}
+
+// Query
+static inline void hh_shared_sketch_resize_result(heavy_hitter_t *res) {
+	if ( unlikely(res->count >= res->size) ) {
+		res->hitters = xrealloc(res->hitters, res->size*2*sizeof(uint32_t));
+		memset(res->hitters+res->size, '\0', res->size*sizeof(uint32_t));
+		res->size += res->size;
+	}
+}
+
+// Batched point queries of a sketched layer, prefetching the counters of a
+// batch before reading any of them
+static void hh_shared_sketch_points(hh_shared_sketch_t *restrict hh,
+		const uint8_t layer, const uint32_t *restrict elm,
+		int64_t *restrict est, const uint32_t n) {
+	uint32_t j, t, r, cnt;
+	uint64_t e;
+	const uint32_t d         = hh->d;
+	uint64_t *restrict table = hh->table;
+	uint32_t idx[SKETCH_BATCH*d];
+
+	for (j = 0; j < n; j += SKETCH_BATCH) {
+		cnt = (n-j < SKETCH_BATCH) ? n-j : SKETCH_BATCH;
+
+		for (r = 0; r < d; r++) {
+			for (t = 0; t < cnt; t++) {
+				idx[r*SKETCH_BATCH+t] = hh_shared_sketch_cell(hh, layer, r,
+						elm[j+t]);
+
+				__builtin_prefetch(&table[idx[r*SKETCH_BATCH+t]], 0, 1);
+			}
+		}
+
+		for (t = 0; t < cnt; t++) {
+			e = table[idx[t]];
+			for (r = 1; r < d; r++) {
+				e = (table[idx[r*SKETCH_BATCH+t]] < e) ?
+					table[idx[r*SKETCH_BATCH+t]] : e;
+			}
+
+			est[j+t] = (int64_t)e;
+		}
+	}
+}
+
+// Expands the children of the frontier cur at the given layer into next,
+// keeping only those above the threshold. Where the parent is counted
+// exactly, the children are scanned until the mass left of the parent cannot
+// make another child heavy. Like the minimum over the rows, this assumes that
+// no count is negative.
+static void hh_shared_sketch_expand(hh_shared_sketch_t *restrict hh,
+		const uint8_t layer, frontier_t *restrict cur,
+		frontier_t *restrict next, const double threshold) {
+	uint32_t i, j, n, x;
+	int64_t est, budget;
+	const uint8_t top_cnt   = hh->top_cnt;
+	uint64_t *restrict top  = hh->top;
+
+	n = 2*cur->count;
+
+	frontier_clear(next);
+	frontier_reserve(next, n);
+
+	if ( layer < top_cnt ) {
+		for (i = 0; i < cur->count; i++) {
+			x      = 2*cur->elm[i];
+			budget = cur->est[i];
+
+			for (j = 0; j < 2 && budget >= threshold; j++) { // branch=2
+				est     = top[layout_index(hh->layout, layer+1, x+j)];
+				budget -= est;
+
+				if ( est >= threshold ) {
+					frontier_push_back(next, x+j, est);
+				}
+			}
+		}
+	} else {
+		for (i = 0; i < cur->count; i++) { // branch=2
+			next->elm[2*i]   = 2*cur->elm[i];
+			next->elm[2*i+1] = 2*cur->elm[i]+1;
+		}
+
+		hh_shared_sketch_points(hh, layer-top_cnt, next->elm, next->est, n);
+
+		for (i = 0, j = 0; i < n; i++) {
+			if ( next->est[i] >= threshold ) {
+				next->elm[j] = next->elm[i];
+				next->est[j] = next->est[i];
+				j++;
+			}
+		}
+		next->count = j;
+	}
+}
+
+// Expands one whole level at a time, the surviving leaves and their estimates
+// are left in hh->cur
+static void hh_shared_sketch_walk(hh_shared_sketch_t *restrict hh,
+		const double threshold) {
+	uint8_t layer;
+	const uint8_t logm = hh->logm;
+	frontier_t *cur    = hh->cur;
+	frontier_t *next   = hh->next;
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, hh->norm);
+
+	for (layer = 0; layer < logm && cur->count > 0; layer++) {
+		hh_shared_sketch_expand(hh, layer, cur, next, threshold);
+		frontier_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+}
+
+heavy_hitter_t *hh_shared_sketch_query(hh_shared_sketch_t *restrict hh) {
+	uint32_t i;
+	frontier_t *leaves;
+
+	hh->result.count = 0;
+
+	memset(hh->result.hitters, '\0', hh->result.size);
+
+	hh_shared_sketch_walk(hh, hh->params->phi*hh->norm);
+	leaves = hh->cur;
+
+	for (i = 0; i < leaves->count; i++) {
+		hh->result.hitters[hh->result.count] = leaves->elm[i];
+
+		assert( leaves->elm[i] <= hh->params->m );
+
+		hh->result.count++;
+
+		hh_shared_sketch_resize_result(&hh->result);
+	}
+
+	return &hh->result;
+}
+
+// Walks the tree once at the lowest threshold, the estimates of the leaves
+// are kept from the walk
+heavy_hitter_estimates_t *hh_shared_sketch_query_thresholds(
+		hh_shared_sketch_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	frontier_t *leaves;
+	const int64_t error = ( hh->top_cnt < hh->logm ) ?
+		ceil(hh->epsilon*hh->norm) : 0;
+
+	hh->estimates.count = 0;
+
+	hh_shared_sketch_walk(hh, heavy_hitter_min_threshold(thresholds, n,
+				hh->norm));
+	leaves = hh->cur;
+
+	for (i = 0; i < leaves->count; i++) {
+		heavy_hitter_estimates_push(&hh->estimates, leaves->elm[i],
+				leaves->est[i], error);
+	}
+
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, hh->norm);
+
+	return &hh->estimates;
+}
+
+// Estimates both children of the node x at the given layer, clamped to the
+// estimate of the node
+static void hh_shared_sketch_children(hh_shared_sketch_t *restrict hh,
+		const uint8_t layer, const uint32_t x, const int64_t est,
+		frontier_t *restrict children) {
+	uint32_t j;
+	const uint8_t top_cnt = hh->top_cnt;
+
+	frontier_clear(children);
+	frontier_reserve(children, 2);
+
+	for (j = 0; j < 2; j++) { // branch=2
+		children->elm[j] = 2*x+j;
+	}
+	children->count = 2;
+
+	if ( layer < top_cnt ) {
+		for (j = 0; j < 2; j++) {
+			children->est[j] = hh->top[layout_index(hh->layout, layer+1,
+					children->elm[j])];
+		}
+	} else {
+		hh_shared_sketch_points(hh, layer-top_cnt, children->elm,
+				children->est, 2);
+	}
+
+	for (j = 0; j < 2; j++) {
+		children->est[j] = (children->est[j] < est) ? children->est[j] : est;
+	}
+}
+
+// Walks the tree best-first, popping the leaves in order of decreasing
+// estimate until k have been found
+heavy_hitter_t *hh_shared_sketch_topk(hh_shared_sketch_t *restrict hh,
+		const uint32_t k) {
+	uint32_t j, x;
+	uint8_t layer;
+	int64_t est;
+	node_t *node;
+	const uint8_t logm    = hh->logm;
+	heap_t *restrict heap = hh->heap;
+	frontier_t *children  = hh->next;
+
+	hh->result.count = 0;
+
+	heap_clear(heap);
+	heap_push(heap, 0, 0, hh->norm);
+
+	while ( hh->result.count < k && (node = heap_pop(heap)) != NULL ) {
+		x     = node->elm;
+		layer = node->layer;
+		est   = node->est;
+
+		if ( unlikely(layer == logm) ) {
+			hh->result.hitters[hh->result.count] = x;
+
+			assert( x <= hh->params->m );
+
+			hh->result.count++;
+
+			hh_shared_sketch_resize_result(&hh->result);
+			continue;
+		}
+
+		hh_shared_sketch_children(hh, layer, x, est, children);
+
+		for (j = 0; j < children->count; j++) {
+			if ( children->est[j] > 0 ) {
+				heap_push(heap, children->elm[j], layer+1, children->est[j]);
+			}
+		}
+	}
+
+	return &hh->result;
+}
+
+// Snapshots
+void hh_shared_sketch_save(hh_shared_sketch_t *restrict hh,
+		snapshot_t *restrict snap) {
+	const uint64_t size = (uint64_t)hh->w*hh->d;
+
+	snapshot_add(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "top", 0, hh->top,
+			sizeof(uint64_t) * hh->layout->size);
+	snapshot_add(snap, "table", 0, hh->table, sizeof(uint64_t) * size);
+	snapshot_add(snap, "seeds", 0, hh->seeds, (size > 0) ?
+			sizeof(uint64_t) * 3 * (hh->logm-hh->top_cnt) * hh->d : 0);
+}
+
+void hh_shared_sketch_load(hh_shared_sketch_t *restrict hh,
+		snapshot_t *restrict snap) {
+	const uint64_t size = (uint64_t)hh->w*hh->d;
+
+	snapshot_check(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "top", 0, hh->top,
+			sizeof(uint64_t) * hh->layout->size);
+	snapshot_read(snap, "table", 0, hh->table, sizeof(uint64_t) * size);
+	snapshot_read(snap, "seeds", 0, hh->seeds, (size > 0) ?
+			sizeof(uint64_t) * 3 * (hh->logm-hh->top_cnt) * hh->d : 0);
+}
@@ -0,0 +1,75 @@
+#ifndef H_hh_shared_sketch
+#define H_hh_shared_sketch
+
+// Standard libraries
+#include <stdbool.h>
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
+#include "util/hash.h"
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint32_t        m;
+	uint32_t        b;
+	uint8_t         exact; // Exactly counted top layers, 0 chooses them by
+	                       // the cache cost model
+	double          share; // Counters of the shared table relative to one
+	                       // table per sketched layer, 0 is 1
+} hh_shared_sketch_params_t;
+
+typedef struct {
+	uint64_t                  *restrict top;
+	uint64_t                  *restrict table; // d rows of w counters shared
+	                                           // by all sketched layers
+	uint64_t                  *restrict seeds; // Hash parameters and salt of
+	                                           // every sketched layer and row
+	hash_t                    *restrict hash;
+	layout_t                  *restrict layout;
+	uint32_t                   w;
+	uint32_t                   d;
+	uint8_t                    M;
+	uint8_t                    top_cnt;
+	uint8_t                    logm;
+	double                     epsilon; // Error of a sketched estimate
+	uint64_t                   norm;
+	hh_shared_sketch_params_t *restrict params;
+	frontier_t                *restrict cur;
+	frontier_t                *restrict next;
+	heap_t                    *restrict heap;
+	heavy_hitter_t             result;
+	heavy_hitter_estimates_t   estimates;
+} hh_shared_sketch_t;
+
+// Initialization
+hh_shared_sketch_t *hh_shared_sketch_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_shared_sketch_destroy(hh_shared_sketch_t *restrict hh);
+
+// Update
+void hh_shared_sketch_update(hh_shared_sketch_t *restrict hh,
+		const uint32_t idx, const int64_t c);
+
+// Query
+heavy_hitter_t *hh_shared_sketch_query(hh_shared_sketch_t *restrict hh);
+heavy_hitter_t *hh_shared_sketch_topk(hh_shared_sketch_t *restrict hh,
+		const uint32_t k);
+heavy_hitter_estimates_t *hh_shared_sketch_query_thresholds(
+		hh_shared_sketch_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_shared_sketch_save(hh_shared_sketch_t *restrict hh,
+		snapshot_t *restrict snap);
+void hh_shared_sketch_load(hh_shared_sketch_t *restrict hh,
+		snapshot_t *restrict snap);
+
+#endif
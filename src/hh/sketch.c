@@ -6,11 +6,49 @@
 #include <assert.h>
 
 #include "util/xutil.h"
-#include "util/fifo.h"
+#include "util/cache.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
 #include "hh/hh.h"
 #include "hh/sketch.h"
 #include "sketch/sketch.h"
 
+// Layer i has 2^(i+1) nodes, while every sketched layer holds a w*d sketch
+static uint8_t hh_sketch_exact_layers(const uint8_t logm, const uint32_t w, 
+		const uint32_t d) {
+	uint8_t i;
+	uint64_t nodes[logm];
+
+	for (i = 0; i < logm; i++) {
+		nodes[i] = (uint64_t)2 << i;
+	}
+
+	return cache_exact_layers(nodes, logm, sizeof(uint64_t)*w*d, d, 0, 0);
+}
+
+// Sketch of a layer with the type and size given by the per layer policies of
+// the parameters, autosize narrows the inner layers but never the leaves
+static sketch_t *hh_sketch_layer(heavy_hitter_params_t *restrict p, 
+		const uint8_t layer, const uint8_t logm) {
+	hh_sketch_params_t *restrict params = (hh_sketch_params_t *)p->params;
+	sketch_func_t *restrict f = (params->fs != NULL) ? 
+		params->fs[layer] : params->f;
+	double epsilon = (params->epsilons != NULL) ? 
+		params->epsilons[layer] : params->epsilon;
+	double delta   = (params->deltas != NULL) ? 
+		params->deltas[layer] : params->delta;
+
+	if ( params->autosize && layer < logm-1 ) {
+		epsilon = heavy_hitter_layer_epsilon(epsilon, params->b, 
+				(uint64_t)2 << layer, f->one_sided ? params->phi : 0);
+	}
+
+	delta = (delta*params->phi)/(2.*logm);
+
+	return sketch_create(f, p->hash, params->b, epsilon, delta);
+}
+
 hh_sketch_t *hh_sketch_create(heavy_hitter_params_t *restrict p) {
 	int8_t i;
 	uint8_t np2_base;
@@ -18,17 +56,14 @@ hh_sketch_t *hh_sketch_create(heavy_hitter_params_t *restrict p) {
 	hh_sketch_params_t *restrict params = (hh_sketch_params_t *)p->params;
 	const uint32_t m           = params->m;
 	const uint8_t logm         = floor(log2((uint64_t)m+1));
+	uint8_t gran[logm];
 	const double phi           = params->phi;
-	const double epsilon       = params->epsilon;
 	const uint32_t twophi      = ceil(2./phi);
-	double delta               = (double)((params->delta*phi)/(2.*logm));
-	const uint32_t b           = params->b;
 	const uint32_t result_size = sizeof(uint32_t) * twophi;
 	hh_sketch_t *restrict hh   = xmalloc( sizeof(hh_sketch_t) );
-	sketch_t    *restrict s    = sketch_create(params->f, p->hash, b, epsilon, 
-			delta);
+	sketch_t    *restrict s    = hh_sketch_layer(p, logm-1, logm);
 
-	assert(phi > epsilon);
+	assert(phi > params->epsilon);
 	
 	// This only works since the sketch_size_t appears first in the *_sketch_t 
 	// structures!
@@ -36,34 +71,49 @@ hh_sketch_t *hh_sketch_create(heavy_hitter_params_t *restrict p) {
 	d                  = sketch_depth(s->sketch);
 
 	hh->logm           = logm;
+	hh->prune          = s->funcs->one_sided;
 	hh->params         = params;
 	hh->norm           = 0;
 	hh->result.count   = 0; 
-	hh->fifo           = fifo_create(twophi);
+	hh->cur            = frontier_create(2*twophi);
+	hh->next           = frontier_create(2*twophi);
+	hh->levels         = frontier_create(2*twophi);
+	hh->heap           = heap_create(2*twophi);
+	hh->candidates     = (params->incremental) ? 
+		candidates_create(twophi, params->crossing, params->arg) : NULL;
 	hh->result.size    = twophi;
 	hh->result.hitters = xmalloc( result_size );
 	memset(hh->result.hitters, '\0', result_size);
+	heavy_hitter_estimates_init(&hh->estimates, twophi);
+	heavy_hitter_hhh_init(&hh->hhh, twophi);
 
-	// Find the base (log2) of the next power of two of w*d
-	np2_base        = MultiplyDeBruijnBitPosition2[
-		(uint32_t)(next_pow_2(w*d) * 0x077CB531U) >> 27
-	]; //+ 1; We only do exact when it is below size of sketch
+	if ( params->exact > 0 ) {
+		np2_base = params->exact;
+	} else {
+		np2_base = hh_sketch_exact_layers(logm, w, d);
+	}
 
 	if (np2_base > logm) {
 		np2_base = logm;
 	}
 
-	top_tree_size = sizeof(uint64_t) * ((1 << (np2_base+1))-2);
-	hh->top       = xmalloc( top_tree_size );
+	memset(gran, 1, sizeof(gran)); // branch=2
+	hh->layout    = layout_create(gran, np2_base+1);
+	top_tree_size = sizeof(uint64_t) * hh->layout->size;
+	hh->top       = xmalloc_aligned( LAYOUT_ALIGN, top_tree_size );
 	memset(hh->top, '\0', top_tree_size );
 	hh->top_cnt   = np2_base;
 
 	if ( np2_base < logm ) {
 		hh->tree = xmalloc( sizeof(sketch_t *) * (logm-np2_base) );
 		for (i = 0; i < (logm-1)-np2_base; i++) {
-			hh->tree[i] = sketch_create(params->f, p->hash, b, epsilon, delta);
+			hh->tree[i] = hh_sketch_layer(p, np2_base+i, logm);
 		}
 		hh->tree[i] = s;
+
+		for (i = 0; params->colocate && i < logm-np2_base; i++) {
+			sketch_siblings(hh->tree[i]->sketch, 1); // branch=2
+		}
 	} else {
 		hh->tree = NULL;
 		sketch_destroy(s);
@@ -91,9 +141,34 @@ void hh_sketch_destroy(hh_sketch_t *restrict hh) {
 		hh->top = NULL;
 	}
 
-	if (hh->fifo != NULL) {
-		fifo_destroy(hh->fifo);
-		hh->fifo = NULL;
+	if (hh->layout != NULL) {
+		layout_destroy(hh->layout);
+		hh->layout = NULL;
+	}
+
+	if (hh->cur != NULL) {
+		frontier_destroy(hh->cur);
+		hh->cur = NULL;
+	}
+
+	if (hh->next != NULL) {
+		frontier_destroy(hh->next);
+		hh->next = NULL;
+	}
+
+	if (hh->levels != NULL) {
+		frontier_destroy(hh->levels);
+		hh->levels = NULL;
+	}
+
+	if (hh->heap != NULL) {
+		heap_destroy(hh->heap);
+		hh->heap = NULL;
+	}
+
+	if (hh->candidates != NULL) {
+		candidates_destroy(hh->candidates);
+		hh->candidates = NULL;
 	}
 
 	if (hh->result.hitters != NULL) {
@@ -101,6 +176,9 @@ void hh_sketch_destroy(hh_sketch_t *restrict hh) {
 		hh->result.hitters = NULL;
 	}
 
+	heavy_hitter_estimates_free(&hh->estimates);
+	heavy_hitter_hhh_free(&hh->hhh);
+
 	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
 		sketch_destroy(hh->tree[i]);
 	}
@@ -114,6 +192,7 @@ void hh_sketch_update(hh_sketch_t *restrict hh, const uint32_t idx,
 		const int64_t c) {
 	int8_t i;
 	uint32_t x;
+	int64_t est              = 0;
 	sketch_t **restrict tree = hh->tree;
 	uint64_t  *restrict top  = hh->top;
 	const uint8_t top_cnt    = hh->top_cnt; 
@@ -121,17 +200,34 @@ void hh_sketch_update(hh_sketch_t *restrict hh, const uint32_t idx,
 	hh->norm                += c;
 
 	x = idx;
+	i = logm-top_cnt-1;
+
+	// Read the leaf estimate while updating it
+	if ( hh->candidates != NULL && i > -1 ) {
+		est = sketch_update_point(tree[i], x, c);
+		x >>= 1;
+		i--;
+	}
 
 	// Use sketches to estimate count instead
-	for (i = logm-top_cnt-1; i > -1; i--) {
+	for (; i > -1; i--) {
 		sketch_update(tree[i], x, c);
 		x >>= 1;
 	}
 
 	for (i = top_cnt-1; i > -1; i--) {
-		top[x + (2 << i)-2] += c;
+		top[layout_index(hh->layout, i+1, x)] += c;
 		x >>= 1;
 	}
+
+	if ( hh->candidates != NULL ) {
+		if ( unlikely(top_cnt == logm) ) {
+			est = top[layout_index(hh->layout, logm, idx)];
+		}
+
+		candidates_update(hh->candidates, idx, c, est, 
+				hh->params->phi*hh->norm);
+	}
 }
 	
 //Query
@@ -182,7 +278,7 @@ static void hh_sketch_query_top_recursive(hh_sketch_t *restrict hh,
 	for (i = 0; i < 2; i++) {
 		x += i;	
 
-		if ( top[x+(1 << (layer+1))-2] >= th ) {
+		if ( top[layout_index(hh->layout, layer+1, x)] >= th ) {
 			if ( unlikely(layer == logm-1) ) {
 				hh->result.hitters[hh->result.count] = x;
 
@@ -201,59 +297,273 @@ static void hh_sketch_query_top_recursive(hh_sketch_t *restrict hh,
 }
 
 
-heavy_hitter_t *hh_sketch_query(hh_sketch_t *restrict hh) {
-	uint32_t x, idx;
-	uint8_t i, layer;
-	elm_t *res;
+// Expands the children of the frontier cur at the given layer into next, 
+// keeping only those above the threshold. Where the parent is counted 
+// exactly, the children are scanned until the mass left of the parent cannot 
+// make another child heavy. This needs non-negative counts, so the children 
+// are all scanned over Count-Median, which is used for deletions.
+static void hh_sketch_expand(hh_sketch_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next, 
+		const double threshold) {
+	uint32_t i, j, n, x;
+	int64_t est, budget;
 	const uint8_t top_cnt    = hh->top_cnt; 
-	const uint8_t logm       = hh->logm;
-	const double threshold   = hh->params->phi*hh->norm;
+	const bool prune         = hh->prune;
 	sketch_t **restrict tree = hh->tree;
 	uint64_t  *restrict top  = hh->top;
-	fifo_t    *restrict fifo = hh->fifo;
+
+	n = 2*cur->count;
+
+	frontier_clear(next);
+	frontier_reserve(next, n);
+
+	if ( layer < top_cnt ) {
+		for (i = 0; i < cur->count; i++) {
+			x      = 2*cur->elm[i];
+			budget = cur->est[i];
+
+			for (j = 0; j < 2 && (!prune || budget >= threshold); j++) {
+				est     = top[layout_index(hh->layout, layer+1, x+j)];
+				budget -= est;
+
+				if ( est >= threshold ) {
+					frontier_push_back(next, x+j, est);
+				}
+			}
+		}
+	} else {
+		for (i = 0; i < cur->count; i++) { // branch=2
+			next->elm[2*i]   = 2*cur->elm[i];
+			next->elm[2*i+1] = 2*cur->elm[i]+1;
+		}
+
+		sketch_points(tree[layer-top_cnt], next->elm, next->est, n);
+
+		for (i = 0, j = 0; i < n; i++) {
+			if ( next->est[i] >= threshold ) {
+				next->elm[j] = next->elm[i];
+				next->est[j] = next->est[i];
+				j++;
+			}
+		}
+		next->count = j;
+	}
+}
+
+// Expand one whole level at a time, such that all point queries of a level 
+// are independent and can be batched. The surviving leaves and their 
+// estimates are left in hh->cur.
+static void hh_sketch_walk(hh_sketch_t *restrict hh, const double threshold) {
+	uint8_t layer;
+	const uint8_t logm       = hh->logm;
+	frontier_t *cur          = hh->cur;
+	frontier_t *next         = hh->next;
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, hh->norm);
+
+	for (layer = 0; layer < logm && cur->count > 0; layer++) {
+		hh_sketch_expand(hh, layer, cur, next, threshold);
+		frontier_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+}
+
+// Estimates the leaves without clamping them to their ancestors
+static void hh_sketch_leaves(hh_sketch_t *restrict hh, 
+		frontier_t *restrict leaves) {
+	uint32_t i;
+	const uint8_t top_cnt    = hh->top_cnt; 
+	const uint8_t logm       = hh->logm;
+
+	if ( top_cnt < logm ) {
+		sketch_points(hh->tree[logm-top_cnt-1], leaves->elm, leaves->est, 
+				leaves->count);
+	} else {
+		for (i = 0; i < leaves->count; i++) {
+			leaves->est[i] = hh->top[layout_index(hh->layout, logm, 
+					leaves->elm[i])];
+		}
+	}
+}
+
+// In incremental mode only the candidates have to be validated, unless a 
+// negative update has invalidated them
+static void hh_sketch_find(hh_sketch_t *restrict hh, const double threshold) {
+	candidates_t *restrict cand = hh->candidates;
+
+	if ( cand != NULL && cand->valid ) {
+		candidates_collect(cand, hh->cur);
+		hh_sketch_leaves(hh, hh->cur);
+		candidates_retain(cand, hh->cur, threshold);
+	} else {
+		hh_sketch_walk(hh, threshold);
+
+		if ( cand != NULL ) {
+			candidates_reset(cand, hh->cur);
+		}
+	}
+}
+
+heavy_hitter_t *hh_sketch_query(hh_sketch_t *restrict hh) {
+	uint32_t i;
+	frontier_t *leaves;
 
 	hh->result.count         = 0;
 
 	memset(hh->result.hitters, '\0', hh->result.size); 
 
-	fifo_push_back(fifo, 0, 0);
+	hh_sketch_find(hh, hh->params->phi*hh->norm);
+	leaves = hh->cur;
+
+	for (i = 0; i < leaves->count; i++) {
+		hh->result.hitters[hh->result.count] = leaves->elm[i];
+
+		assert( leaves->elm[i] <= hh->params->m );
+
+		hh->result.count++;
 
-	while ( !fifo_empty(fifo) ) {
-		res   = fifo_pop_front(fifo);
-		idx   = 2*res->elm;
-		layer = res->layer;
+		hh_sketch_resize_result(&hh->result);
+	}
 
-		for (i = 0; i < 2; i++) { // branch=2
-			x = idx+i;
+	return &hh->result;
+}
 
-			if ( layer < top_cnt  ) {
-				if ( top[x+(1 << (layer+1))-2] >= threshold ) {
-					if ( unlikely(layer == logm-1) ) {
-						hh->result.hitters[hh->result.count] = x;
+// Walks the tree once at the lowest threshold, the estimates of the leaves 
+// are kept from the walk
+heavy_hitter_estimates_t *hh_sketch_query_thresholds(hh_sketch_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	frontier_t *leaves;
+	const int64_t error = ( hh->top_cnt < hh->logm ) ? 
+		sketch_error(hh->tree[hh->logm-hh->top_cnt-1], hh->norm) : 0;
 
-						assert( x <= hh->params->m );
+	hh->estimates.count = 0;
 
-						hh->result.count++;
+	hh_sketch_walk(hh, heavy_hitter_min_threshold(thresholds, n, hh->norm));
+	leaves = hh->cur;
 
-						hh_sketch_resize_result(&hh->result);
-					} else {
-						fifo_push_back(fifo, x, layer+1);
-					}
-				}
-			} else {
-				if ( sketch_point(tree[layer-top_cnt], x) >= threshold ) {
-					if ( unlikely( layer == logm-1 ) ) {
-						hh->result.hitters[hh->result.count] = x;
+	for (i = 0; i < leaves->count; i++) {
+		heavy_hitter_estimates_push(&hh->estimates, leaves->elm[i], 
+				leaves->est[i], error);
+	}
+
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, hh->norm);
+
+	return &hh->estimates;
+}
 
-						assert( x <= hh->params->m );
+// Estimates all children of the node x at the given layer, clamped to the 
+// estimate of the node
+static void hh_sketch_children(hh_sketch_t *restrict hh, const uint8_t layer,
+		const uint32_t x, const int64_t est, frontier_t *restrict children) {
+	uint32_t j;
+	const uint8_t top_cnt = hh->top_cnt; 
 
-						hh->result.count++;
+	frontier_clear(children);
+	frontier_reserve(children, 2);
 
-						hh_sketch_resize_result(&hh->result);
-					} else {
-						fifo_push_back(fifo, x, layer+1);
-					}
-				} 
+	for (j = 0; j < 2; j++) { // branch=2
+		children->elm[j] = 2*x+j;
+	}
+	children->count = 2;
+
+	if ( layer < top_cnt ) {
+		for (j = 0; j < 2; j++) {
+			children->est[j] = hh->top[layout_index(hh->layout, layer+1, 
+					children->elm[j])];
+		}
+	} else {
+		sketch_points(hh->tree[layer-top_cnt], children->elm, children->est, 2);
+	}
+
+	for (j = 0; j < 2; j++) {
+		children->est[j] = (children->est[j] < est) ? children->est[j] : est;
+	}
+}
+
+// Walks the tree once at the threshold, keeping the heavy prefixes of every 
+// depth in hh->levels for the discounting
+heavy_hitter_hhh_t *hh_sketch_query_hhh(hh_sketch_t *restrict hh, 
+		const double phi) {
+	uint8_t layer;
+	uint32_t i;
+	frontier_t *cur          = hh->cur;
+	frontier_t *next         = hh->next;
+	frontier_t *levels       = hh->levels;
+	const uint8_t logm       = hh->logm;
+	const double th          = phi*hh->norm;
+	uint32_t offsets[logm+2];
+	uint8_t gran[logm];
+
+	memset(gran, 1, sizeof(gran)); // branch=2
+
+	frontier_clear(levels);
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, hh->norm);
+
+	for (layer = 0; layer <= logm; layer++) {
+		offsets[layer] = levels->count;
+
+		for (i = 0; i < cur->count; i++) {
+			frontier_push_back(levels, cur->elm[i], cur->est[i]);
+		}
+
+		if ( layer < logm ) {
+			hh_sketch_expand(hh, layer, cur, next, th);
+			frontier_swap(&cur, &next);
+		}
+	}
+	offsets[layer] = levels->count;
+
+	hh->cur  = cur;
+	hh->next = next;
+
+	heavy_hitter_hhh_finish(&hh->hhh, levels, offsets, gran, logm+1, th);
+
+	return &hh->hhh;
+}
+
+// Walks the tree best-first, always expanding the node with the largest 
+// estimate. Since no child is estimated above its parent, the leaves are 
+// popped in order of decreasing estimate, and the walk stops after k leaves.
+heavy_hitter_t *hh_sketch_topk(hh_sketch_t *restrict hh, const uint32_t k) {
+	uint32_t j, x;
+	uint8_t layer;
+	int64_t est;
+	node_t *node;
+	const uint8_t logm       = hh->logm;
+	heap_t *restrict heap    = hh->heap;
+	frontier_t *children     = hh->next;
+
+	hh->result.count         = 0;
+
+	heap_clear(heap);
+	heap_push(heap, 0, 0, hh->norm);
+
+	while ( hh->result.count < k && (node = heap_pop(heap)) != NULL ) {
+		x     = node->elm;
+		layer = node->layer;
+		est   = node->est;
+
+		if ( unlikely(layer == logm) ) {
+			hh->result.hitters[hh->result.count] = x;
+
+			assert( x <= hh->params->m );
+
+			hh->result.count++;
+
+			hh_sketch_resize_result(&hh->result);
+			continue;
+		}
+
+		hh_sketch_children(hh, layer, x, est, children);
+
+		for (j = 0; j < children->count; j++) {
+			if ( children->est[j] > 0 ) {
+				heap_push(heap, children->elm[j], layer+1, children->est[j]);
 			}
 		}
 	}
@@ -272,3 +582,36 @@ heavy_hitter_t *hh_sketch_query_recursive(hh_sketch_t *restrict hh) {
 
 	return &hh->result;
 }
+
+// Snapshots
+void hh_sketch_save(hh_sketch_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i;
+
+	snapshot_add(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "top", 0, hh->top, 
+			sizeof(uint64_t) * hh->layout->size);
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_save(hh->tree[i], snap, i);
+	}
+}
+
+void hh_sketch_load(hh_sketch_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i;
+
+	// The exact layers chosen by the cache model may differ between machines
+	snapshot_check(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "top", 0, hh->top, 
+			sizeof(uint64_t) * hh->layout->size);
+
+	for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+		sketch_load(hh->tree[i], snap, i);
+	}
+
+	// Candidates are not saved, the next query walks the tree
+	if ( hh->candidates != NULL ) {
+		hh->candidates->valid = false;
+	}
+}
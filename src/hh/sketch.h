@@ -2,12 +2,16 @@
 #define H_hh_sketch
 
 // Standard libraries
+#include <stdbool.h>
 #include <stdint.h>
 
 // User defined libraries
 #include "util/hash.h"
-#include "util/fifo.h"
+#include "util/frontier.h"
+#include "util/heap.h"
+#include "util/layout.h"
 #include "hh/hh.h"
+#include "hh/candidates.h"
 #include "sketch/sketch.h"
 
 // Structures
@@ -17,18 +21,41 @@ typedef struct {
 	double          delta;
 	uint32_t        m;
 	uint32_t        b;
+	uint8_t         exact;       // Exactly counted top layers, 0 chooses them
+	                             // by the cache cost model
+	bool            incremental; // Maintain heavy hitter candidates during 
+	                             // updates, valid for non-negative updates
+	bool            colocate;    // Place the children of a node in one 
+	                             // block of every sketched row
+	const double   *epsilons;    // Epsilon of every layer, NULL uses epsilon
+	const double   *deltas;      // Delta of every layer, NULL uses delta
+	bool            autosize;    // Derive the epsilon of the sketched inner 
+	                             // layers from their amount of prefixes and
+	                             // from phi, see heavy_hitter_layer_epsilon
+	hh_crossing     crossing;    // Called when an item becomes a candidate
+	void           *arg;         // Passed to crossing
+	sketch_func_t **fs;          // Sketch of every layer, NULL uses f
 	sketch_func_t  *restrict f;
 } hh_sketch_params_t;
 
 typedef struct {
 	sketch_t             **restrict tree;
 	uint64_t              *restrict top;
+	layout_t              *restrict layout;
 	uint8_t                top_cnt;
 	uint8_t                logm;
+	bool                   prune;  // Scans of exact children stop once the
+	                               // mass of the parent is used up
 	uint64_t               norm;
 	hh_sketch_params_t    *restrict params;
-	fifo_t                *restrict fifo;
+	frontier_t            *restrict cur;
+	frontier_t            *restrict next;
+	frontier_t            *restrict levels; // Heavy prefixes of every depth
+	heap_t                *restrict heap;
+	candidates_t          *restrict candidates;
 	heavy_hitter_t         result;
+	heavy_hitter_estimates_t estimates;
+	heavy_hitter_hhh_t     hhh;
 } hh_sketch_t; 
 
 // Initialization
@@ -43,6 +70,15 @@ void hh_sketch_update(hh_sketch_t *restrict hh, const uint32_t idx,
 
 // Query
 heavy_hitter_t *hh_sketch_query(hh_sketch_t *restrict hh);
+heavy_hitter_t *hh_sketch_topk(hh_sketch_t *restrict hh, const uint32_t k);
+heavy_hitter_estimates_t *hh_sketch_query_thresholds(hh_sketch_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+heavy_hitter_hhh_t *hh_sketch_query_hhh(hh_sketch_t *restrict hh, 
+		const double phi);
 heavy_hitter_t *hh_sketch_query_recursive(hh_sketch_t *restrict hh);
 
+// Snapshots
+void hh_sketch_save(hh_sketch_t *restrict hh, snapshot_t *restrict snap);
+void hh_sketch_load(hh_sketch_t *restrict hh, snapshot_t *restrict snap);
+
 #endif
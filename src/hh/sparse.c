@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "hh/hh.h"
+#include "hh/sparse.h"
+#include "util/table.h"
+#include "util/xutil.h"
+
+// Initialization
+hh_sparse_t *hh_sparse_create(heavy_hitter_params_t *restrict p) {
+	hh_sparse_params_t *restrict params = (hh_sparse_params_t *)p->params;
+	const uint32_t twophi    = ceil(2./params->phi);
+	hh_sparse_t *restrict hh = xmalloc( sizeof(hh_sparse_t) );
+
+	hh->table          = table_create(64);
+	hh->engine         = NULL;
+	hh->norm           = 0;
+	hh->params         = params;
+	hh->result.count   = 0;
+	hh->result.size    = twophi;
+	hh->result.hitters = xmalloc( sizeof(uint32_t) * twophi );
+	heavy_hitter_estimates_init(&hh->estimates, twophi);
+
+	return hh;
+}
+
+// Destruction
+void hh_sparse_destroy(hh_sparse_t *restrict hh) {
+	if (hh == NULL) {
+		return;
+	}
+
+	if (hh->table != NULL) {
+		table_destroy(hh->table);
+	}
+
+	heavy_hitter_destroy(hh->engine);
+	heavy_hitter_estimates_free(&hh->estimates);
+	free(hh->result.hitters);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Creates the engine and replays the exact counts into it
+static void hh_sparse_migrate(hh_sparse_t *restrict hh) {
+	uint32_t i;
+	table_t *restrict table = hh->table;
+
+	hh->engine = heavy_hitter_create(hh->params->engine);
+
+	for (i = 0; i < table->size; i++) {
+		if ( table->keys[i] != TABLE_EMPTY && table->vals[i] != 0 ) {
+			heavy_hitter_update(hh->engine, table_key(table, i),
+					table->vals[i]);
+		}
+	}
+
+	table_destroy(table);
+	hh->table = NULL;
+}
+
+// Update
+void hh_sparse_update(hh_sparse_t *restrict hh, const uint32_t idx,
+		const int64_t c) {
+	const uint32_t limit = (hh->params->limit > 0) ? hh->params->limit : 4096;
+
+	hh->norm += c;
+
+	if ( likely(hh->engine != NULL) ) {
+		heavy_hitter_update(hh->engine, idx, c);
+		return;
+	}
+
+	*table_insert(hh->table, idx) += c;
+
+	if ( unlikely(hh->table->count > limit) ) {
+		hh_sparse_migrate(hh);
+	}
+}
+
+// Exact counts of the keys above the threshold
+static void hh_sparse_find(hh_sparse_t *restrict hh, const double threshold) {
+	uint32_t i;
+	table_t *restrict table = hh->table;
+
+	hh->estimates.count = 0;
+
+	for (i = 0; i < table->size; i++) {
+		if ( table->keys[i] != TABLE_EMPTY && table->vals[i] >= threshold ) {
+			heavy_hitter_estimates_push(&hh->estimates, table_key(table, i),
+					table->vals[i], 0);
+		}
+	}
+}
+
+static inline void hh_sparse_resize_result(heavy_hitter_t *restrict res,
+		const uint32_t count) {
+	if ( unlikely(count > res->size) ) {
+		res->size    = count;
+		res->hitters = xrealloc(res->hitters, res->size*sizeof(uint32_t));
+	}
+}
+
+static int hh_sparse_compare(const void *a, const void *b) {
+	const uint32_t x = *(const uint32_t *)a;
+	const uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+// Sorted by key as the tree engines report them
+heavy_hitter_t *hh_sparse_query(hh_sparse_t *restrict hh) {
+	uint32_t i;
+
+	if ( hh->engine != NULL ) {
+		return heavy_hitter_query(hh->engine);
+	}
+
+	hh_sparse_find(hh, hh->params->phi*hh->norm);
+	hh_sparse_resize_result(&hh->result, hh->estimates.count);
+
+	for (i = 0; i < hh->estimates.count; i++) {
+		hh->result.hitters[i] = hh->estimates.hitters[i].id;
+	}
+	hh->result.count = hh->estimates.count;
+
+	qsort(hh->result.hitters, hh->result.count, sizeof(uint32_t),
+			hh_sparse_compare);
+
+	return &hh->result;
+}
+
+heavy_hitter_t *hh_sparse_topk(hh_sparse_t *restrict hh, const uint32_t k) {
+	uint32_t i;
+	const heavy_hitter_threshold_t all = { .value = -INFINITY, 
+		.absolute = true };
+
+	if ( hh->engine != NULL ) {
+		return heavy_hitter_topk(hh->engine, k);
+	}
+
+	hh_sparse_find(hh, all.value);
+	heavy_hitter_estimates_finish(&hh->estimates, &all, 1, hh->norm);
+	hh_sparse_resize_result(&hh->result, k);
+
+	for (i = 0; i < k && i < hh->estimates.count; i++) {
+		hh->result.hitters[i] = hh->estimates.hitters[i].id;
+	}
+	hh->result.count = i;
+
+	return &hh->result;
+}
+
+heavy_hitter_estimates_t *hh_sparse_query_thresholds(hh_sparse_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	if ( hh->engine != NULL ) {
+		return heavy_hitter_query_thresholds(hh->engine, thresholds, n);
+	}
+
+	hh_sparse_find(hh, heavy_hitter_min_threshold(thresholds, n, hh->norm));
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, hh->norm);
+
+	return &hh->estimates;
+}
+
+// Snapshots, either the exact table or the engine it migrated into
+void hh_sparse_save(hh_sparse_t *restrict hh, snapshot_t *restrict snap) {
+	// Sections are only read once the snapshot is written
+	static const uint8_t migrated[2] = {0, 1};
+
+	snapshot_add(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_add(snap, "migrated", 0, &migrated[hh->engine != NULL], 
+			sizeof(uint8_t));
+
+	if ( hh->engine == NULL ) {
+		table_save(hh->table, snap, 0);
+		return;
+	}
+
+	snapshot_nest(snap, "engine");
+	heavy_hitter_snapshot_save(hh->engine, snap);
+	snapshot_unnest(snap);
+}
+
+void hh_sparse_load(hh_sparse_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t migrated;
+
+	snapshot_read(snap, "norm", 0, &hh->norm, sizeof(uint64_t));
+	snapshot_read(snap, "migrated", 0, &migrated, sizeof(uint8_t));
+
+	if ( !migrated ) {
+		if ( hh->engine != NULL ) {
+			heavy_hitter_destroy(hh->engine);
+			hh->engine = NULL;
+			hh->table  = table_create(64);
+		}
+
+		table_load(hh->table, snap, 0);
+		return;
+	}
+
+	if ( hh->engine == NULL ) {
+		table_destroy(hh->table);
+		hh->table  = NULL;
+		hh->engine = heavy_hitter_create(hh->params->engine);
+	}
+
+	snapshot_nest(snap, "engine");
+	heavy_hitter_snapshot_load(hh->engine, snap);
+	snapshot_unnest(snap);
+}
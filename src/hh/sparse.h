@@ -0,0 +1,53 @@
+#ifndef H_hh_sparse
+#define H_hh_sparse
+
+// Standard libraries
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/table.h"
+
+// Structures
+typedef struct {
+	double                 phi;
+	uint32_t               limit;  // Distinct keys counted exactly, 0 is 4096
+	heavy_hitter_params_t *engine; // Engine taking over beyond the limit
+} hh_sparse_params_t;
+
+/**
+ * Counts the keys exactly in a small open addressing table until more than
+ * limit distinct keys were seen, and only then creates the configured engine
+ * and replays the table into it. Streams of few keys never allocate the
+ * engine and are answered exactly.
+ */
+typedef struct {
+	table_t               *restrict table;  // NULL once migrated
+	hh_t                  *restrict engine; // NULL until migrated
+	uint64_t               norm;
+	hh_sparse_params_t    *restrict params;
+	heavy_hitter_t         result;
+	heavy_hitter_estimates_t estimates;
+} hh_sparse_t;
+
+// Initialization
+hh_sparse_t *hh_sparse_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_sparse_destroy(hh_sparse_t *restrict hh);
+
+// Update
+void hh_sparse_update(hh_sparse_t *restrict hh, const uint32_t idx, 
+		const int64_t c);
+
+// Query
+heavy_hitter_t *hh_sparse_query(hh_sparse_t *restrict hh);
+heavy_hitter_t *hh_sparse_topk(hh_sparse_t *restrict hh, const uint32_t k);
+heavy_hitter_estimates_t *hh_sparse_query_thresholds(hh_sparse_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_sparse_save(hh_sparse_t *restrict hh, snapshot_t *restrict snap);
+void hh_sparse_load(hh_sparse_t *restrict hh, snapshot_t *restrict snap);
+
+#endif
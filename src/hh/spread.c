@@ -0,0 +1,290 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/spread.h"
+#include "sketch/sketch.h"
+#include "util/frontier.h"
+#include "util/hash.h"
+#include "util/xutil.h"
+
+// Registers of the prefix x of an exact layer
+static inline uint8_t *hh_spread_top(hh_spread_t *restrict hh,
+		const uint8_t layer, const uint32_t x) {
+	return hh->top + ((((uint64_t)2 << layer) - 2) + x) * hh->R;
+}
+
+// Registers of the cell of the prefix x in row r of a sketched layer
+static inline uint8_t *hh_spread_cell(hh_spread_t *restrict hh,
+		const uint8_t layer, const uint32_t r, const uint32_t x) {
+	const uint32_t row  = (layer - hh->top_cnt)*hh->d + r;
+	const uint32_t cell = hh->hash->hash(hh->w, hh->M, x, hh->seeds[2*row],
+			hh->seeds[2*row+1]);
+
+	return hh->table + ((uint64_t)row*hh->w + cell) * hh->R;
+}
+
+// Hash of a pair for the registers. The pair-multiply-shift is close to
+// linear in the destination of a fixed source, which a scan of consecutive
+// destinations turns into strongly correlated registers, so its bits are
+// mixed by the finalizer of MurmurHash3.
+static inline uint64_t hh_spread_hash(hh_spread_t *restrict hh,
+		const uint32_t src, const uint32_t dst) {
+	uint64_t h = pair_ms(((uint64_t)src << 32) | dst, hh->a, hh->b);
+
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCD;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53;
+	h ^= h >> 33;
+
+	return h;
+}
+
+// HyperLogLog estimate of R registers, by linear counting while registers
+// are still empty and the raw estimate is small
+static double hh_spread_estimate(const uint8_t *restrict regs,
+		const uint32_t R) {
+	uint32_t j, zeros = 0;
+	double e, sum = 0;
+	const double alpha = (R >= 128) ? 0.7213/(1. + 1.079/R) :
+		(R == 64) ? 0.709 : (R == 32) ? 0.697 : 0.673;
+
+	for (j = 0; j < R; j++) {
+		sum   += ldexp(1., -regs[j]);
+		zeros += (regs[j] == 0);
+	}
+
+	e = alpha*R*R/sum;
+
+	if ( e <= 2.5*R && zeros > 0 ) {
+		e = R*log((double)R/zeros);
+	}
+
+	return e;
+}
+
+// Estimate of the prefix x of a layer, the minimum over the rows where the
+// layer is sketched
+static double hh_spread_layer_estimate(hh_spread_t *restrict hh,
+		const uint8_t layer, const uint32_t x) {
+	uint32_t r;
+	double e, estimate = INFINITY;
+
+	if ( layer < hh->top_cnt ) {
+		return hh_spread_estimate(hh_spread_top(hh, layer, x), hh->R);
+	}
+
+	for (r = 0; r < hh->d; r++) {
+		e        = hh_spread_estimate(hh_spread_cell(hh, layer, r, x), hh->R);
+		estimate = (e < estimate) ? e : estimate;
+	}
+
+	return estimate;
+}
+
+// Initialization
+hh_spread_t *hh_spread_create(heavy_hitter_params_t *restrict p) {
+	uint32_t i;
+	uint64_t top_size, table_size;
+	hh_spread_params_t *restrict params = (hh_spread_params_t *)p->params;
+	const uint8_t logm  = floor(log2((uint64_t)params->m+1));
+	const uint32_t R    = (params->registers > 0) ? params->registers : 64;
+	const double phi    = params->phi;
+	const uint32_t twophi = ceil(2./phi);
+	uint32_t w          = ceil(params->b / params->epsilon) * p->hash->c;
+	uint32_t d          = ceil(log2((2.*logm)/(params->delta*phi)) /
+			log2(params->b));
+	uint8_t top_cnt;
+
+	if ( unlikely(R < 16 || (R & (R-1)) != 0) ) {
+		xerror("The registers must be a power of two of at least 16",
+				__LINE__, __FILE__);
+	}
+
+	sketch_fixed_size(&d, &w);
+
+	// Hashes into 2^M bins get a power of two
+	if ( w > 0 && p->hash->pow2 ) {
+		w = next_pow_2(w);
+	}
+
+	// A layer of fewer prefixes than a row gains nothing from hashing
+	if ( params->exact > 0 ) {
+		top_cnt = params->exact;
+	} else {
+		for (top_cnt = 0; top_cnt < logm &&
+				((uint64_t)2 << top_cnt) <= w; top_cnt++) {
+		}
+	}
+	top_cnt = (top_cnt > logm) ? logm : top_cnt;
+
+	hh_spread_t *restrict hh = xmalloc( sizeof(hh_spread_t) );
+
+	top_size       = ((((uint64_t)2 << top_cnt) - 2) * R);
+	table_size     = (uint64_t)(logm-top_cnt)*d*w*R;
+
+	hh->top        = (top_size > 0) ? xmalloc_aligned( 64, top_size ) : NULL;
+	hh->table      = (table_size > 0) ?
+		xmalloc_aligned( 64, table_size ) : NULL;
+	hh->total      = xmalloc( R );
+	hh->seeds      = (table_size > 0) ?
+		xmalloc( sizeof(uint64_t) * 2 * (logm-top_cnt) * d ) : NULL;
+	hh->hash       = p->hash;
+	hh->w          = w;
+	hh->d          = d;
+	hh->R          = R;
+	hh->p          = log2(R);
+	hh->top_cnt    = top_cnt;
+	hh->logm       = logm;
+	hh->params     = params;
+	hh->cur        = frontier_create(2*twophi);
+	hh->next       = frontier_create(2*twophi);
+	heavy_hitter_estimates_init(&hh->result, twophi);
+
+	memset(hh->total, '\0', R);
+	if ( top_size > 0 ) {
+		memset(hh->top, '\0', top_size);
+	}
+	if ( table_size > 0 ) {
+		memset(hh->table, '\0', table_size);
+	}
+
+	hash_init(&hh->M, w);
+
+	for (i = 0; i < (uint32_t)(logm-top_cnt)*d; i++) {
+		hh->seeds[2*i]   = p->hash->agen();
+		hh->seeds[2*i+1] = p->hash->bgen(hh->M);
+	}
+
+	// Seeds of the pair hash
+	hh->a = xuni_rand64();
+	hh->b = xuni_rand64();
+
+	#ifdef SPACE
+	uint64_t space = top_size + table_size + R + sizeof(hh_spread_t);
+	fprintf(stderr, "Space usage: %"PRIu64" bytes\n\n", space);
+	#endif
+
+	return hh;
+}
+
+// Destruction
+void hh_spread_destroy(hh_spread_t *restrict hh) {
+	if (hh == NULL) {
+		return;
+	}
+
+	free(hh->top);
+	free(hh->table);
+	free(hh->total);
+	free(hh->seeds);
+	frontier_destroy(hh->cur);
+	frontier_destroy(hh->next);
+	heavy_hitter_estimates_free(&hh->result);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Update
+void hh_spread_update(hh_spread_t *restrict hh, const uint32_t src,
+		const uint32_t dst) {
+	int8_t i;
+	uint32_t r;
+	uint8_t *restrict regs;
+	const uint8_t p       = hh->p;
+	const uint8_t logm    = hh->logm;
+	const uint8_t top_cnt = hh->top_cnt;
+	const uint64_t h      = hh_spread_hash(hh, src, dst);
+	const uint32_t j      = h >> (64 - p);
+	const uint64_t rest   = h << p;
+	const uint8_t rho     = (rest != 0) ? __builtin_clzll(rest) + 1 : 64-p+1;
+
+	hh->total[j] = (hh->total[j] < rho) ? rho : hh->total[j];
+
+	for (i = logm-1; i >= top_cnt; i--) {
+		for (r = 0; r < hh->d; r++) {
+			regs    = hh_spread_cell(hh, i, r, src >> (logm-1-i));
+			regs[j] = (regs[j] < rho) ? rho : regs[j];
+		}
+	}
+
+	// The registers of a prefix bound those of its descendants
+	for (; i > -1; i--) {
+		regs = hh_spread_top(hh, i, src >> (logm-1-i));
+
+		if ( regs[j] >= rho ) {
+			break;
+		}
+		regs[j] = rho;
+	}
+}
+
+double hh_spread_total(hh_spread_t *restrict hh) {
+	return hh_spread_estimate(hh->total, hh->R);
+}
+
+double hh_spread_point(hh_spread_t *restrict hh, const uint32_t src) {
+	return hh_spread_layer_estimate(hh, hh->logm-1, src);
+}
+
+// Expands the prefixes of cur into their children at the given layer
+static void hh_spread_expand(hh_spread_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next,
+		const double threshold) {
+	uint32_t i, j, x;
+	int64_t est;
+
+	frontier_clear(next);
+
+	for (i = 0; i < cur->count; i++) {
+		x = 2*cur->elm[i];
+
+		for (j = 0; j < 2; j++) { // branch=2
+			est = llround(hh_spread_layer_estimate(hh, layer, x+j));
+
+			if ( est >= threshold ) {
+				frontier_push_back(next, x+j, est);
+			}
+		}
+	}
+}
+
+heavy_hitter_estimates_t *hh_spread_query(hh_spread_t *restrict hh) {
+	uint8_t layer;
+	uint32_t i;
+	frontier_t *cur       = hh->cur;
+	frontier_t *next      = hh->next;
+	const double phi      = hh->params->phi;
+	const int64_t total   = llround(hh_spread_total(hh));
+	const double th       = phi*total;
+	const double rse      = 1.04/sqrt(hh->R);
+	const heavy_hitter_threshold_t threshold = { .value = phi };
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, total);
+
+	for (layer = 0; layer < hh->logm && cur->count > 0; layer++) {
+		hh_spread_expand(hh, layer, cur, next, th);
+		frontier_swap(&cur, &next);
+	}
+
+	hh->cur  = cur;
+	hh->next = next;
+
+	hh->result.count = 0;
+
+	for (i = 0; i < cur->count; i++) {
+		heavy_hitter_estimates_push(&hh->result, cur->elm[i], cur->est[i],
+				ceil(rse*cur->est[i]));
+	}
+
+	heavy_hitter_estimates_finish(&hh->result, &threshold, 1, total);
+
+	return &hh->result;
+}
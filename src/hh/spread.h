@@ -0,0 +1,77 @@
+#ifndef H_hh_spread
+#define H_hh_spread
+
+// Standard libraries
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/frontier.h"
+#include "util/hash.h"
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint32_t        m;
+	uint32_t        b;
+	uint32_t        registers; // HyperLogLog registers of every counter, a
+	                           // power of two, 0 is 64
+	uint8_t         exact;     // Top layers with registers for every prefix,
+	                           // 0 keeps those of fewer prefixes than a row
+} hh_spread_params_t;
+
+/**
+ * Heavy distinct hitters, the sources that contact the most distinct
+ * destinations. The dyadic tree of hh_sketch keeps a HyperLogLog of the
+ * (source, destination) pairs of every prefix instead of a counter: the top
+ * layers hold the registers of every prefix, the other layers rows of cells
+ * of registers into which the prefixes are hashed. As registers only grow, a
+ * cell overestimates the prefixes hashed into it and the minimum over the
+ * rows is kept, just as for a Count-Min sketch.
+ */
+typedef struct {
+	uint8_t               *restrict top;   // Registers of the exact layers
+	uint8_t               *restrict table; // d rows of w cells of registers
+	                                       // for every sketched layer
+	uint8_t               *restrict total; // Registers of all pairs
+	uint64_t              *restrict seeds; // Hash parameters of every
+	                                       // sketched layer and row
+	hash_t                *restrict hash;
+	uint64_t               a;              // Seeds of the pair hash
+	uint64_t               b;
+	uint32_t               w;
+	uint32_t               d;
+	uint32_t               R;              // Registers of a cell
+	uint8_t                p;              // log2(R)
+	uint8_t                M;
+	uint8_t                top_cnt;
+	uint8_t                logm;
+	hh_spread_params_t    *restrict params;
+	frontier_t            *restrict cur;
+	frontier_t            *restrict next;
+	heavy_hitter_estimates_t result;
+} hh_spread_t;
+
+// Initialization
+hh_spread_t *hh_spread_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_spread_destroy(hh_spread_t *restrict hh);
+
+// Update with a pair, repeated pairs do not count
+void hh_spread_update(hh_spread_t *restrict hh, const uint32_t src,
+		const uint32_t dst);
+
+// Estimated distinct pairs of all sources
+double hh_spread_total(hh_spread_t *restrict hh);
+
+// Estimated distinct destinations of a source
+double hh_spread_point(hh_spread_t *restrict hh, const uint32_t src);
+
+// Sources of at least phi times the distinct pairs, sorted by decreasing
+// estimate, the error of a hitter is the standard error of its estimate
+heavy_hitter_estimates_t *hh_spread_query(hh_spread_t *restrict hh);
+
+#endif
@@ -0,0 +1,428 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "hh/hh.h"
+#include "hh/window.h"
+#include "sketch/count_min.h"
+#include "util/frontier.h"
+#include "util/xutil.h"
+
+// Counters of the exact layers zeroed by one update
+#define WINDOW_CHUNK 4096
+
+// Counter of the prefix x of an exact layer
+static inline uint64_t hh_window_top(const uint8_t layer, const uint32_t x) {
+	return (((uint64_t)2 << layer) - 2) + x;
+}
+
+static inline uint64_t hh_window_top_size(const hh_window_t *restrict hh) {
+	return ((uint64_t)2 << hh->top_cnt) - 2;
+}
+
+// Parts zeroed one per update, the sketched layers and chunks of the exact
+static inline uint32_t hh_window_parts(const hh_window_t *restrict hh) {
+	return (hh->logm - hh->top_cnt) +
+		(hh_window_top_size(hh) + WINDOW_CHUNK - 1) / WINDOW_CHUNK;
+}
+
+// Initialization
+hh_window_t *hh_window_create(heavy_hitter_params_t *restrict p) {
+	uint8_t i, e;
+	uint64_t top_size;
+	hh_window_params_t *restrict params = (hh_window_params_t *)p->params;
+	const uint8_t logm         = floor(log2((uint64_t)params->m+1));
+	const double phi           = params->phi;
+	const uint32_t twophi      = ceil(2./phi);
+	const double delta         = (params->delta*phi)/(2.*logm);
+	const uint8_t slots        = params->epochs + 1;
+	hh_window_t *restrict hh   = xmalloc( sizeof(hh_window_t) );
+	count_min_t *restrict s    = count_min_create(p->hash, params->b,
+			params->epsilon, delta);
+	uint8_t top_cnt;
+
+	assert(params->epochs > 0 && params->epochs < UINT8_MAX);
+
+	// A layer of fewer prefixes than a row gains nothing from hashing
+	if ( params->exact > 0 ) {
+		top_cnt = params->exact;
+	} else {
+		for (top_cnt = 0; top_cnt < logm &&
+				((uint64_t)2 << top_cnt) <= s->size.w; top_cnt++) {
+		}
+	}
+	top_cnt = (top_cnt > logm) ? logm : top_cnt;
+
+	hh->slots          = slots;
+	hh->cur            = 0;
+	hh->count          = 1;
+	hh->top_cnt        = top_cnt;
+	hh->logm           = logm;
+	hh->dirty          = 0;
+	hh->updates        = 0;
+	hh->start          = NAN;
+	hh->params         = params;
+	hh->tree           = xmalloc( sizeof(count_min_t **) * slots );
+	hh->top            = xmalloc( sizeof(int64_t *) * slots );
+	hh->norm           = xmalloc( sizeof(uint64_t) * slots );
+	hh->live           = xmalloc( sizeof(count_min_t *) * slots );
+	hh->cur_frontier   = frontier_create(2*twophi);
+	hh->next_frontier  = frontier_create(2*twophi);
+	hh->result.count   = 0;
+	hh->result.size    = twophi;
+	hh->result.hitters = xmalloc( sizeof(uint32_t) * twophi );
+	heavy_hitter_estimates_init(&hh->estimates, twophi);
+
+	top_size = sizeof(int64_t) * hh_window_top_size(hh);
+
+	for (e = 0; e < slots; e++) {
+		hh->norm[e] = 0;
+		hh->top[e]  = xmalloc( top_size + sizeof(int64_t) );
+		memset(hh->top[e], '\0', top_size);
+		hh->tree[e] = (top_cnt < logm) ?
+			xmalloc( sizeof(count_min_t *) * (logm-top_cnt) ) : NULL;
+	}
+
+	// The other slots copy the seeds of the first
+	for (i = 0; i < logm-top_cnt; i++) {
+		hh->tree[0][i] = (i == logm-top_cnt-1) ? s :
+			count_min_create(p->hash, params->b, params->epsilon, delta);
+
+		for (e = 1; e < slots; e++) {
+			hh->tree[e][i] = count_min_copy_seeds(hh->tree[0][i]);
+		}
+	}
+
+	if ( top_cnt == logm ) {
+		count_min_destroy(s);
+	}
+
+	#ifdef SPACE
+	uint64_t space = slots*top_size + sizeof(uint32_t) * twophi +
+		sizeof(hh_window_t);
+	fprintf(stderr, "Space usage excluding sketches: %"PRIu64" bytes\n\n",
+			space);
+	#endif
+
+	return hh;
+}
+
+// Destruction
+void hh_window_destroy(hh_window_t *restrict hh) {
+	uint8_t i, e;
+
+	if (hh == NULL) {
+		return;
+	}
+
+	for (e = 0; e < hh->slots; e++) {
+		for (i = 0; i < hh->logm-hh->top_cnt; i++) {
+			count_min_destroy(hh->tree[e][i]);
+		}
+
+		free(hh->tree[e]);
+		free(hh->top[e]);
+	}
+
+	free(hh->tree);
+	free(hh->top);
+	free(hh->norm);
+	free(hh->live);
+	free(hh->result.hitters);
+	heavy_hitter_estimates_free(&hh->estimates);
+	frontier_destroy(hh->cur_frontier);
+	frontier_destroy(hh->next_frontier);
+
+	free(hh);
+	hh = NULL;
+}
+
+// Zeroes the next part of the spare slot
+static void hh_window_zero(hh_window_t *restrict hh) {
+	uint64_t from, len;
+	const uint8_t spare    = (hh->cur + 1) % hh->slots;
+	const uint8_t sketched = hh->logm - hh->top_cnt;
+	const uint32_t part    = hh_window_parts(hh) - hh->dirty;
+
+	if ( part < sketched ) {
+		count_min_clear(hh->tree[spare][part]);
+	} else {
+		from = (uint64_t)(part - sketched) * WINDOW_CHUNK;
+		len  = hh_window_top_size(hh) - from;
+		len  = (len < WINDOW_CHUNK) ? len : WINDOW_CHUNK;
+
+		memset(hh->top[spare] + from, '\0', sizeof(int64_t) * len);
+	}
+
+	hh->dirty--;
+}
+
+void hh_window_epoch(hh_window_t *restrict hh) {
+	// Only if the epoch had fewer updates than the spare has parts
+	while ( unlikely(hh->dirty > 0) ) {
+		hh_window_zero(hh);
+	}
+
+	hh->cur     = (hh->cur + 1) % hh->slots;
+	hh->updates = 0;
+
+	if ( hh->count == hh->params->epochs ) {
+		hh->dirty = hh_window_parts(hh);
+		hh->norm[(hh->cur + 1) % hh->slots] = 0;
+	} else {
+		hh->count++;
+	}
+}
+
+void hh_window_time(hh_window_t *restrict hh, const double t) {
+	uint64_t i, n;
+	const double span = hh->params->span;
+
+	if ( unlikely(isnan(hh->start)) ) {
+		hh->start = t;
+		return;
+	}
+
+	if ( span <= 0 || t < hh->start + span ) {
+		return;
+	}
+
+	// Beyond the slots every epoch is empty already
+	n          = floor((t - hh->start) / span);
+	hh->start += n*span;
+
+	for (i = 0; i < n && i < hh->slots; i++) {
+		hh_window_epoch(hh);
+	}
+}
+
+// Update
+void hh_window_update(hh_window_t *restrict hh, const uint32_t idx,
+		const int64_t c) {
+	int8_t i;
+	uint32_t x                  = idx;
+	count_min_t **restrict tree = hh->tree[hh->cur];
+	int64_t *restrict top       = hh->top[hh->cur];
+	const uint8_t top_cnt       = hh->top_cnt;
+
+	if ( unlikely(hh->dirty > 0) ) {
+		hh_window_zero(hh);
+	}
+
+	for (i = hh->logm-top_cnt-1; i > -1; i--) {
+		count_min_update(tree[i], x, c);
+		x >>= 1;
+	}
+
+	for (i = top_cnt-1; i > -1; i--) {
+		top[hh_window_top(i, x)] += c;
+		x >>= 1;
+	}
+
+	hh->norm[hh->cur] += c;
+	hh->updates++;
+
+	if ( hh->params->updates > 0 && hh->updates == hh->params->updates ) {
+		hh_window_epoch(hh);
+	}
+}
+
+// Slot of the i'th newest epoch of the window
+static inline uint8_t hh_window_slot(const hh_window_t *restrict hh,
+		const uint8_t i) {
+	return (hh->cur + hh->slots - i) % hh->slots;
+}
+
+// Gathers the sketches of a sketched layer of the window into hh->live
+static inline void hh_window_gather(hh_window_t *restrict hh,
+		const uint8_t layer) {
+	uint8_t i;
+
+	for (i = 0; i < hh->count; i++) {
+		hh->live[i] = hh->tree[hh_window_slot(hh, i)][layer-hh->top_cnt];
+	}
+}
+
+// Estimate of the prefix x of a layer in the window, the sketched layers
+// read the sketches gathered last
+static inline int64_t hh_window_estimate(hh_window_t *restrict hh,
+		const uint8_t layer, const uint32_t x) {
+	uint8_t i;
+	int64_t est = 0;
+
+	if ( layer >= hh->top_cnt ) {
+		return count_min_point_sum(hh->live, hh->count, x);
+	}
+
+	for (i = 0; i < hh->count; i++) {
+		est += hh->top[hh_window_slot(hh, i)][hh_window_top(layer, x)];
+	}
+
+	return est;
+}
+
+int64_t hh_window_point(hh_window_t *restrict hh, const uint32_t idx) {
+	if ( hh->top_cnt < hh->logm ) {
+		hh_window_gather(hh, hh->logm-1);
+	}
+
+	return hh_window_estimate(hh, hh->logm-1, idx);
+}
+
+uint64_t hh_window_norm(hh_window_t *restrict hh) {
+	uint8_t i;
+	uint64_t norm = 0;
+
+	for (i = 0; i < hh->count; i++) {
+		norm += hh->norm[hh_window_slot(hh, i)];
+	}
+
+	return norm;
+}
+
+// Expands the prefixes of cur into their children at the given layer. Empty
+// prefixes are never kept, as every prefix reaches the threshold of an empty
+// window.
+static void hh_window_expand(hh_window_t *restrict hh, const uint8_t layer,
+		frontier_t *restrict cur, frontier_t *restrict next,
+		const double threshold) {
+	uint32_t i, j, x;
+	int64_t est;
+
+	frontier_clear(next);
+
+	if ( layer >= hh->top_cnt ) {
+		hh_window_gather(hh, layer);
+	}
+
+	for (i = 0; i < cur->count; i++) {
+		x = 2*cur->elm[i];
+
+		for (j = 0; j < 2; j++) { // branch=2
+			est = hh_window_estimate(hh, layer, x+j);
+
+			if ( est >= threshold && est > 0 ) {
+				frontier_push_back(next, x+j, est);
+			}
+		}
+	}
+}
+
+// The surviving leaves and their estimates are left in hh->cur_frontier
+static void hh_window_walk(hh_window_t *restrict hh, const double threshold,
+		const uint64_t norm) {
+	uint8_t layer;
+	frontier_t *cur  = hh->cur_frontier;
+	frontier_t *next = hh->next_frontier;
+
+	frontier_clear(cur);
+	frontier_push_back(cur, 0, norm);
+
+	for (layer = 0; layer < hh->logm && cur->count > 0; layer++) {
+		hh_window_expand(hh, layer, cur, next, threshold);
+		frontier_swap(&cur, &next);
+	}
+
+	hh->cur_frontier  = cur;
+	hh->next_frontier = next;
+}
+
+heavy_hitter_t *hh_window_query(hh_window_t *restrict hh) {
+	uint32_t i;
+	frontier_t *leaves;
+	const uint64_t norm = hh_window_norm(hh);
+
+	hh_window_walk(hh, hh->params->phi*norm, norm);
+	leaves = hh->cur_frontier;
+
+	if ( unlikely(leaves->count > hh->result.size) ) {
+		hh->result.size    = leaves->count;
+		hh->result.hitters = xrealloc(hh->result.hitters,
+				hh->result.size*sizeof(uint32_t));
+	}
+
+	for (i = 0; i < leaves->count; i++) {
+		hh->result.hitters[i] = leaves->elm[i];
+	}
+	hh->result.count = leaves->count;
+
+	return &hh->result;
+}
+
+// Walks the tree once at the lowest threshold, the error of a sketched leaf
+// is that of a sketch of the window, all slots sharing the sketch sizes
+heavy_hitter_estimates_t *hh_window_query_thresholds(hh_window_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n) {
+	uint32_t i;
+	frontier_t *leaves;
+	const uint64_t norm  = hh_window_norm(hh);
+	const int64_t error  = ( hh->top_cnt < hh->logm ) ?
+		count_min_error(hh->tree[hh->cur][hh->logm-hh->top_cnt-1], norm) : 0;
+
+	hh->estimates.count = 0;
+
+	hh_window_walk(hh, heavy_hitter_min_threshold(thresholds, n, norm), norm);
+	leaves = hh->cur_frontier;
+
+	for (i = 0; i < leaves->count; i++) {
+		heavy_hitter_estimates_push(&hh->estimates, leaves->elm[i],
+				leaves->est[i], error);
+	}
+
+	heavy_hitter_estimates_finish(&hh->estimates, thresholds, n, norm);
+
+	return &hh->estimates;
+}
+
+// Snapshots, the sketch of layer i of slot e is the section e*layers+i
+void hh_window_save(hh_window_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i, e;
+	const uint8_t layers    = hh->logm-hh->top_cnt;
+	const uint64_t top_size = sizeof(int64_t) * hh_window_top_size(hh);
+
+	snapshot_add(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_add(snap, "cur", 0, &hh->cur, sizeof(uint8_t));
+	snapshot_add(snap, "count", 0, &hh->count, sizeof(uint8_t));
+	snapshot_add(snap, "dirty", 0, &hh->dirty, sizeof(uint32_t));
+	snapshot_add(snap, "updates", 0, &hh->updates, sizeof(uint64_t));
+	snapshot_add(snap, "start", 0, &hh->start, sizeof(double));
+	snapshot_add(snap, "norm", 0, hh->norm, sizeof(uint64_t) * hh->slots);
+
+	for (e = 0; e < hh->slots; e++) {
+		snapshot_add(snap, "top", e, hh->top[e], top_size);
+
+		for (i = 0; i < layers; i++) {
+			count_min_save(hh->tree[e][i], snap, e*layers+i);
+		}
+	}
+}
+
+void hh_window_load(hh_window_t *restrict hh, snapshot_t *restrict snap) {
+	uint8_t i, e;
+	const uint8_t layers    = hh->logm-hh->top_cnt;
+	const uint64_t top_size = sizeof(int64_t) * hh_window_top_size(hh);
+
+	snapshot_check(snap, "top_cnt", 0, &hh->top_cnt, sizeof(uint8_t));
+	snapshot_read(snap, "cur", 0, &hh->cur, sizeof(uint8_t));
+	snapshot_read(snap, "count", 0, &hh->count, sizeof(uint8_t));
+	snapshot_read(snap, "dirty", 0, &hh->dirty, sizeof(uint32_t));
+	snapshot_read(snap, "updates", 0, &hh->updates, sizeof(uint64_t));
+	snapshot_read(snap, "start", 0, &hh->start, sizeof(double));
+	snapshot_read(snap, "norm", 0, hh->norm, sizeof(uint64_t) * hh->slots);
+
+	if ( hh->cur >= hh->slots || hh->count == 0 || hh->count >= hh->slots ) {
+		xerror("Snapshot section does not fit the engine.", __LINE__, 
+				__FILE__);
+	}
+
+	for (e = 0; e < hh->slots; e++) {
+		snapshot_read(snap, "top", e, hh->top[e], top_size);
+
+		for (i = 0; i < layers; i++) {
+			count_min_load(hh->tree[e][i], snap, e*layers+i);
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#ifndef H_hh_window
+#define H_hh_window
+
+// Standard libraries
+#include <stdint.h>
+
+// User defined libraries
+#include "hh/hh.h"
+#include "util/frontier.h"
+#include "util/hash.h"
+#include "sketch/count_min.h"
+
+// Structures
+typedef struct {
+	double          phi;
+	double          epsilon;
+	double          delta;
+	uint32_t        m;
+	uint32_t        b;
+	uint8_t         epochs;  // Epochs of the window, at least one
+	uint64_t        updates; // Updates of an epoch, 0 ends epochs by time only
+	double          span;    // Time of an epoch, 0 ends epochs by updates only
+	uint8_t         exact;   // Exactly counted top layers, 0 keeps those of
+	                         // fewer prefixes than a row
+} hh_window_params_t;
+
+/**
+ * Heavy hitters of a sliding window of the last epochs, the current one
+ * included. Every epoch keeps the dyadic tree of hh_sketch in a ring of
+ * slots, the layers of all slots sharing the seeds of their Count-Min
+ * sketches, such that the walk reads the window as the sum of the cells of
+ * the live slots without merging them. The ring holds a spare slot beyond
+ * the window: the epoch leaving the window is zeroed a layer at a time by
+ * the updates of the next epoch rather than all at once when it ends.
+ */
+typedef struct {
+	count_min_t         ***restrict tree;  // Sketched layers of every slot
+	int64_t              **restrict top;   // Exact layers of every slot
+	uint64_t              *restrict norm;  // Of every slot
+	count_min_t          **restrict live;  // Sketches of a layer in the window
+	uint8_t                slots;          // Epochs of the window and spare
+	uint8_t                cur;            // Slot of the current epoch
+	uint8_t                count;          // Epochs in the window
+	uint8_t                top_cnt;
+	uint8_t                logm;
+	uint32_t               dirty;          // Parts of the spare slot to zero
+	uint64_t               updates;        // Of the current epoch
+	double                 start;          // Time the current epoch started
+	hh_window_params_t    *restrict params;
+	frontier_t            *restrict cur_frontier;
+	frontier_t            *restrict next_frontier;
+	heavy_hitter_t         result;
+	heavy_hitter_estimates_t estimates;
+} hh_window_t;
+
+// Initialization
+hh_window_t *hh_window_create(heavy_hitter_params_t *restrict p);
+
+// Destruction
+void hh_window_destroy(hh_window_t *restrict hh);
+
+// Update of the current epoch, which ends after params->updates updates
+void hh_window_update(hh_window_t *restrict hh, const uint32_t idx,
+		const int64_t c);
+
+// Ends the epochs whose span has passed by the time t, the first call sets
+// the start of the current epoch
+void hh_window_time(hh_window_t *restrict hh, const double t);
+
+// Ends the current epoch, the oldest leaves the window once it is full
+void hh_window_epoch(hh_window_t *restrict hh);
+
+// Estimated count of an item in the window
+int64_t hh_window_point(hh_window_t *restrict hh, const uint32_t idx);
+
+// Count of the window
+uint64_t hh_window_norm(hh_window_t *restrict hh);
+
+// Query of the window
+heavy_hitter_t *hh_window_query(hh_window_t *restrict hh);
+heavy_hitter_estimates_t *hh_window_query_thresholds(hh_window_t *restrict hh,
+		const heavy_hitter_threshold_t *restrict thresholds, const uint32_t n);
+
+// Snapshots
+void hh_window_save(hh_window_t *restrict hh, snapshot_t *restrict snap);
+void hh_window_load(hh_window_t *restrict hh, snapshot_t *restrict snap);
+
+#endif
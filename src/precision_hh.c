@@ -16,9 +16,12 @@
 #include "hh/const_sketch.h"
 #include "hh/ktree.h"
 #include "hh/cormode_cmh.h"
+#include "hh/cgt.h"
+#include "hh/lattice.h"
+#include "hh/spread.h"
 #include "util/xutil.h"
 
-#define AMOUNT_OF_IMPLEMENTATIONS 6
+#define AMOUNT_OF_IMPLEMENTATIONS 7
 
 typedef struct {
 	double   timestamp;
@@ -61,6 +64,7 @@ typedef enum {
 	CORMODE,
 	KMIN,
 	KMEDIAN,
+	CGT,
 } hh_impl_t;
 
 typedef struct {
@@ -83,8 +87,12 @@ static void printusage(char *argv[]) {
             "\t[--cormode                {OPTIONAL} (Run HH with Cormode et al.'s Count Min Sketch)]\n"
             "\t[--kmin                   {OPTIONAL} (Run HH with k-tree using Count Min Sketch)]\n"
             "\t[--kmedian                {OPTIONAL} (Run HH with k-tree using Count Median Sketch)]\n"
+            "\t[--cgt                    {OPTIONAL} (Run HH with combinatorial group testing)]\n"
             "\t[-1 --seed1    [uint32_t] {OPTIONAL} (First seed value)]\n"
             "\t[-2 --seed2    [uint32_t] {OPTIONAL} (Second seed value)]\n"
+            "\t[-H --hhh                 {OPTIONAL} (Also list the hierarchical heavy hitters)]\n"
+            "\t[-L --lattice [s,d]       {OPTIONAL} (Also list the heavy pairs of s source and d destination prefix bits)]\n"
+            "\t[-S --spread              {OPTIONAL} (Also list the sources of the most distinct destinations)]\n"
             "\t[-i --info                {OPTIONAL} (Shows this guideline)]\n"
             , argv[0]);
 }
@@ -103,6 +111,14 @@ int main (int argc, char **argv) {
 	char     *filename = NULL;
 	uint64_t  buf_size = 0;
 	bool start         = true;
+	bool hhh           = false;
+	bool lattice       = false;
+	uint8_t src_bits   = 0;
+	uint8_t dst_bits   = 0;
+	uint32_t dst_uid;
+	hh_lattice_t *pairs = NULL;
+	bool spread        = false;
+	hh_spread_t *spreaders = NULL;
 
 	alg_t     alg[AMOUNT_OF_IMPLEMENTATIONS];
 	hh_t     *impl[AMOUNT_OF_IMPLEMENTATIONS];
@@ -118,7 +134,7 @@ int main (int argc, char **argv) {
 	/* getopt */
 	int option_index = 0;
 	static int flag  = 0;
-	static const char *optstring = "1:2:e:d:p:m:f:h:w:i";
+	static const char *optstring = "1:2:e:d:p:m:f:h:w:HL:Si";
 	static const struct option long_options[] = {
 		{"min",            no_argument, &flag,     MIN },
 		{"median",         no_argument, &flag,  MEDIAN },
@@ -126,11 +142,15 @@ int main (int argc, char **argv) {
 		{"cormode",        no_argument, &flag, CORMODE },
 		{"kmin",           no_argument, &flag,    KMIN },
 		{"kmedian",        no_argument, &flag, KMEDIAN },
+		{"cgt",            no_argument, &flag,     CGT },
 		{"epsilon",  required_argument,     0,      'e'},
 		{"delta",    required_argument,     0,      'd'},
 		{"phi",      required_argument,     0,      'p'},
 		{"universe", required_argument,     0,      'm'},
 		{"file",     required_argument,     0,      'f'},
+		{"hhh",            no_argument,     0,      'H'},
+		{"lattice",  required_argument,     0,      'L'},
+		{"spread",         no_argument,     0,      'S'},
 		{"info",           no_argument,     0,      'i'},
         {"seed1",    required_argument,     0,      '1'},
         {"seed2",    required_argument,     0,      '2'},
@@ -201,6 +221,19 @@ int main (int argc, char **argv) {
 			case 'h':
 				depth = strtoll(optarg, NULL, 10);
 				break;
+			case 'H':
+				hhh = true;
+				break;
+			case 'L':
+				if ( sscanf(optarg, "%"SCNu8",%"SCNu8, &src_bits, &dst_bits) < 2 ) {
+					printusage(argv);
+					exit(EXIT_FAILURE);
+				}
+				lattice = true;
+				break;
+			case 'S':
+				spread = true;
+				break;
 			case 'i':
 			default:
 				printusage(argv);
@@ -300,6 +333,18 @@ int main (int argc, char **argv) {
 		.params = &params_cmh,
 		.f      = &hh_cormode_cmh,
 	};
+	hh_cgt_params_t params_cgt = {
+		.b       = b,
+		.epsilon = epsilon,
+		.delta   = delta,
+		.m       = m,
+		.phi     = phi,
+	};
+	heavy_hitter_params_t p_cgt = {
+		.hash   = &multiplyShift,
+		.params = &params_cgt,
+		.f      = &hh_cgt,
+	};
 	heavy_hitter_params_t p_kmin = {
 		.hash   = &multiplyShift,
 		.params = &params_kmin,
@@ -311,6 +356,37 @@ int main (int argc, char **argv) {
 		.f      = &hh_ktree,
 	};
 
+	hh_lattice_params_t params_lattice = {
+		.b       = b,
+		.epsilon = epsilon,
+		.delta   = delta,
+		.gran    = gran,
+	};
+	heavy_hitter_params_t p_lattice = {
+		.hash   = &multiplyShift,
+		.params = &params_lattice,
+	};
+
+	hh_spread_params_t params_spread = {
+		.b       = b,
+		.epsilon = epsilon,
+		.delta   = delta,
+		.m       = m,
+		.phi     = phi,
+	};
+	heavy_hitter_params_t p_spread = {
+		.hash   = &multiplyShift,
+		.params = &params_spread,
+	};
+
+	if ( lattice ) {
+		pairs = hh_lattice_create(&p_lattice);
+	}
+
+	if ( spread ) {
+		spreaders = hh_spread_create(&p_spread);
+	}
+
 	for (k = 0; k < impl_cnt; k++) {
 		switch (alg[k].impl) {
 			case MIN:
@@ -351,6 +427,12 @@ int main (int argc, char **argv) {
 				}
 				impl[k] = heavy_hitter_create(&p_kmedian);
 				break;
+			case CGT:
+				if (depth > 0) {
+					depth = ceil(log((double)(1./(delta*phi)))/log(b));
+				}
+				impl[k] = heavy_hitter_create(&p_cgt);
+				break;
 			default:
 				stream_close(stream);
 				free(filename);
@@ -545,6 +627,30 @@ int main (int argc, char **argv) {
 							heavy_hitter_update(impl[k], uid, 1);
 						}
 
+						if ( pairs != NULL || spreaders != NULL ) {
+							d = sscanf(
+									nust.destinationIP,
+									"%"SCNu8".%"SCNu8".%"SCNu8".%"SCNu8,
+									&h1,
+									&h2,
+									&h3,
+									&h4
+							);
+
+							if ( unlikely(d < 4) ) {
+								xerror("Unable to read destination IP", __LINE__, 
+										__FILE__);
+							}
+
+							dst_uid = (uint32_t)(h1 << 24) | (h2 << 16) | (h3 << 8) | h4;
+							if ( pairs != NULL ) {
+								hh_lattice_update(pairs, uid, dst_uid, 1);
+							}
+							if ( spreaders != NULL ) {
+								hh_spread_update(spreaders, uid, dst_uid);
+							}
+						}
+
 						break;
 					case DARPA:
 						c = sscanf(
@@ -599,6 +705,30 @@ int main (int argc, char **argv) {
 							heavy_hitter_update(impl[k], uid, 1);
 						}
 
+						if ( pairs != NULL || spreaders != NULL ) {
+							d = sscanf(
+									darpa.destinationIP,
+									"%"SCNu8".%"SCNu8".%"SCNu8".%"SCNu8,
+									&h1,
+									&h2,
+									&h3,
+									&h4
+							);
+
+							if ( unlikely(d < 4) ) {
+								xerror("Unable to read destination IP", __LINE__, 
+										__FILE__);
+							}
+
+							dst_uid = (uint32_t)(h1 << 24) | (h2 << 16) | (h3 << 8) | h4;
+							if ( pairs != NULL ) {
+								hh_lattice_update(pairs, uid, dst_uid, 1);
+							}
+							if ( spreaders != NULL ) {
+								hh_spread_update(spreaders, uid, dst_uid);
+							}
+						}
+
 						break;
 					default:
 						xerror("Invalid format received", __LINE__, __FILE__);
@@ -625,6 +755,11 @@ int main (int argc, char **argv) {
 	}
 
 	heavy_hitter_t *hitters;
+	heavy_hitter_hhh_t *prefixes;
+	heavy_hitter_pairs_t *heavy_pairs;
+	heavy_hitter_estimates_t *spreading;
+	uint32_t dst_ip;
+	uint32_t ip;
 	uint32_t recalled = 0;
 	uint32_t errs = 0;
 
@@ -696,6 +831,9 @@ int main (int argc, char **argv) {
 				case CONST:
 					depth = ceil(log((double)(16./(pow(delta,2)*phi)))/log(b));
 					break;
+				case CGT:
+					depth = ceil(log((double)(1./(delta*phi)))/log(b));
+					break;
 				default:
 					depth = ceil(log((double)((2.*log2(m))/(delta*phi)))/log(b));
 			}
@@ -704,10 +842,66 @@ int main (int argc, char **argv) {
 
 		printf("\n");
 
+		// Heavy source prefixes at every level, from the same counters
+		if ( hhh && impl[k]->funcs->hhh != NULL ) {
+			prefixes = heavy_hitter_query_hhh(impl[k], phi);
+
+			for (i = 0; i < prefixes->count; i++) {
+				ip = ( prefixes->hitters[i].bits > 0 ) ? 
+					prefixes->hitters[i].prefix << 
+					(prefixes->bits - prefixes->hitters[i].bits) : 0;
+
+				printf("HHH,%s,%"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/%"PRIu8
+						",%"PRId64",%"PRId64"\n", long_options[alg[k].index].name, 
+						(uint8_t)(ip >> 24), (uint8_t)(ip >> 16), 
+						(uint8_t)(ip >> 8), (uint8_t)ip, 
+						prefixes->hitters[i].bits, prefixes->hitters[i].count, 
+						prefixes->hitters[i].discounted);
+			}
+		}
+
 		recalled = 0;
 
 		heavy_hitter_destroy(impl[k]);
 	}
+	// Heavy pairs of source and destination prefixes
+	if ( pairs != NULL ) {
+		heavy_pairs = hh_lattice_query(pairs, src_bits, dst_bits, phi);
+
+		for (i = 0; i < heavy_pairs->count; i++) {
+			ip     = ( src_bits > 0 ) ? 
+				heavy_pairs->hitters[i].src << (32 - src_bits) : 0;
+			dst_ip = ( dst_bits > 0 ) ? 
+				heavy_pairs->hitters[i].dst << (32 - dst_bits) : 0;
+
+			printf("PAIR,%"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/%"PRIu8
+					",%"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8"/%"PRIu8",%"PRId64"\n",
+					(uint8_t)(ip >> 24), (uint8_t)(ip >> 16), 
+					(uint8_t)(ip >> 8), (uint8_t)ip, src_bits, 
+					(uint8_t)(dst_ip >> 24), (uint8_t)(dst_ip >> 16), 
+					(uint8_t)(dst_ip >> 8), (uint8_t)dst_ip, dst_bits, 
+					heavy_pairs->hitters[i].count);
+		}
+
+		hh_lattice_destroy(pairs);
+	}
+
+	// Sources of the most distinct destinations
+	if ( spreaders != NULL ) {
+		spreading = hh_spread_query(spreaders);
+
+		for (i = 0; i < spreading->count; i++) {
+			ip = spreading->hitters[i].id;
+
+			printf("SPREAD,%"PRIu8".%"PRIu8".%"PRIu8".%"PRIu8",%"PRId64
+					",%"PRId64"\n", (uint8_t)(ip >> 24), (uint8_t)(ip >> 16), 
+					(uint8_t)(ip >> 8), (uint8_t)ip, spreading->hitters[i].count,
+					spreading->hitters[i].error);
+		}
+
+		hh_spread_destroy(spreaders);
+	}
+
 	stream_close(stream);
 	free(filename);
 	free(exact);
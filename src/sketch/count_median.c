@@ -27,6 +27,12 @@ count_median_t *count_median_create(hash_t *restrict hash, const uint8_t b,
 //	uint32_t d                 = ceil( log(1./delta) );
 
 	sketch_fixed_size(&d, &w);
+
+	// Hashes into 2^M bins get a power of two
+	if ( hash->pow2 ) {
+		w = next_pow_2(w);
+	}
+
 	hash_init(&s->size.M, w);
 
 	const uint32_t M           = s->size.M;
@@ -40,6 +46,8 @@ count_median_t *count_median_create(hash_t *restrict hash, const uint8_t b,
 	s->hash    = hash;
 	s->size.w  = w;
 	s->size.d  = d;
+	s->size.g  = 0;
+	s->size.b  = b;
 
 	memset(s->table,  '\0', table_size);
 	memset(s->median, '\0', median_size);
@@ -78,17 +86,59 @@ void count_median_destroy(count_median_t *restrict s) {
 	s = NULL;
 }
 
+count_median_t *count_median_copy_seeds(const count_median_t *restrict s) {
+	count_median_t *restrict c = xmalloc(sizeof(count_median_t));
+	const uint32_t w           = s->size.w;
+	const uint32_t d           = s->size.d;
+	const uint32_t table_size  = sizeof(int64_t) * ((w+4)*d);
+	const uint32_t median_size = sizeof(int64_t) * d;
+
+	c->table   = xmalloc(table_size);
+	c->median  = xmalloc(median_size);
+	c->hash    = s->hash;
+	c->size    = s->size;
+
+	memcpy(c->table, s->table, table_size);
+	memset(c->median, '\0', median_size);
+	count_median_clear(c);
+
+	return c;
+}
+
+void count_median_clear(count_median_t *restrict s) {
+	uint32_t di;
+	const uint32_t w = s->size.w;
+
+	for (di = 0; di < s->size.d; di++) {
+		memset(&s->table[COUNT_MEDIAN_INDEX(w, di, 0)], '\0', 
+				sizeof(int64_t) * w);
+	}
+}
+
+void count_median_save(count_median_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index) {
+	snapshot_add(snap, "count_median", index, s->table, 
+			sizeof(int64_t) * (s->size.w+4) * s->size.d);
+}
+
+void count_median_load(count_median_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index) {
+	snapshot_read(snap, "count_median", index, s->table, 
+			sizeof(int64_t) * (s->size.w+4) * s->size.d);
+}
+
 void count_median_update(count_median_t *restrict s, const uint32_t i, 
 		const int64_t c) {
 	uint32_t wi, di;
 	const uint32_t w        = s->size.w;
 	const uint8_t  M        = s->size.M;
+	const uint8_t  g        = s->size.g;
 	const uint32_t d        = s->size.d;
 	int64_t *restrict table = s->table;
 	hash hash               = s->hash->hash;
 
 	for (di = 0; di < d; di++) {
-		wi = hash(w, M, i, (uint64_t)table[di*(w+4)], 
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+4)], 
 				(uint64_t)table[di*(w+4)+1]);
 
 		assert( wi < w );
@@ -99,17 +149,46 @@ void count_median_update(count_median_t *restrict s, const uint32_t i,
 	}
 }
 
+int64_t count_median_update_point(count_median_t *restrict s, 
+		const uint32_t i, const int64_t c) {
+	uint32_t wi, di, idx;
+	int64_t sign;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	const uint32_t d         = s->size.d;
+	int64_t *restrict table  = s->table;
+	int64_t *restrict median = s->median;
+	hash hash                = s->hash->hash;
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+4)], 
+				(uint64_t)table[di*(w+4)+1]);
+
+		assert( wi < w );
+
+		idx         = COUNT_MEDIAN_INDEX(w, di, wi);
+		sign        = sign_ms(i, (uint64_t)table[di*(w+4)+2], 
+				(uint64_t)table[di*(w+4)+3]);
+		table[idx] += c * sign;
+		median[di]  = table[idx] * sign;
+	}
+
+	return median_wirth(median, d);
+}
+
 int64_t count_median_point(count_median_t *restrict s, const uint32_t i) {
 	uint32_t di, wi;
 	const uint32_t d         = s->size.d;
 	const uint32_t w         = s->size.w;
 	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
 	int64_t *restrict table  = s->table;
 	int64_t *restrict median = s->median;
 	hash hash                = s->hash->hash;
 
 	for (di = 0; di < d; di++) {
-		wi = hash(w, M, i, (uint64_t)table[di*(w+4)], 
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+4)], 
 		          	(uint64_t)table[di*(w+4)+1]);
 
 		assert( wi < w );
@@ -123,17 +202,145 @@ int64_t count_median_point(count_median_t *restrict s, const uint32_t i) {
 	return median_wirth(median, d);
 }
 
+void count_median_points(count_median_t *restrict s, 
+		const uint32_t *restrict i, int64_t *restrict est, const uint32_t n) {
+	uint32_t j, t, di, cnt;
+	const uint32_t d         = s->size.d;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	int64_t *restrict table  = s->table;
+	hash hash                = s->hash->hash;
+	uint32_t idx[SKETCH_BATCH*d];
+	int64_t  median[d];
+
+	for (j = 0; j < n; j += SKETCH_BATCH) {
+		cnt = (n-j < SKETCH_BATCH) ? n-j : SKETCH_BATCH;
+
+		// Hash every point of the batch in every row and prefetch the cells
+		for (di = 0; di < d; di++) {
+			for (t = 0; t < cnt; t++) {
+				idx[di*SKETCH_BATCH+t] = COUNT_MEDIAN_INDEX(w, di, 
+						sketch_bucket(hash, w, M, g, i[j+t], (uint64_t)table[di*(w+4)], 
+							(uint64_t)table[di*(w+4)+1]));
+
+				__builtin_prefetch(&table[idx[di*SKETCH_BATCH+t]], 0, 1);
+			}
+		}
+
+		// The median is computed in a local buffer, such that batches can be
+		// evaluated concurrently on the same sketch
+		for (t = 0; t < cnt; t++) {
+			for (di = 0; di < d; di++) {
+				median[di] = table[idx[di*SKETCH_BATCH+t]] * sign_ms(i[j+t], 
+						(uint64_t)table[di*(w+4)+2], 
+						(uint64_t)table[di*(w+4)+3]);
+			}
+
+			est[j+t] = median_wirth(median, d);
+		}
+	}
+}
+
+// The 64-bit keys are hashed and signed by the pair-multiply-shift with the 
+// seeds of the rows
+void count_median_update64(count_median_t *restrict s, const uint64_t i, 
+		const int64_t c) {
+	uint32_t wi, di;
+	const uint32_t w        = s->size.w;
+	const uint8_t  M        = s->size.M;
+	const uint8_t  g        = s->size.g;
+	const uint32_t d        = s->size.d;
+	int64_t *restrict table = s->table;
+	hash64 hash             = s->hash->hash64;
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket64(hash, w, M, g, i, (uint64_t)table[di*(w+4)], 
+				(uint64_t)table[di*(w+4)+1]);
+
+		assert( wi < w );
+
+		table[COUNT_MEDIAN_INDEX(w, di, wi)] += c * sign_pms(i, 
+				(uint64_t)table[di*(w+4)+2], 
+				(uint64_t)table[di*(w+4)+3]);
+	}
+}
+
+int64_t count_median_point64(count_median_t *restrict s, const uint64_t i) {
+	uint32_t di, wi;
+	const uint32_t d         = s->size.d;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	int64_t *restrict table  = s->table;
+	int64_t *restrict median = s->median;
+	hash64 hash              = s->hash->hash64;
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket64(hash, w, M, g, i, (uint64_t)table[di*(w+4)], 
+				(uint64_t)table[di*(w+4)+1]);
+
+		assert( wi < w );
+
+		median[di] = table[COUNT_MEDIAN_INDEX(w, di, wi)] * sign_pms(i, 
+				(uint64_t)table[di*(w+4)+2], 
+				(uint64_t)table[di*(w+4)+3]);
+	}
+
+	return median_wirth(median, d);
+}
+
+void count_median_points64(count_median_t *restrict s, 
+		const uint64_t *restrict i, int64_t *restrict est, const uint32_t n) {
+	uint32_t j, t, di, cnt;
+	const uint32_t d         = s->size.d;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	int64_t *restrict table  = s->table;
+	hash64 hash              = s->hash->hash64;
+	uint32_t idx[SKETCH_BATCH*d];
+	int64_t  median[d];
+
+	for (j = 0; j < n; j += SKETCH_BATCH) {
+		cnt = (n-j < SKETCH_BATCH) ? n-j : SKETCH_BATCH;
+
+		// Hash every point of the batch in every row and prefetch the cells
+		for (di = 0; di < d; di++) {
+			for (t = 0; t < cnt; t++) {
+				idx[di*SKETCH_BATCH+t] = COUNT_MEDIAN_INDEX(w, di, 
+						sketch_bucket64(hash, w, M, g, i[j+t], 
+							(uint64_t)table[di*(w+4)], (uint64_t)table[di*(w+4)+1]));
+
+				__builtin_prefetch(&table[idx[di*SKETCH_BATCH+t]], 0, 1);
+			}
+		}
+
+		for (t = 0; t < cnt; t++) {
+			for (di = 0; di < d; di++) {
+				median[di] = table[idx[di*SKETCH_BATCH+t]] * sign_pms(i[j+t], 
+						(uint64_t)table[di*(w+4)+2], 
+						(uint64_t)table[di*(w+4)+3]);
+			}
+
+			est[j+t] = median_wirth(median, d);
+		}
+	}
+}
+
 int64_t count_median_point_partial(count_median_t *restrict s,
 		const uint32_t i, const uint32_t d) {
 	uint32_t wi;
 	const uint32_t w         = s->size.w;
 	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
 	int64_t *restrict table  = s->table;
 	hash hash                = s->hash->hash;
 
 	assert( d < s->size.d );
 
-	wi = hash(w, M, i, (uint64_t)table[d*(w+4)], (uint64_t)table[d*(w+4)+1]);
+	wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[d*(w+4)], 
+			(uint64_t)table[d*(w+4)+1]);
 
 	assert( wi < w );
 
@@ -153,5 +360,62 @@ int64_t count_median_range_sum(count_median_t *restrict s, const uint32_t l,
 	return sum;
 }
 
+// The difference is taken cell by cell, as both sketches share their hashes
+int64_t count_median_point_diff(count_median_t *restrict a, 
+		count_median_t *restrict b, const uint32_t i) {
+	uint32_t di, wi, idx;
+	const uint32_t d         = a->size.d;
+	const uint32_t w         = a->size.w;
+	const uint8_t  M         = a->size.M;
+	const uint8_t  g         = a->size.g;
+	int64_t *restrict ta     = a->table;
+	int64_t *restrict tb     = b->table;
+	int64_t *restrict median = a->median;
+	hash hash                = a->hash->hash;
+
+	assert( a->size.w == b->size.w && a->size.d == b->size.d );
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)ta[di*(w+4)], 
+				(uint64_t)ta[di*(w+4)+1]);
+
+		assert( wi < w );
+
+		idx        = COUNT_MEDIAN_INDEX(w, di, wi);
+		median[di] = (ta[idx] - tb[idx]) * sign_ms(i, 
+				(uint64_t)ta[di*(w+4)+2], 
+				(uint64_t)ta[di*(w+4)+3]);
+	}
+
+	return median_wirth(median, d);
+}
+
+// A row sums the signed differences of the items of every cell, so its L1 is
+// at most the L1 of the difference, and the largest over the rows is kept
+uint64_t count_median_l1_diff(count_median_t *restrict a, 
+		count_median_t *restrict b) {
+	uint32_t di, wi, idx;
+	uint64_t l1, max = 0;
+	const uint32_t d     = a->size.d;
+	const uint32_t w     = a->size.w;
+	int64_t *restrict ta = a->table;
+	int64_t *restrict tb = b->table;
+
+	for (di = 0; di < d; di++) {
+		for (wi = 0, l1 = 0; wi < w; wi++) {
+			idx = COUNT_MEDIAN_INDEX(w, di, wi);
+			l1 += llabs(ta[idx] - tb[idx]);
+		}
+
+		max = (l1 > max) ? l1 : max;
+	}
+
+	return max;
+}
+
+int64_t count_median_error(count_median_t *restrict s, const uint64_t l1) {
+	return ceil(sqrt((double)s->size.b * s->hash->c / s->size.w) * l1);
+}
+
 extern inline double count_median_heavy_hitter_thresshold( const uint64_t l1, 
 		const double epsilon, const double th);
@@ -8,6 +8,7 @@
 // User defined libraries
 #include "sketch/sketch.h"
 #include "util/hash.h"
+#include "util/snapshot.h"
 
 // Helpers
 #define COUNT_MEDIAN_INDEX(width, depth, index) \
@@ -29,12 +30,33 @@ count_median_t *count_median_create(hash_t *restrict hash, const uint8_t b,
 // Destuction
 void count_median_destroy(count_median_t *restrict s);
 
+// An empty sketch hashing as s does, such that the two can be subtracted
+count_median_t *count_median_copy_seeds(const count_median_t *restrict s);
+
+// Zeroes the counters, keeping the hash parameters
+void count_median_clear(count_median_t *restrict s);
+
+// The table, seeds included, as a snapshot section
+void count_median_save(count_median_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+void count_median_load(count_median_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+
 // Update
 void count_median_update(count_median_t *restrict s, const uint32_t i, 
 		const int64_t c);
+int64_t count_median_update_point(count_median_t *restrict s, 
+		const uint32_t i, const int64_t c);
+void count_median_update64(count_median_t *restrict s, const uint64_t i, 
+		const int64_t c);
 
 // Query
 int64_t count_median_point(count_median_t *restrict s, const uint32_t i);
+void count_median_points(count_median_t *restrict s, 
+		const uint32_t *restrict i, int64_t *restrict est, const uint32_t n);
+int64_t count_median_point64(count_median_t *restrict s, const uint64_t i);
+void count_median_points64(count_median_t *restrict s, 
+		const uint64_t *restrict i, int64_t *restrict est, const uint32_t n);
 int64_t count_median_point_partial(count_median_t *restrict s,
 		const uint32_t i, const uint32_t d);
 bool count_median_above_thresshold(count_median_t *restrict s,
@@ -42,6 +64,16 @@ bool count_median_above_thresshold(count_median_t *restrict s,
 int64_t count_median_range_sum(count_median_t *restrict s, const uint32_t l, 
 		const uint32_t r);
 
+// Estimates of the difference of a and b, two sketches of the same seeds
+int64_t count_median_point_diff(count_median_t *restrict a, 
+		count_median_t *restrict b, const uint32_t i);
+uint64_t count_median_l1_diff(count_median_t *restrict a, 
+		count_median_t *restrict b);
+
+// A row of w counters errs by more than sqrt(b*c/w) of the L2 with 
+// probability 1/b, c of the hash, bounded here through the L1
+int64_t count_median_error(count_median_t *restrict s, const uint64_t l1);
+
 // Heavy hitter thresshold
 inline double count_median_heavy_hitter_thresshold(const uint64_t l1, 
 		const double epsilon, const double th) {
@@ -21,6 +21,12 @@ count_min_t *count_min_create(hash_t *restrict hash, const uint8_t b,
 	uint32_t d              = ceil(log2(1 / delta) / log2(b));
 
 	sketch_fixed_size(&d, &w);
+
+	// Hashes into 2^M bins get a power of two
+	if ( hash->pow2 ) {
+		w = next_pow_2(w);
+	}
+
 	hash_init(&s->size.M, w);
 
 	const uint32_t dw       = w*d;
@@ -31,6 +37,8 @@ count_min_t *count_min_create(hash_t *restrict hash, const uint8_t b,
 	s->hash   = hash;
 	s->size.w = w;
 	s->size.d = d;
+	s->size.g = 0;
+	s->size.b = b;
 
 	memset(s->table, '\0', size);
 
@@ -66,12 +74,13 @@ void count_min_update(count_min_t *restrict s, const uint32_t i,
 	uint32_t di, wi;
 	const uint32_t w         = s->size.w;
 	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
 	const uint32_t d         = s->size.d;
 	uint64_t *restrict table = s->table;
 	hash hash                = s->hash->hash;                  
 
 	for (di = 0; di < d; di++) {
-		wi = hash(w, M, i, (uint64_t)table[di*(w+2)], 
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
 				(uint64_t)table[di*(w+2)+1]);
 
 		assert( wi < w );
@@ -80,22 +89,126 @@ void count_min_update(count_min_t *restrict s, const uint32_t i,
 	}
 }
 
+count_min_t *count_min_copy_seeds(const count_min_t *restrict s) {
+	count_min_t *restrict c = xmalloc(sizeof(count_min_t));
+	const uint32_t size     = sizeof(uint64_t) * (s->size.w+2) * s->size.d;
+
+	c->table = xmalloc(size);
+	c->hash  = s->hash;
+	c->size  = s->size;
+
+	memcpy(c->table, s->table, size);
+	count_min_clear(c);
+
+	return c;
+}
+
+void count_min_clear(count_min_t *restrict s) {
+	uint32_t di;
+	const uint32_t w = s->size.w;
+
+	for (di = 0; di < s->size.d; di++) {
+		memset(&s->table[COUNT_MIN_INDEX(w, di, 0)], '\0', 
+				sizeof(uint64_t) * w);
+	}
+}
+
+void count_min_save(count_min_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index) {
+	snapshot_add(snap, "count_min", index, s->table, 
+			sizeof(uint64_t) * (s->size.w+2) * s->size.d);
+}
+
+void count_min_load(count_min_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index) {
+	snapshot_read(snap, "count_min", index, s->table, 
+			sizeof(uint64_t) * (s->size.w+2) * s->size.d);
+}
+
+int64_t count_min_update_point(count_min_t *restrict s, const uint32_t i, 
+		const int64_t c) {
+	uint32_t di, wi, idx;
+	uint64_t estimate = UINT64_MAX;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	const uint32_t d         = s->size.d;
+	uint64_t *restrict table = s->table;
+	hash hash                = s->hash->hash;                  
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
+				(uint64_t)table[di*(w+2)+1]);
+
+		assert( wi < w );
+
+		idx         = COUNT_MIN_INDEX(w, di, wi);
+		table[idx] += c;
+		estimate    = (table[idx] < estimate) ? table[idx] : estimate;
+	}
+
+	return estimate;
+}
+
+// Conservative update, raising the cells of i no further than its new 
+// estimate. Only defined for non-negative counts.
+int64_t count_min_cu_update_point(count_min_t *restrict s, const uint32_t i, 
+		const int64_t c) {
+	uint32_t di;
+	uint64_t estimate = UINT64_MAX;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	const uint32_t d         = s->size.d;
+	uint64_t *restrict table = s->table;
+	hash hash                = s->hash->hash;                  
+	uint32_t idx[d];
+
+	if ( unlikely(c < 0) ) {
+		xerror("Conservative updates require non-negative counts", __LINE__, 
+				__FILE__);
+	}
+
+	for (di = 0; di < d; di++) {
+		idx[di]  = COUNT_MIN_INDEX(w, di, sketch_bucket(hash, w, M, g, i, 
+					(uint64_t)table[di*(w+2)], (uint64_t)table[di*(w+2)+1]));
+		estimate = (table[idx[di]] < estimate) ? table[idx[di]] : estimate;
+	}
+
+	estimate += c;
+
+	for (di = 0; di < d; di++) {
+		if ( table[idx[di]] < estimate ) {
+			table[idx[di]] = estimate;
+		}
+	}
+
+	return estimate;
+}
+
+void count_min_cu_update(count_min_t *restrict s, const uint32_t i, 
+		const int64_t c) {
+	count_min_cu_update_point(s, i, c);
+}
+
 uint64_t count_min_point(count_min_t *restrict s, const uint32_t i) {
 	uint32_t di, wi;
 	uint64_t estimate, e;
 	const uint32_t d         = s->size.d;
 	const uint32_t w         = s->size.w;
 	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
 	uint64_t *restrict table = s->table;
 	hash hash                = s->hash->hash;                  
 
-	wi = hash(w, M, i, (uint64_t)table[0], (uint64_t)table[1]);
+	wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[0], 
+			(uint64_t)table[1]);
 
 	assert( wi < w );
 
 	estimate  = table[COUNT_MIN_INDEX(w, 0, wi)];
 	for (di = 1; di < d; di++) {
-		wi = hash(w, M, i, (uint64_t)table[di*(w+2)], 
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
 				(uint64_t)table[di*(w+2)+1]);
 
 		assert( wi < w );
@@ -110,6 +223,167 @@ uint64_t count_min_point(count_min_t *restrict s, const uint32_t i) {
 	return estimate;
 }
 
+void count_min_points(count_min_t *restrict s, const uint32_t *restrict i,
+		int64_t *restrict est, const uint32_t n) {
+	uint32_t j, t, di, cnt;
+	uint64_t e;
+	const uint32_t d         = s->size.d;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	uint64_t *restrict table = s->table;
+	hash hash                = s->hash->hash;
+	uint32_t idx[SKETCH_BATCH*d];
+
+	for (j = 0; j < n; j += SKETCH_BATCH) {
+		cnt = (n-j < SKETCH_BATCH) ? n-j : SKETCH_BATCH;
+
+		// Hash every point of the batch in every row and prefetch the cells
+		for (di = 0; di < d; di++) {
+			for (t = 0; t < cnt; t++) {
+				idx[di*SKETCH_BATCH+t] = COUNT_MIN_INDEX(w, di, 
+						sketch_bucket(hash, w, M, g, i[j+t], (uint64_t)table[di*(w+2)], 
+							(uint64_t)table[di*(w+2)+1]));
+
+				__builtin_prefetch(&table[idx[di*SKETCH_BATCH+t]], 0, 1);
+			}
+		}
+
+		for (t = 0; t < cnt; t++) {
+			e = table[idx[t]];
+			for (di = 1; di < d; di++) {
+				e = (table[idx[di*SKETCH_BATCH+t]] < e) ? 
+					table[idx[di*SKETCH_BATCH+t]] : e;
+			}
+
+			// The heavy hitter implementation does not support integer > 2^63-1
+			assert( e < ((uint64_t)1 << 63) );
+
+			est[j+t] = (int64_t)e;
+		}
+	}
+}
+
+// The 64-bit keys are hashed by hash64 with the seeds of the rows
+void count_min_update64(count_min_t *restrict s, const uint64_t i, 
+		const int64_t c) {
+	uint32_t di, wi;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	const uint32_t d         = s->size.d;
+	uint64_t *restrict table = s->table;
+	hash64 hash              = s->hash->hash64;
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket64(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
+				(uint64_t)table[di*(w+2)+1]);
+
+		assert( wi < w );
+
+		table[COUNT_MIN_INDEX(w, di, wi)] += c;
+	}
+}
+
+void count_min_cu_update64(count_min_t *restrict s, const uint64_t i, 
+		const int64_t c) {
+	uint32_t di;
+	uint64_t estimate = UINT64_MAX;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	const uint32_t d         = s->size.d;
+	uint64_t *restrict table = s->table;
+	hash64 hash              = s->hash->hash64;
+	uint32_t idx[d];
+
+	if ( unlikely(c < 0) ) {
+		xerror("Conservative updates require non-negative counts", __LINE__, 
+				__FILE__);
+	}
+
+	for (di = 0; di < d; di++) {
+		idx[di]  = COUNT_MIN_INDEX(w, di, sketch_bucket64(hash, w, M, g, i, 
+					(uint64_t)table[di*(w+2)], (uint64_t)table[di*(w+2)+1]));
+		estimate = (table[idx[di]] < estimate) ? table[idx[di]] : estimate;
+	}
+
+	estimate += c;
+
+	for (di = 0; di < d; di++) {
+		if ( table[idx[di]] < estimate ) {
+			table[idx[di]] = estimate;
+		}
+	}
+}
+
+uint64_t count_min_point64(count_min_t *restrict s, const uint64_t i) {
+	uint32_t di, wi;
+	uint64_t estimate = UINT64_MAX, e;
+	const uint32_t d         = s->size.d;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	uint64_t *restrict table = s->table;
+	hash64 hash              = s->hash->hash64;
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket64(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
+				(uint64_t)table[di*(w+2)+1]);
+
+		assert( wi < w );
+
+		e        = table[COUNT_MIN_INDEX(w, di, wi)];
+		estimate = (e < estimate) ? e : estimate;
+	}
+
+	// The heavy hitter implementation does not support integer > 2^63-1
+	assert( estimate < ((uint64_t)1 << 63) );
+
+	return estimate;
+}
+
+void count_min_points64(count_min_t *restrict s, const uint64_t *restrict i,
+		int64_t *restrict est, const uint32_t n) {
+	uint32_t j, t, di, cnt;
+	uint64_t e;
+	const uint32_t d         = s->size.d;
+	const uint32_t w         = s->size.w;
+	const uint8_t  M         = s->size.M;
+	const uint8_t  g         = s->size.g;
+	uint64_t *restrict table = s->table;
+	hash64 hash              = s->hash->hash64;
+	uint32_t idx[SKETCH_BATCH*d];
+
+	for (j = 0; j < n; j += SKETCH_BATCH) {
+		cnt = (n-j < SKETCH_BATCH) ? n-j : SKETCH_BATCH;
+
+		// Hash every point of the batch in every row and prefetch the cells
+		for (di = 0; di < d; di++) {
+			for (t = 0; t < cnt; t++) {
+				idx[di*SKETCH_BATCH+t] = COUNT_MIN_INDEX(w, di, 
+						sketch_bucket64(hash, w, M, g, i[j+t], 
+							(uint64_t)table[di*(w+2)], (uint64_t)table[di*(w+2)+1]));
+
+				__builtin_prefetch(&table[idx[di*SKETCH_BATCH+t]], 0, 1);
+			}
+		}
+
+		for (t = 0; t < cnt; t++) {
+			e = table[idx[t]];
+			for (di = 1; di < d; di++) {
+				e = (table[idx[di*SKETCH_BATCH+t]] < e) ? 
+					table[idx[di*SKETCH_BATCH+t]] : e;
+			}
+
+			// The heavy hitter implementation does not support integer > 2^63-1
+			assert( e < ((uint64_t)1 << 63) );
+
+			est[j+t] = (int64_t)e;
+		}
+	}
+}
+
 uint64_t count_min_point_partial(count_min_t *restrict s, const uint32_t i,
 		const uint32_t d) {
 	(void) s;
@@ -127,11 +401,12 @@ bool count_min_above_thresshold(count_min_t *restrict s, const uint32_t i,
 	const uint32_t d         = s->size.d;
 	const uint32_t w         = s->size.w;
 	const uint32_t M         = s->size.M;
+	const uint8_t  g         = s->size.g;
 	uint64_t *restrict table = s->table;
 	hash hash                = s->hash->hash;                  
 
 	for (di = 0; di < d; di++) {
-		wi = hash(w, M, i, (uint64_t)table[di*(w+2)], 
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
 				(uint64_t)table[di*(w+2)+1]);
 
 		assert( wi < w );
@@ -155,5 +430,38 @@ uint64_t count_min_range_sum(count_min_t *restrict s, const uint32_t l,
 	return sum;
 }
 
+// The cells of a row are summed before the minimum over the rows is taken,
+// as the sketch of the summed streams would estimate
+uint64_t count_min_point_sum(count_min_t *restrict const *restrict s, 
+		const uint32_t n, const uint32_t i) {
+	uint32_t di, wi, j;
+	uint64_t estimate = UINT64_MAX, e;
+	const uint32_t d         = s[0]->size.d;
+	const uint32_t w         = s[0]->size.w;
+	const uint8_t  M         = s[0]->size.M;
+	const uint8_t  g         = s[0]->size.g;
+	uint64_t *restrict table = s[0]->table;
+	hash hash                = s[0]->hash->hash;
+
+	for (di = 0; di < d; di++) {
+		wi = sketch_bucket(hash, w, M, g, i, (uint64_t)table[di*(w+2)], 
+				(uint64_t)table[di*(w+2)+1]);
+
+		assert( wi < w );
+
+		for (j = 0, e = 0; j < n; j++) {
+			e += s[j]->table[COUNT_MIN_INDEX(w, di, wi)];
+		}
+
+		estimate = (e < estimate) ? e : estimate;
+	}
+
+	return (n > 0) ? estimate : 0;
+}
+
+int64_t count_min_error(count_min_t *restrict s, const uint64_t l1) {
+	return ceil((double)s->size.b * s->hash->c * l1 / s->size.w);
+}
+
 extern inline double count_min_heavy_hitter_thresshold(const uint64_t l1, 
 		const double epsilon, const double th);
@@ -8,6 +8,7 @@
 // User defined libraries
 #include "sketch/sketch.h"
 #include "util/hash.h"
+#include "util/snapshot.h"
 
 // Helpers
 #define COUNT_MIN_INDEX(width, depth, index) \
@@ -28,12 +29,39 @@ count_min_t *count_min_create(hash_t *restrict hash, const uint8_t b,
 // Destuction
 void count_min_destroy(count_min_t *restrict s);
 
+// An empty sketch hashing as s does, such that the two can be added
+count_min_t *count_min_copy_seeds(const count_min_t *restrict s);
+
+// Zeroes the counters, keeping the hash parameters
+void count_min_clear(count_min_t *restrict s);
+
+// The table, seeds included, as a snapshot section
+void count_min_save(count_min_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+void count_min_load(count_min_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+
 // Update
 void count_min_update(count_min_t *restrict s, const uint32_t i, 
 		const int64_t c);
+int64_t count_min_update_point(count_min_t *restrict s, const uint32_t i, 
+		const int64_t c);
+void count_min_cu_update(count_min_t *restrict s, const uint32_t i, 
+		const int64_t c);
+int64_t count_min_cu_update_point(count_min_t *restrict s, const uint32_t i, 
+		const int64_t c);
+void count_min_update64(count_min_t *restrict s, const uint64_t i, 
+		const int64_t c);
+void count_min_cu_update64(count_min_t *restrict s, const uint64_t i, 
+		const int64_t c);
 
 // Query
 uint64_t count_min_point(count_min_t *restrict s, const uint32_t i);
+void count_min_points(count_min_t *restrict s, const uint32_t *restrict i,
+		int64_t *restrict est, const uint32_t n);
+uint64_t count_min_point64(count_min_t *restrict s, const uint64_t i);
+void count_min_points64(count_min_t *restrict s, const uint64_t *restrict i,
+		int64_t *restrict est, const uint32_t n);
 uint64_t count_min_point_partial(count_min_t *restrict s, const uint32_t i,
 		const uint32_t d);
 bool count_min_above_thresshold(count_min_t *restrict s, const uint32_t i, 
@@ -41,6 +69,14 @@ bool count_min_above_thresshold(count_min_t *restrict s, const uint32_t i,
 uint64_t count_min_range_sum(count_min_t *restrict s, const uint32_t l, 
 		const uint32_t r);
 
+// Estimate of the sum of n sketches of the same seeds
+uint64_t count_min_point_sum(count_min_t *restrict const *restrict s, 
+		const uint32_t n, const uint32_t i);
+
+// A row of w counters overestimates by more than b*c/w of the L1 with 
+// probability 1/b, c of the hash
+int64_t count_min_error(count_min_t *restrict s, const uint64_t l1);
+
 // Heavy hitter thresshold
 inline double count_min_heavy_hitter_thresshold(const uint64_t l1, 
 		const double epsilon, const double th) {
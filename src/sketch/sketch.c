@@ -15,26 +15,88 @@ inline void sketch_fixed_size(uint32_t *restrict depth,
 		uint32_t *restrict width);
 extern inline uint32_t sketch_depth(void *sketch);
 extern inline uint32_t sketch_width(void *sketch);
+extern inline uint32_t sketch_bucket(hash hash, const uint32_t w, 
+		const uint8_t M, const uint8_t g, const uint32_t i, const uint64_t a, 
+		const uint64_t b);
+extern inline uint32_t sketch_bucket64(hash64 hash, const uint32_t w, 
+		const uint8_t M, const uint8_t g, const uint64_t i, const uint64_t a, 
+		const uint64_t b);
+extern inline void sketch_siblings(void *restrict sketch, uint8_t g);
+
+// The update of a sketch takes the key as s_update does, calling the 32-bit
+// updates through a cast pointer would be undefined
+static void sketch_count_min_update(void *restrict s, const uint64_t i, 
+		const int64_t c) {
+	count_min_update((count_min_t *)s, (uint32_t)i, c);
+}
+
+static void sketch_count_min_cu_update(void *restrict s, const uint64_t i, 
+		const int64_t c) {
+	count_min_cu_update((count_min_t *)s, (uint32_t)i, c);
+}
+
+static void sketch_count_median_update(void *restrict s, const uint64_t i, 
+		const int64_t c) {
+	count_median_update((count_median_t *)s, (uint32_t)i, c);
+}
 
 sketch_func_t countMin = {
 	.create        = (s_create)        count_min_create,
 	.destroy       = (s_destroy)       count_min_destroy,
-	.update        = (s_update)        count_min_update,
+	.update        = (s_update)        sketch_count_min_update,
+	.update_point  = (s_update_point)  count_min_update_point,
 	.point         = (s_point)         count_min_point,
+	.points        = (s_points)        count_min_points,
 	.above         = (s_above)         count_min_above_thresshold,
 	.point_partial = (s_point_partial) count_min_point_partial,
 	.rangesum      = (s_rangesum)      count_min_range_sum,
 	.thresshold    = (s_thresshold)    count_min_heavy_hitter_thresshold,
+	.error         = (s_error)         count_min_error,
+	.update64      = (s_update64)      count_min_update64,
+	.point64       = (s_point64)       count_min_point64,
+	.points64      = (s_points64)      count_min_points64,
+	.save          = (s_save)          count_min_save,
+	.load          = (s_load)          count_min_load,
+	.one_sided     = true,
+};
+
+// Count-Min with conservative updates, rejecting negative counts
+sketch_func_t countMinCU = {
+	.create        = (s_create)        count_min_create,
+	.destroy       = (s_destroy)       count_min_destroy,
+	.update        = (s_update)        sketch_count_min_cu_update,
+	.update_point  = (s_update_point)  count_min_cu_update_point,
+	.point         = (s_point)         count_min_point,
+	.points        = (s_points)        count_min_points,
+	.above         = (s_above)         count_min_above_thresshold,
+	.point_partial = (s_point_partial) count_min_point_partial,
+	.rangesum      = (s_rangesum)      count_min_range_sum,
+	.thresshold    = (s_thresshold)    count_min_heavy_hitter_thresshold,
+	.error         = (s_error)         count_min_error,
+	.update64      = (s_update64)      count_min_cu_update64,
+	.point64       = (s_point64)       count_min_point64,
+	.points64      = (s_points64)      count_min_points64,
+	.save          = (s_save)          count_min_save,
+	.load          = (s_load)          count_min_load,
+	.one_sided     = true,
 };
 
 sketch_func_t countMedian = {
 	.create        = (s_create)        count_median_create,
 	.destroy       = (s_destroy)       count_median_destroy,
-	.update        = (s_update)        count_median_update,
+	.update        = (s_update)        sketch_count_median_update,
+	.update_point  = (s_update_point)  count_median_update_point,
 	.point         = (s_point)         count_median_point,
+	.points        = (s_points)        count_median_points,
 	.point_partial = (s_point_partial) count_median_point_partial,
 	.rangesum      = (s_rangesum)      count_median_range_sum,
 	.thresshold    = (s_thresshold)    count_median_heavy_hitter_thresshold,
+	.error         = (s_error)         count_median_error,
+	.update64      = (s_update64)      count_median_update64,
+	.point64       = (s_point64)       count_median_point64,
+	.points64      = (s_points64)      count_median_points64,
+	.save          = (s_save)          count_median_save,
+	.load          = (s_load)          count_median_load,
 };
 
 sketch_t *sketch_create(sketch_func_t *restrict f, hash_t *restrict hash, 
@@ -60,10 +122,22 @@ void sketch_update(sketch_t *restrict s, const uint32_t i, const int64_t c) {
 	s->funcs->update(s->sketch, i, c);
 }
 
+// Updates i and returns its estimate after the update, reusing the cells 
+// found by the update
+int64_t sketch_update_point(sketch_t *restrict s, const uint32_t i, 
+		const int64_t c) {
+	return s->funcs->update_point(s->sketch, i, c);
+}
+
 int64_t sketch_point(sketch_t *restrict s, const uint32_t i) {
 	return s->funcs->point(s->sketch, i);
 }
 
+void sketch_points(sketch_t *restrict s, const uint32_t *restrict i, 
+		int64_t *restrict est, const uint32_t n) {
+	s->funcs->points(s->sketch, i, est, n);
+}
+
 int64_t sketch_point_partial(sketch_t *restrict s, const uint32_t i, const uint32_t d) {
 	return s->funcs->point_partial(s->sketch, i, d);
 }
@@ -82,3 +156,38 @@ double sketch_thresshold(sketch_t *restrict s, const uint64_t l1,
 		const double epsilon, const double th) {
 	return s->funcs->thresshold(l1, epsilon, th);
 }
+
+int64_t sketch_error(sketch_t *restrict s, const uint64_t l1) {
+	return s->funcs->error(s->sketch, l1);
+}
+
+void sketch_update64(sketch_t *restrict s, const uint64_t i, const int64_t c) {
+	s->funcs->update64(s->sketch, i, c);
+}
+
+int64_t sketch_point64(sketch_t *restrict s, const uint64_t i) {
+	return s->funcs->point64(s->sketch, i);
+}
+
+void sketch_points64(sketch_t *restrict s, const uint64_t *restrict i, 
+		int64_t *restrict est, const uint32_t n) {
+	s->funcs->points64(s->sketch, i, est, n);
+}
+
+void sketch_save(sketch_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index) {
+	if ( s->funcs->save == NULL ) {
+		xerror("The sketch has no snapshots.", __LINE__, __FILE__);
+	}
+
+	s->funcs->save(s->sketch, snap, index);
+}
+
+void sketch_load(sketch_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index) {
+	if ( s->funcs->load == NULL ) {
+		xerror("The sketch has no snapshots.", __LINE__, __FILE__);
+	}
+
+	s->funcs->load(s->sketch, snap, index);
+}
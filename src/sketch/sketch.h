@@ -7,34 +7,63 @@
 
 // User defined libraries
 #include "util/hash.h"
+#include "util/snapshot.h"
+
+// Amount of point queries whose cells are hashed and prefetched before any of
+// them are evaluated in the batched point query
+#define SKETCH_BATCH 16
 
 typedef void*(*s_create)(hash_t *restrict hash, const uint8_t b, 
 		const double epsilon, const double delta);
 typedef void(*s_destroy)(void *restrict s);
 typedef void(*s_update)(void *restrict s, const uint64_t i, const int64_t c);
 typedef uint64_t(*s_point)(void *restrict s, const uint32_t i);
+typedef int64_t(*s_update_point)(void *restrict s, const uint32_t i, 
+		const int64_t c);
+typedef void(*s_points)(void *restrict s, const uint32_t *restrict i,
+		int64_t *restrict est, const uint32_t n);
 typedef uint64_t(*s_point_partial)(void *restrict s, const uint32_t i,
 		const uint32_t d);
 typedef bool(*s_above)(void *restrict s, const uint32_t i, const uint64_t th);
 typedef uint64_t(*s_rangesum)(void *restrict s, const uint32_t l, 
 		const uint32_t r);
 typedef double (*s_thresshold)(uint64_t l1, double epsilon, double th);
+typedef int64_t(*s_error)(void *restrict s, const uint64_t l1);
+typedef void(*s_update64)(void *restrict s, const uint64_t i, const int64_t c);
+typedef int64_t(*s_point64)(void *restrict s, const uint64_t i);
+typedef void(*s_points64)(void *restrict s, const uint64_t *restrict i,
+		int64_t *restrict est, const uint32_t n);
+typedef void(*s_save)(void *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+typedef void(*s_load)(void *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
 
 typedef struct {
 	uint32_t w;
 	uint32_t d;
 	uint8_t  M;
+	uint8_t  g; // Sibling bits, see sketch_bucket
+	uint8_t  b; // A row fails with probability 1/b, see sketch_error
 } sketch_size_t;
 
 typedef struct {
 	s_create        create;
 	s_destroy       destroy;
 	s_update        update;
+	s_update_point  update_point;
 	s_point         point;
+	s_points        points;
 	s_point_partial point_partial;
 	s_above         above;
 	s_rangesum      rangesum;
 	s_thresshold    thresshold;
+	s_error         error;
+	s_update64      update64; // 64-bit keys, hashed by hash64
+	s_point64       point64;
+	s_points64      points64;
+	s_save          save;     // Counters and seeds as a snapshot section
+	s_load          load;     // Into a sketch of the same size
+	bool            one_sided; // Never below the count of non-negative streams
 } sketch_func_t;
 
 typedef struct {
@@ -63,12 +92,63 @@ inline uint32_t sketch_width(void *restrict sketch) {
 	return ((sketch_size_t *)sketch)->w;
 }
 
+// Bucket of i in a row of w counters. The 2^g siblings sharing i>>g are placed
+// in one block chosen by hashing the parent, rotated by the low bits of that 
+// hash. Querying all children of a node thus touches one block per row, while
+// two items of distinct parents still collide with probability 1/w. Items 
+// hashed into a partial last block keep the bucket of their parent. Without
+// siblings it is the plain hash, g is fixed per sketch so the branch is
+// taken the same way on every call.
+inline uint32_t sketch_bucket(hash hash, const uint32_t w, const uint8_t M, 
+		const uint8_t g, const uint32_t i, const uint64_t a, const uint64_t b) {
+	if ( g == 0 ) {
+		return hash(w, M, i, a, b);
+	}
+
+	const uint32_t mask = ((uint32_t)1 << g) - 1;
+	const uint32_t wi   = hash(w, M, i >> g, a, b);
+	const uint32_t r    = (wi & ~mask) | ((wi + i) & mask);
+
+	return (r < w) ? r : wi;
+}
+
+// Bucket of a 64-bit key, placed as sketch_bucket places 32-bit keys
+inline uint32_t sketch_bucket64(hash64 hash, const uint32_t w, 
+		const uint8_t M, const uint8_t g, const uint64_t i, const uint64_t a, 
+		const uint64_t b) {
+	if ( g == 0 ) {
+		return hash(w, M, i, a, b);
+	}
+
+	const uint32_t mask = ((uint32_t)1 << g) - 1;
+	const uint32_t wi   = hash(w, M, i >> g, a, b);
+	const uint32_t r    = (wi & ~mask) | ((wi + (uint32_t)i) & mask);
+
+	return (r < w) ? r : wi;
+}
+
+// Colocates siblings differing in the lowest g bits, must be set before the 
+// first update
+inline void sketch_siblings(void *restrict sketch, uint8_t g) {
+	sketch_size_t *restrict size = (sketch_size_t *)sketch;
+
+	while ( g > 0 && ((uint32_t)1 << g) > size->w ) {
+		g--;
+	}
+
+	size->g = g;
+}
+
 sketch_t *sketch_create(sketch_func_t *restrict f, hash_t *restrict hash, 
 		const uint8_t b, const double epsilon, const double delta);
 void      sketch_destroy(sketch_t *restrict s);
 void      sketch_update(sketch_t *restrict s, const uint32_t i, 
 		const int64_t c);
+int64_t  sketch_update_point(sketch_t *restrict s, const uint32_t i, 
+		const int64_t c);
 int64_t  sketch_point(sketch_t *restrict s, const uint32_t i);
+void      sketch_points(sketch_t *restrict s, const uint32_t *restrict i,
+		int64_t *restrict est, const uint32_t n);
 int64_t  sketch_point_partial(sketch_t *restrict s, const uint32_t i,
 		const uint32_t d);
 bool      sketch_above_thresshold(sketch_t *restrict s, const uint32_t i, 
@@ -78,10 +158,25 @@ int64_t  sketch_range_sum(sketch_t *restrict s, const uint32_t l,
 double sketch_thresshold(sketch_t *restrict s, const uint64_t l1, 
 		const double epsilon, const double th);
 
+// Bound on the error of a point query of a stream of the given L1 norm, from
+// the width of the sketch. It fails with the probability the depth was 
+// chosen for. Count-Min only overestimates, Count-Median errs either way.
+int64_t   sketch_error(sketch_t *restrict s, const uint64_t l1);
+void      sketch_update64(sketch_t *restrict s, const uint64_t i, 
+		const int64_t c);
+int64_t  sketch_point64(sketch_t *restrict s, const uint64_t i);
+void      sketch_points64(sketch_t *restrict s, const uint64_t *restrict i,
+		int64_t *restrict est, const uint32_t n);
+void      sketch_save(sketch_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+void      sketch_load(sketch_t *restrict s, snapshot_t *restrict snap, 
+		const uint32_t index);
+
 /**
  * Structures holding function pointers for different sketch implementations
  */
 extern sketch_func_t countMin;
+extern sketch_func_t countMinCU;
 extern sketch_func_t countMedian;
 
 #endif
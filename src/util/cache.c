@@ -0,0 +1,182 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "xutil.h"
+
+#define CACHE_SYSFS "/sys/devices/system/cpu/cpu0/cache"
+
+// Rough latencies in cycles of a hit in L1, L2, L3 and of main memory
+static const double cache_latency[CACHE_LEVELS+1] = { 4, 14, 50, 200 };
+
+// Cycles spent hashing for a single row of a sketch
+static const double cache_hash_cost = 4;
+
+static uint64_t cache_sizes[CACHE_LEVELS] = { 32 << 10, 1 << 20, 8 << 20 };
+static bool     cache_read                = false;
+
+static void cache_read_sysfs(void) {
+	uint32_t i, level;
+	char path[128], type[32], unit;
+	uint64_t size;
+	FILE *fp;
+
+	for (i = 0; ; i++) {
+		snprintf(path, sizeof(path), CACHE_SYSFS"/index%u/level", i);
+		if ( (fp = fopen(path, "r")) == NULL ) {
+			break;
+		}
+		if ( fscanf(fp, "%u", &level) != 1 ) {
+			level = 0;
+		}
+		fclose(fp);
+
+		snprintf(path, sizeof(path), CACHE_SYSFS"/index%u/type", i);
+		if ( (fp = fopen(path, "r")) == NULL ) {
+			continue;
+		}
+		if ( fscanf(fp, "%31s", type) != 1 ) {
+			type[0] = 'I';
+		}
+		fclose(fp);
+
+		snprintf(path, sizeof(path), CACHE_SYSFS"/index%u/size", i);
+		if ( (fp = fopen(path, "r")) == NULL ) {
+			continue;
+		}
+		unit = '\0';
+		if ( fscanf(fp, "%"SCNu64"%c", &size, &unit) < 1 ) {
+			size = 0;
+		}
+		fclose(fp);
+
+		// Instruction caches hold no counters
+		if ( type[0] == 'I' || level < 1 || level > CACHE_LEVELS || size == 0 ) {
+			continue;
+		}
+
+		if ( unit == 'K' ) {
+			size <<= 10;
+		} else if ( unit == 'M' ) {
+			size <<= 20;
+		} else if ( unit == 'G' ) {
+			size <<= 30;
+		}
+
+		cache_sizes[level-1] = size;
+	}
+
+	cache_read = true;
+}
+
+uint64_t cache_size(const uint8_t level) {
+	if ( unlikely(!cache_read) ) {
+		cache_read_sysfs();
+	}
+
+	return cache_sizes[level-1];
+}
+
+typedef struct {
+	double   bytes;
+	double   accesses;
+} cache_item_t;
+
+static int cache_compare(const void *a, const void *b) {
+	const cache_item_t *x = (const cache_item_t *)a;
+	const cache_item_t *y = (const cache_item_t *)b;
+	const double hx       = x->accesses / x->bytes;
+	const double hy       = y->accesses / y->bytes;
+
+	return (hx < hy) - (hx > hy);
+}
+
+// The hottest bytes, by accesses per byte, are assumed to occupy the lowest 
+// cache level. Reads of an item are spread uniformly over its bytes.
+static double cache_cost(cache_item_t *restrict items, const uint32_t n) {
+	uint32_t i;
+	uint8_t c;
+	double from, to, lo, hi, lat, cost = 0, pos = 0;
+
+	qsort(items, n, sizeof(cache_item_t), cache_compare);
+
+	for (i = 0; i < n; i++) {
+		from = pos;
+		to   = pos + items[i].bytes;
+		lat  = 0;
+		lo   = 0;
+
+		for (c = 0; c < CACHE_LEVELS; c++) {
+			hi   = cache_size(c+1);
+			if ( to > lo && from < hi ) {
+				lat += cache_latency[c] * 
+					(((to < hi) ? to : hi) - ((from > lo) ? from : lo));
+			}
+			lo   = hi;
+		}
+
+		if ( to > lo ) {
+			lat += cache_latency[CACHE_LEVELS] * (to - ((from > lo) ? from : lo));
+		}
+
+		cost += items[i].accesses * lat / items[i].bytes;
+		pos   = to;
+	}
+
+	return cost;
+}
+
+uint8_t cache_exact_layers(const uint64_t *restrict nodes, const uint8_t layers,
+		const uint64_t sketch_bytes, const uint32_t sketch_accesses, 
+		const uint64_t fixed_bytes, const uint32_t fixed_accesses) {
+	uint32_t i, n;
+	uint8_t t, best = 0;
+	double cost, min = 0;
+	uint64_t exact = 0;
+	cache_item_t items[layers+1];
+
+	for (t = 0; t <= layers; t++) {
+		// Never count exactly beyond the last level cache, the space would 
+		// grow with the universe
+		if ( t > 0 ) {
+			exact += nodes[t-1] * sizeof(uint64_t);
+			if ( exact > cache_size(CACHE_LEVELS) ) {
+				break;
+			}
+		}
+
+		n    = 0;
+		cost = 0;
+
+		for (i = 0; i < layers; i++) {
+			if ( i < t ) {
+				items[n].bytes    = nodes[i] * sizeof(uint64_t);
+				items[n].accesses = 1;
+			} else {
+				items[n].bytes    = sketch_bytes;
+				items[n].accesses = sketch_accesses;
+				cost             += cache_hash_cost * sketch_accesses;
+			}
+			n++;
+		}
+
+		if ( fixed_bytes > 0 ) {
+			items[n].bytes    = fixed_bytes;
+			items[n].accesses = fixed_accesses;
+			cost             += cache_hash_cost * fixed_accesses;
+			n++;
+		}
+
+		cost += cache_cost(items, n);
+
+		if ( t == 0 || cost < min ) {
+			min  = cost;
+			best = t;
+		}
+	}
+
+	return best;
+}
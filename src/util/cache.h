@@ -0,0 +1,29 @@
+#ifndef H_CACHE
+#define H_CACHE
+
+#include <stdint.h>
+
+// Cache levels considered by the cost model, beyond them is main memory
+#define CACHE_LEVELS 3
+
+/**
+ * Sizes in bytes of the data caches of the first CPU, read from sysfs on 
+ * first use. Levels that can not be read fall back to common sizes.
+ */
+uint64_t cache_size(const uint8_t level);
+
+/**
+ * Chooses how many of the top layers of a tree to count exactly, such that 
+ * the expected cost in cycles of one update is minimised.
+ *
+ * Layer i holds nodes[i] nodes of 8 bytes when counted exactly and is read 
+ * once per update. A sketched layer occupies sketch_bytes and is read 
+ * sketch_accesses times per update, each read needs a hash. The fixed 
+ * structure is read on every update regardless of the cutoff. The exact 
+ * layers are limited to what fits in the last level cache.
+ */
+uint8_t cache_exact_layers(const uint64_t *restrict nodes, const uint8_t layers,
+		const uint64_t sketch_bytes, const uint32_t sketch_accesses, 
+		const uint64_t fixed_bytes, const uint32_t fixed_accesses);
+
+#endif
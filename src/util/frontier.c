@@ -0,0 +1,93 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "frontier.h"
+#include "xutil.h"
+
+extern inline void frontier_clear(frontier_t *frontier);
+extern inline void frontier_push_back(frontier_t *frontier, 
+		const uint32_t element, const int64_t estimate);
+extern inline void frontier_swap(frontier_t **a, frontier_t **b);
+extern inline void frontier64_push_back(frontier64_t *frontier, 
+		const uint64_t element, const int64_t estimate);
+extern inline void frontier64_swap(frontier64_t **a, frontier64_t **b);
+
+frontier_t *frontier_create(uint32_t size) {
+	frontier_t *frontier = xmalloc( sizeof(frontier_t) );
+
+	size                 = next_pow_2( (size > 0) ? size : 1 );
+
+	frontier->size       = size;
+	frontier->count      = 0;
+	frontier->elm        = xmalloc( size * sizeof(uint32_t) );
+	frontier->est        = xmalloc( size * sizeof(int64_t) );
+
+	memset(frontier->elm, '\0', size * sizeof(uint32_t));
+	memset(frontier->est, '\0', size * sizeof(int64_t));
+
+	return frontier;
+}
+
+void frontier_destroy(frontier_t *frontier) {
+	if ( NULL != frontier ) {
+		if ( NULL != frontier->elm ) {
+			free(frontier->elm);
+			frontier->elm = NULL;
+		}
+		if ( NULL != frontier->est ) {
+			free(frontier->est);
+			frontier->est = NULL;
+		}
+		free(frontier);
+		frontier = NULL;
+	}
+}
+
+void frontier_reserve(frontier_t *frontier, uint32_t size) {
+	if ( likely(size <= frontier->size) ) {
+		return;
+	}
+
+	size            = next_pow_2(size);
+
+	frontier->elm   = xrealloc(frontier->elm, size * sizeof(uint32_t));
+	frontier->est   = xrealloc(frontier->est, size * sizeof(int64_t));
+	frontier->size  = size;
+}
+
+frontier64_t *frontier64_create(uint32_t size) {
+	frontier64_t *frontier = xmalloc( sizeof(frontier64_t) );
+
+	size                   = next_pow_2( (size > 0) ? size : 1 );
+
+	frontier->size         = size;
+	frontier->count        = 0;
+	frontier->elm          = xmalloc( size * sizeof(uint64_t) );
+	frontier->est          = xmalloc( size * sizeof(int64_t) );
+
+	memset(frontier->elm, '\0', size * sizeof(uint64_t));
+	memset(frontier->est, '\0', size * sizeof(int64_t));
+
+	return frontier;
+}
+
+void frontier64_destroy(frontier64_t *frontier) {
+	if ( NULL != frontier ) {
+		free(frontier->elm);
+		free(frontier->est);
+		free(frontier);
+		frontier = NULL;
+	}
+}
+
+void frontier64_reserve(frontier64_t *frontier, uint32_t size) {
+	if ( likely(size <= frontier->size) ) {
+		return;
+	}
+
+	size            = next_pow_2(size);
+
+	frontier->elm   = xrealloc(frontier->elm, size * sizeof(uint64_t));
+	frontier->est   = xrealloc(frontier->est, size * sizeof(int64_t));
+	frontier->size  = size;
+}
@@ -0,0 +1,79 @@
+#ifndef H_FRONTIER
+#define H_FRONTIER
+
+#include <stdint.h>
+
+#include "xutil.h"
+
+/**
+ * A frontier is the set of nodes of a single level of a tree that is being
+ * expanded level by level. The elements and their estimates are kept in two 
+ * parallel arrays, such that a whole level can be handed to a batched point 
+ * query in one go.
+ */
+typedef struct {
+	uint32_t *restrict elm;
+	int64_t  *restrict est;
+	uint32_t           size;
+	uint32_t           count;
+} frontier_t;
+
+// A frontier of a tree over 64-bit keys
+typedef struct {
+	uint64_t *restrict elm;
+	int64_t  *restrict est;
+	uint32_t           size;
+	uint32_t           count;
+} frontier64_t;
+
+frontier_t *frontier_create(uint32_t size);
+
+void frontier_destroy(frontier_t *frontier);
+
+void frontier_reserve(frontier_t *frontier, uint32_t size);
+
+inline void frontier_clear(frontier_t *frontier) {
+	frontier->count = 0;
+}
+
+inline void frontier_push_back(frontier_t *frontier, const uint32_t element,
+		const int64_t estimate) {
+	if ( unlikely(frontier->count == frontier->size) ) {
+		frontier_reserve(frontier, 2*frontier->size);
+	}
+
+	frontier->elm[frontier->count] = element;
+	frontier->est[frontier->count] = estimate;
+	frontier->count++;
+}
+
+inline void frontier_swap(frontier_t **a, frontier_t **b) {
+	frontier_t *tmp = *a;
+	*a              = *b;
+	*b              = tmp;
+}
+
+frontier64_t *frontier64_create(uint32_t size);
+
+void frontier64_destroy(frontier64_t *frontier);
+
+void frontier64_reserve(frontier64_t *frontier, uint32_t size);
+
+inline void frontier64_push_back(frontier64_t *frontier, 
+		const uint64_t element, const int64_t estimate) {
+	if ( unlikely(frontier->count == frontier->size) ) {
+		frontier64_reserve(frontier, 2*frontier->size);
+	}
+
+	frontier->elm[frontier->count] = element;
+	frontier->est[frontier->count] = estimate;
+	frontier->count++;
+}
+
+inline void frontier64_swap(frontier64_t **a, frontier64_t **b) {
+	frontier64_t *tmp = *a;
+	*a                = *b;
+	*b                = tmp;
+}
+
+#endif
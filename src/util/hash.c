@@ -65,14 +65,11 @@ uint64_t cw_bgen (uint8_t M) {
 uint32_t ms(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b) {
 	(void) w;
 
-	// a < 2^w
-	assert( a <= UINT32_MAX ) ;
-
-	// a is odd
+	// a is odd, only its low half is used
 	assert( a&1 ) ;
 
-	// b < 2^w-M
-	assert( b < pow(2, sizeof(uint32_t)*BYTE-M) ) ;
+	// b < 2^w-M in the low half
+	assert( (uint32_t)b < pow(2, sizeof(uint32_t)*BYTE-M) ) ;
 
 	// Amount of bins must be power of 2
 	assert( w && !(w & (w - 1)) );
@@ -80,12 +77,16 @@ uint32_t ms(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b) {
 	return (uint32_t) (a*x+b) >> (sizeof(uint32_t)*BYTE-M);
 }
 
+// The high halves of the seeds are for the hashes of 64-bit keys
 uint64_t ms_agen () {
-	return (uint32_t)0x1 |(uint32_t)(xuni_rand() * UINT32_MAX);
+	return (uint64_t)0x1 | xuni_rand64();
 }
 
 uint64_t ms_bgen (uint8_t M) {
-	return xuni_rand() * (1 << (sizeof(uint32_t)*BYTE-M));
+	const uint64_t hi = (uint32_t)(xuni_rand() * UINT32_MAX);
+
+	return (hi << 32) | (uint32_t)(xuni_rand() * 
+			((uint64_t)1 << (sizeof(uint32_t)*BYTE-M)));
 }
 
 /*****************************************************************************
@@ -96,10 +97,7 @@ uint32_t ms2(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b) {
 	(void) b;
 	(void) w;
 
-	// a < 2^w
-	assert( a <= UINT32_MAX ) ;
-
-	// a is odd
+	// a is odd, only its low half is used
 	assert( a&1 ) ;
 
 	// Amount of bins must be power of 2
@@ -109,12 +107,12 @@ uint32_t ms2(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b) {
 }
 
 uint64_t ms2_agen () {
-	return (uint32_t)0x1 |(uint32_t)(xuni_rand() * UINT32_MAX);
+	return (uint64_t)0x1 | xuni_rand64();
 }
 
+// Unused by ms2, drawn for the hashes of 64-bit keys
 uint64_t ms2_bgen (uint8_t M) {
-	(void) M;
-	return 0;
+	return ms_bgen(M);
 }
 
 /*****************************************************************************
@@ -137,9 +135,33 @@ uint32_t cw2p2(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b) {
 	return ((a*x) & MOD_P) & (w-1);
 }
 
+// Unused by cw2, drawn for the hashes of 64-bit keys
 uint64_t cw2_bgen (uint8_t M) {
+	return cw_bgen(M);
+}
+
+/*****************************************************************************
+ *                          PAIR-MULTIPLY-SHIFT                              *
+ *****************************************************************************/
+
+extern inline uint64_t pair_ms(const uint64_t x, const uint64_t a, 
+		const uint64_t b);
+
+// Top M bits, for a power of 2 amount of bins
+uint32_t pms(uint32_t w, uint8_t M, uint64_t x, uint64_t a, uint64_t b) {
+	(void) w;
+
+	// Amount of bins must be power of 2
+	assert( w && !(w & (w - 1)) );
+
+	return (uint32_t)((pair_ms(x, a, b) >> (63-M)) >> 1);
+}
+
+// Top 32 bits scaled to any amount of bins
+uint32_t pmsw(uint32_t w, uint8_t M, uint64_t x, uint64_t a, uint64_t b) {
 	(void) M;
-	return 0;
+
+	return (uint32_t)(((pair_ms(x, a, b) >> 32) * w) >> 32);
 }
 
 /*****************************************************************************
@@ -150,6 +172,8 @@ extern inline int8_t   sign_ms(uint32_t x, uint64_t a, uint64_t b);
 extern inline uint64_t sign_ms_agen();
 extern inline uint64_t sign_ms_bgen();
 
+extern inline int8_t   sign_pms(uint64_t x, uint64_t a, uint64_t b);
+
 extern inline int8_t   sign_cw(uint32_t x, uint64_t a, uint64_t b);
 extern inline uint64_t sign_cw_agen();
 extern inline uint64_t sign_cw_bgen();
@@ -159,45 +183,55 @@ extern inline uint64_t sign_cw_bgen();
  *****************************************************************************/
 
 hash_t multiplyShift = {
-	.hash = (hash) ms,
-	.agen = (agen) ms_agen,
-	.bgen = (bgen) ms_bgen,
-	.c    = 1,
+	.hash   = (hash)   ms,
+	.hash64 = (hash64) pms,
+	.agen   = (agen)   ms_agen,
+	.bgen   = (bgen)   ms_bgen,
+	.c      = 1,
+	.pow2   = true,
 };
 
 hash_t multiplyShift2 = {
-	.hash = (hash) ms2,
-	.agen = (agen) ms2_agen,
-	.bgen = (bgen) ms2_bgen,
-	.c    = 2,
+	.hash   = (hash)   ms2,
+	.hash64 = (hash64) pms,
+	.agen   = (agen)   ms2_agen,
+	.bgen   = (bgen)   ms2_bgen,
+	.c      = 2,
+	.pow2   = true,
 };
 
 hash_t carterWegman = {
-	.hash = (hash) cw,
-	.agen = (agen) cw_agen,
-	.bgen = (bgen) cw_bgen,
-	.c    = 1,
+	.hash   = (hash)   cw,
+	.hash64 = (hash64) pmsw,
+	.agen   = (agen)   cw_agen,
+	.bgen   = (bgen)   cw_bgen,
+	.c      = 1,
 };
 
 hash_t carterWegmanp2 = {
-	.hash = (hash) cwp2,
-	.agen = (agen) cw_agen,
-	.bgen = (bgen) cw_bgen,
-	.c    = 1,
+	.hash   = (hash)   cwp2,
+	.hash64 = (hash64) pms,
+	.agen   = (agen)   cw_agen,
+	.bgen   = (bgen)   cw_bgen,
+	.c      = 1,
+	.pow2   = true,
 };
 
 hash_t carterWegman2 = {
-	.hash = (hash) cw2,
-	.agen = (agen) cw_agen,
-	.bgen = (bgen) cw2_bgen,
-	.c    = 2,
+	.hash   = (hash)   cw2,
+	.hash64 = (hash64) pmsw,
+	.agen   = (agen)   cw_agen,
+	.bgen   = (bgen)   cw2_bgen,
+	.c      = 2,
 };
 
 hash_t carterWegman2p2 = {
-	.hash = (hash) cw2p2,
-	.agen = (agen) cw_agen,
-	.bgen = (bgen) cw2_bgen,
-	.c    = 2,
+	.hash   = (hash)   cw2p2,
+	.hash64 = (hash64) pms,
+	.agen   = (agen)   cw_agen,
+	.bgen   = (bgen)   cw2_bgen,
+	.c      = 2,
+	.pow2   = true,
 };
 
 void hash_init(uint8_t *restrict M, uint32_t width) {
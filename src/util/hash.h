@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <math.h>
 
@@ -15,14 +16,18 @@
 
 typedef uint32_t(*hash)(uint32_t w, uint8_t M, uint32_t x, uint64_t a, 
 		uint64_t b);
+typedef uint32_t(*hash64)(uint32_t w, uint8_t M, uint64_t x, uint64_t a, 
+		uint64_t b);
 typedef uint64_t(*agen)();
 typedef uint64_t(*bgen)(uint8_t M);
 
 typedef struct {
 	hash hash;
+	hash64 hash64; // Same seeds for 64-bit keys
 	agen agen;
 	bgen bgen;
 	uint8_t c;
+	bool pow2; // Hashes into 2^M bins, widths are best a power of two
 } hash_t;
 
 uint32_t ms(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b);
@@ -42,6 +47,20 @@ uint32_t cw2(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b);
 uint32_t cw2p2(uint32_t w, uint8_t M, uint32_t x, uint64_t a, uint64_t b);
 uint64_t cw2_bgen(uint8_t M);
 
+uint32_t pms(uint32_t w, uint8_t M, uint64_t x, uint64_t a, uint64_t b);
+uint32_t pmsw(uint32_t w, uint8_t M, uint64_t x, uint64_t a, uint64_t b);
+
+// Pair-multiply-shift of Thorup, hashing both 32-bit halves of x with a single
+// 64-bit multiplication, the hash is in the high bits. The seeds are drawn
+// with 64 random bits, of which the hashes of 32-bit keys use the low half.
+inline uint64_t pair_ms(const uint64_t x, const uint64_t a, const uint64_t b) {
+	return (a + (x >> 32)) * (b + (uint32_t)x);
+}
+
+inline int8_t sign_pms(uint64_t x, uint64_t a, uint64_t b) {
+	return (pair_ms(x, a, b) >> 63) ? 1 : -1;
+}
+
 inline int8_t sign_cw(uint32_t x, uint64_t a, uint64_t b) {
 	uint64_t res = a * (uint64_t)x + b;
 	res = (res & MOD_P);
@@ -72,24 +91,24 @@ inline uint64_t sign_cw_bgen () {
 }
 
 inline int8_t sign_ms(uint32_t x, uint64_t a, uint64_t b) {
-	// a < 2^w
-	assert( a <= UINT32_MAX ) ;
-
 	// a is odd
 	assert( a&1 ) ;
 
-	// b < 2^w-M
-	assert( b < pow(2, sizeof(uint32_t)*BYTE-1) ) ;
+	// b < 2^w-M in the low half
+	assert( (uint32_t)b < pow(2, sizeof(uint32_t)*BYTE-1) ) ;
 
 	return ((uint32_t) (a*x+b) >> (sizeof(uint32_t)*BYTE-1)) ? 1 : -1;
 }
 
 inline uint64_t sign_ms_agen () {
-	return (uint32_t)0x1 |(uint32_t)(xuni_rand() * UINT32_MAX);
+	return (uint64_t)0x1 | xuni_rand64();
 }
 
 inline uint64_t sign_ms_bgen () {
-	return xuni_rand() * ((uint32_t)1 << (sizeof(uint32_t)*BYTE-1));
+	const uint64_t hi = (uint32_t)(xuni_rand() * UINT32_MAX);
+
+	return (hi << 32) |
+		(uint32_t)(xuni_rand() * ((uint32_t)1 << (sizeof(uint32_t)*BYTE-1)));
 }
 
 extern hash_t multiplyShift;
@@ -0,0 +1,103 @@
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "heap.h"
+#include "xutil.h"
+
+heap_t *heap_create(uint32_t size) {
+	heap_t *heap = xmalloc( sizeof(heap_t) );
+
+	size         = next_pow_2( (size > 0) ? size : 1 );
+
+	heap->size   = size;
+	heap->count  = 0;
+	heap->data   = xmalloc( size * sizeof(node_t) );
+
+	memset(heap->data, '\0', size * sizeof(node_t));
+
+	return heap;
+}
+
+void heap_destroy(heap_t *heap) {
+	if ( NULL != heap ) {
+		if ( NULL != heap->data ) {
+			free(heap->data);
+			heap->data = NULL;
+		}
+		free(heap);
+		heap = NULL;
+	}
+}
+
+void heap_push(heap_t *heap, uint32_t element, uint8_t layer, int64_t est) {
+	uint32_t i, parent;
+	node_t *restrict data;
+
+	// Reallocate heap if we does not have enough space
+	if ( unlikely(heap->count == heap->size) ) {
+		heap->size *= 2;
+		heap->data  = xrealloc(heap->data, heap->size*sizeof(node_t));
+	}
+
+	data = heap->data;
+	i    = heap->count++;
+
+	// Sift up
+	while ( i > 0 ) {
+		parent = (i-1)/2;
+
+		if ( data[parent].est >= est ) {
+			break;
+		}
+
+		data[i] = data[parent];
+		i       = parent;
+	}
+
+	data[i].est   = est;
+	data[i].elm   = element;
+	data[i].layer = layer;
+}
+
+node_t *heap_pop(heap_t *heap) {
+	uint32_t i, child, count;
+	node_t last;
+	node_t *restrict data = heap->data;
+
+	// The heap is empty
+	if ( unlikely(heap->count == 0) ) {
+		return NULL;
+	}
+
+	heap->res = data[0];
+	count     = --heap->count;
+	last      = data[count];
+	i         = 0;
+
+	// Sift down
+	while ( (child = 2*i+1) < count ) {
+		if ( child+1 < count && data[child+1].est > data[child].est ) {
+			child++;
+		}
+
+		if ( last.est >= data[child].est ) {
+			break;
+		}
+
+		data[i] = data[child];
+		i       = child;
+	}
+
+	data[i] = last;
+
+	return &heap->res;
+}
+
+bool heap_empty(heap_t *heap) {
+	return (heap->count == 0) ? true : false;
+}
+
+void heap_clear(heap_t *heap) {
+	heap->count = 0;
+}
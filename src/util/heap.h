@@ -0,0 +1,35 @@
+#ifndef H_HEAP
+#define H_HEAP
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	int64_t  est;
+	uint32_t elm;
+	uint8_t  layer;
+} node_t;
+
+/**
+ * A binary max-heap of tree nodes keyed on their estimates
+ */
+typedef struct {
+	node_t   *data;
+	uint32_t  size;
+	uint32_t  count;
+	node_t    res;
+} heap_t;
+
+heap_t *heap_create(uint32_t size);
+
+void heap_destroy(heap_t *heap);
+
+void heap_push(heap_t *heap, uint32_t element, uint8_t layer, int64_t est);
+
+node_t *heap_pop(heap_t *heap);
+
+bool heap_empty(heap_t *heap);
+
+void heap_clear(heap_t *heap);
+
+#endif
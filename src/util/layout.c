@@ -0,0 +1,77 @@
+#include <stdint.h>
+
+#include "layout.h"
+#include "xutil.h"
+
+extern inline uint64_t layout_index(const layout_t *restrict layout, 
+		const uint8_t depth, const uint64_t x);
+
+layout_t *layout_create(const uint8_t *restrict gran, const uint8_t depths) {
+	uint8_t r, e, j, bits, bshift;
+	uint64_t nodes, slots, roots, base = 0;
+	layout_t *layout = xmalloc( sizeof(layout_t) );
+
+	layout->depths   = depths;
+	layout->base     = xmalloc( depths * sizeof(uint64_t) );
+	layout->mask     = xmalloc( depths * sizeof(uint64_t) );
+	layout->loc      = xmalloc( depths * sizeof(uint32_t) );
+	layout->shift    = xmalloc( depths * sizeof(uint8_t) );
+	layout->bshift   = xmalloc( depths * sizeof(uint8_t) );
+
+	// The root is not stored, the first band starts below it
+	layout->base[0]   = 0;
+	layout->mask[0]   = 0;
+	layout->loc[0]    = 0;
+	layout->shift[0]  = 0;
+	layout->bshift[0] = 0;
+	roots             = (depths > 1) ? (uint64_t)1 << gran[0] : 0;
+
+	for (r = 1; r < depths; r = e) {
+		// Grow the band while the block of a root still fits in a line
+		slots = 1;
+		nodes = 1;
+		for (e = r+1; e < depths; e++) {
+			nodes <<= gran[e-1];
+			if ( slots + nodes > LAYOUT_LINE ) {
+				break;
+			}
+			slots += nodes;
+		}
+
+		for (bshift = 0; ((uint64_t)1 << bshift) < slots; bshift++) {
+		}
+
+		for (j = r, bits = 0, slots = 0; j < e; j++) {
+			layout->base[j]   = base;
+			layout->shift[j]  = bits;
+			layout->mask[j]   = ((uint64_t)1 << bits) - 1;
+			layout->loc[j]    = slots;
+			layout->bshift[j] = bshift;
+
+			slots += (uint64_t)1 << bits;
+			bits  += (j+1 < e) ? gran[j] : 0;
+		}
+
+		base += roots << bshift;
+
+		for (j = r; j < e; j++) {
+			roots <<= (j < depths-1) ? gran[j] : 0;
+		}
+	}
+
+	layout->size = base;
+
+	return layout;
+}
+
+void layout_destroy(layout_t *layout) {
+	if ( NULL != layout ) {
+		free(layout->base);
+		free(layout->mask);
+		free(layout->loc);
+		free(layout->shift);
+		free(layout->bshift);
+		free(layout);
+		layout = NULL;
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef H_LAYOUT
+#define H_LAYOUT
+
+#include <stdint.h>
+
+// Counters of 8 bytes in one 64 byte cache line
+#define LAYOUT_LINE 8
+
+// Alignment in bytes of arrays using a layout
+#define LAYOUT_ALIGN 64
+
+/**
+ * A subtree-blocked layout of the counters of the top of a tree. The depths 
+ * are grouped into bands, and every node at the first depth of a band is the 
+ * root of a block holding its descendants within the band. A band holds as 
+ * many depths as fit in one cache line, so a root-to-leaf path touches one 
+ * line per band instead of one per depth. Blocks are padded to a power of 
+ * two, a block of a binary tree holds 7 counters of 8 and one of a 4-ary 
+ * tree 5 of 8. Depths that can not share a line are laid out in BFS order.
+ *
+ * The root is depth 0 and is not stored, layer i of a tree is depth i+1. All
+ * index arithmetic is in layout_index.
+ */
+typedef struct {
+	uint64_t *restrict base;   // First slot of the band of a depth
+	uint64_t *restrict mask;   // Node bits below the root of its block
+	uint32_t *restrict loc;    // First slot of a depth within a block
+	uint8_t  *restrict shift;  // Bits from a node to the root of its block
+	uint8_t  *restrict bshift; // log2 of the slots of a block
+	uint8_t            depths;
+	uint64_t           size;   // Slots of the whole layout
+} layout_t;
+
+// gran[i] is the amount of bits added from depth i to depth i+1
+layout_t *layout_create(const uint8_t *restrict gran, const uint8_t depths);
+
+void layout_destroy(layout_t *layout);
+
+inline uint64_t layout_index(const layout_t *restrict layout, 
+		const uint8_t depth, const uint64_t x) {
+	return layout->base[depth] + 
+		((x >> layout->shift[depth]) << layout->bshift[depth]) + 
+		layout->loc[depth] + (x & layout->mask[depth]);
+}
+
+#endif
@@ -0,0 +1,137 @@
+#define _DEFAULT_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "pool.h"
+#include "xutil.h"
+
+struct pool {
+	pthread_t       *threads;
+	uint32_t         size;
+	pthread_mutex_t  lock;
+	pthread_cond_t   work;
+	pthread_cond_t   done;
+	pool_task        task;
+	void           **args;
+	uint32_t         next;
+	uint32_t         count;
+	uint32_t         pending;
+	bool             stop;
+};
+
+static void *pool_worker(void *arg) {
+	uint32_t i;
+	pool_task task;
+	pool_t *pool = (pool_t *)arg;
+
+	pthread_mutex_lock(&pool->lock);
+
+	while ( 1 ) {
+		while ( !pool->stop && pool->next == pool->count ) {
+			pthread_cond_wait(&pool->work, &pool->lock);
+		}
+
+		if ( unlikely(pool->stop) ) {
+			break;
+		}
+
+		i    = pool->next++;
+		task = pool->task;
+
+		pthread_mutex_unlock(&pool->lock);
+
+		task(pool->args[i]);
+
+		pthread_mutex_lock(&pool->lock);
+
+		if ( --pool->pending == 0 ) {
+			pthread_cond_signal(&pool->done);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+pool_t *pool_create(uint32_t size) {
+	uint32_t i;
+	pool_t *pool  = xmalloc( sizeof(pool_t) );
+
+	pool->threads = xmalloc( sizeof(pthread_t) * size );
+	pool->size    = size;
+	pool->task    = NULL;
+	pool->args    = NULL;
+	pool->next    = 0;
+	pool->count   = 0;
+	pool->pending = 0;
+	pool->stop    = false;
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (i = 0; i < size; i++) {
+		if ( pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0 ) {
+			xerror("Unable to create worker thread", __LINE__, __FILE__);
+		}
+	}
+
+	return pool;
+}
+
+void pool_destroy(pool_t *pool) {
+	uint32_t i;
+
+	if ( NULL == pool ) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->size; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work);
+	pthread_cond_destroy(&pool->done);
+
+	free(pool->threads);
+	free(pool);
+	pool = NULL;
+}
+
+void pool_run(pool_t *pool, pool_task task, void **args, uint32_t n) {
+	if ( unlikely(n == 0) ) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+
+	pool->task    = task;
+	pool->args    = args;
+	pool->next    = 0;
+	pool->count   = n;
+	pool->pending = n;
+
+	pthread_cond_broadcast(&pool->work);
+
+	while ( pool->pending > 0 ) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+
+	pool->next  = 0;
+	pool->count = 0;
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+uint32_t pool_size(pool_t *pool) {
+	return pool->size;
+}
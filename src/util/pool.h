@@ -0,0 +1,23 @@
+#ifndef H_POOL
+#define H_POOL
+
+#include <stdint.h>
+
+/**
+ * A fixed size pool of worker threads. A call to pool_run hands one argument
+ * to each of n tasks, which are picked up by the workers, and returns when 
+ * every task has finished.
+ */
+typedef struct pool pool_t;
+
+typedef void(*pool_task)(void *arg);
+
+pool_t *pool_create(uint32_t size);
+
+void pool_destroy(pool_t *pool);
+
+void pool_run(pool_t *pool, pool_task task, void **args, uint32_t n);
+
+uint32_t pool_size(pool_t *pool);
+
+#endif
@@ -0,0 +1,269 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "xutil.h"
+
+static inline uint64_t snapshot_align(const uint64_t x) {
+	return (x + SNAPSHOT_PAGE - 1) & ~(uint64_t)(SNAPSHOT_PAGE - 1);
+}
+
+// Name of a section below the current prefix
+static void snapshot_name(const snapshot_t *restrict s, const char *name,
+		const uint32_t index, char *restrict dst) {
+	const int n = snprintf(dst, SNAPSHOT_NAME, "%s%s.%"PRIu32, s->prefix,
+			name, index);
+
+	if ( n < 0 || n >= SNAPSHOT_NAME ) {
+		xerror("Snapshot section name too long.", __LINE__, __FILE__);
+	}
+}
+
+static snapshot_t *snapshot_alloc(void) {
+	snapshot_t *s = xmalloc( sizeof(snapshot_t) );
+
+	s->sections = NULL;
+	s->data     = NULL;
+	s->count    = 0;
+	s->size     = 0;
+	s->map      = NULL;
+	s->length   = 0;
+
+	memset(s->engine, '\0', SNAPSHOT_NAME);
+	memset(s->prefix, '\0', SNAPSHOT_NAME);
+
+	return s;
+}
+
+snapshot_t *snapshot_create(const char *engine) {
+	snapshot_t *s = snapshot_alloc();
+
+	strncpy(s->engine, engine, SNAPSHOT_NAME-1);
+
+	s->size     = 16;
+	s->sections = xmalloc( s->size * sizeof(snapshot_section_t) );
+	s->data     = xmalloc( s->size * sizeof(void *) );
+
+	return s;
+}
+
+void snapshot_add(snapshot_t *restrict s, const char *name,
+		const uint32_t index, const void *data, const uint64_t size) {
+	snapshot_section_t *restrict section;
+
+	if ( unlikely(s->count == s->size) ) {
+		s->size    += s->size;
+		s->sections = xrealloc(s->sections, s->size*sizeof(snapshot_section_t));
+		s->data     = xrealloc(s->data, s->size*sizeof(void *));
+	}
+
+	section = &s->sections[s->count];
+
+	memset(section->name, '\0', SNAPSHOT_NAME);
+	snapshot_name(s, name, index, section->name);
+
+	section->size     = size;
+	s->data[s->count] = data;
+	s->count++;
+}
+
+static void snapshot_pad(FILE *restrict f, uint64_t n) {
+	uint64_t len;
+	static const uint8_t zero[SNAPSHOT_PAGE];
+
+	for (; n > 0; n -= len) {
+		len = (n < SNAPSHOT_PAGE) ? n : SNAPSHOT_PAGE;
+
+		if ( fwrite(zero, 1, len, f) != len ) {
+			xerror("Failed to write the snapshot.", __LINE__, __FILE__);
+		}
+	}
+}
+
+void snapshot_write(snapshot_t *restrict s, const char *path) {
+	uint32_t i;
+	uint64_t at;
+	FILE *f;
+	snapshot_header_t header;
+	const uint64_t head = sizeof(snapshot_header_t) +
+		(uint64_t)s->count*sizeof(snapshot_section_t);
+	char *tmp = xmalloc( strlen(path) + 5 );
+
+	sprintf(tmp, "%s.tmp", path);
+
+	memset(&header, '\0', sizeof(snapshot_header_t));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	memcpy(header.engine, s->engine, SNAPSHOT_NAME);
+	header.version = SNAPSHOT_VERSION;
+	header.count   = s->count;
+
+	for (i = 0, at = snapshot_align(head); i < s->count; i++) {
+		s->sections[i].offset = at;
+		at                    = snapshot_align(at + s->sections[i].size);
+	}
+
+	if ( (f = fopen(tmp, "wb")) == NULL ) {
+		xerror("Failed to create the snapshot.", __LINE__, __FILE__);
+	}
+
+	if ( fwrite(&header, sizeof(snapshot_header_t), 1, f) != 1 ||
+			fwrite(s->sections, sizeof(snapshot_section_t), s->count, f) !=
+			s->count ) {
+		xerror("Failed to write the snapshot.", __LINE__, __FILE__);
+	}
+
+	snapshot_pad(f, snapshot_align(head) - head);
+
+	for (i = 0; i < s->count; i++) {
+		if ( s->sections[i].size > 0 && fwrite(s->data[i], 1,
+					s->sections[i].size, f) != s->sections[i].size ) {
+			xerror("Failed to write the snapshot.", __LINE__, __FILE__);
+		}
+
+		snapshot_pad(f, snapshot_align(s->sections[i].size) -
+				s->sections[i].size);
+	}
+
+	if ( fflush(f) != 0 || fsync(fileno(f)) != 0 || fclose(f) != 0 ||
+			rename(tmp, path) != 0 ) {
+		xerror("Failed to write the snapshot.", __LINE__, __FILE__);
+	}
+
+	free(tmp);
+}
+
+snapshot_t *snapshot_open(const char *path) {
+	int fd;
+	uint32_t i;
+	struct stat st;
+	snapshot_header_t *restrict header;
+	snapshot_section_t *restrict section;
+	snapshot_t *s = snapshot_alloc();
+
+	if ( (fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0 ) {
+		xerror("Failed to open the snapshot.", __LINE__, __FILE__);
+	}
+
+	if ( (uint64_t)st.st_size < sizeof(snapshot_header_t) ) {
+		xerror("Snapshot is truncated.", __LINE__, __FILE__);
+	}
+
+	s->length = st.st_size;
+	s->map    = mmap(NULL, s->length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if ( s->map == MAP_FAILED ) {
+		xerror("Failed to map the snapshot.", __LINE__, __FILE__);
+	}
+
+	header = (snapshot_header_t *)s->map;
+
+	if ( memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+			header->version != SNAPSHOT_VERSION ) {
+		xerror("Not a snapshot of this version.", __LINE__, __FILE__);
+	}
+
+	if ( sizeof(snapshot_header_t) + (uint64_t)header->count *
+			sizeof(snapshot_section_t) > s->length ) {
+		xerror("Snapshot is truncated.", __LINE__, __FILE__);
+	}
+
+	s->count    = header->count;
+	s->sections = (snapshot_section_t *)(s->map + sizeof(snapshot_header_t));
+	memcpy(s->engine, header->engine, SNAPSHOT_NAME-1);
+
+	for (i = 0; i < s->count; i++) {
+		section = &s->sections[i];
+
+		if ( section->offset % SNAPSHOT_PAGE != 0 ||
+				section->offset > s->length ||
+				section->size > s->length - section->offset ) {
+			xerror("Snapshot is truncated.", __LINE__, __FILE__);
+		}
+	}
+
+	return s;
+}
+
+const void *snapshot_get(snapshot_t *restrict s, const char *name,
+		const uint32_t index, const uint64_t size) {
+	uint32_t i;
+	char path[SNAPSHOT_NAME];
+
+	memset(path, '\0', SNAPSHOT_NAME);
+	snapshot_name(s, name, index, path);
+
+	for (i = 0; i < s->count; i++) {
+		if ( strncmp(s->sections[i].name, path, SNAPSHOT_NAME) != 0 ) {
+			continue;
+		}
+
+		if ( s->sections[i].size != size ) {
+			xerror("Snapshot section does not fit the engine.", __LINE__,
+					__FILE__);
+		}
+
+		return s->map + s->sections[i].offset;
+	}
+
+	xerror("Snapshot section is missing.", __LINE__, __FILE__);
+
+	return NULL;
+}
+
+void snapshot_read(snapshot_t *restrict s, const char *name,
+		const uint32_t index, void *dst, const uint64_t size) {
+	if ( size > 0 ) {
+		memcpy(dst, snapshot_get(s, name, index, size), size);
+	}
+}
+
+void snapshot_check(snapshot_t *restrict s, const char *name,
+		const uint32_t index, const void *data, const uint64_t size) {
+	if ( memcmp(snapshot_get(s, name, index, size), data, size) != 0 ) {
+		xerror("Snapshot section does not fit the engine.", __LINE__, __FILE__);
+	}
+}
+
+void snapshot_nest(snapshot_t *restrict s, const char *name) {
+	const size_t n = strlen(s->prefix);
+
+	if ( n + strlen(name) + 2 > SNAPSHOT_NAME ) {
+		xerror("Snapshot section name too long.", __LINE__, __FILE__);
+	}
+
+	sprintf(s->prefix + n, "%s/", name);
+}
+
+void snapshot_unnest(snapshot_t *restrict s) {
+	size_t n = strlen(s->prefix);
+
+	// Drops the last name and its slash
+	for (n = (n > 0) ? n-1 : 0; n > 0 && s->prefix[n-1] != '/'; n--) {
+	}
+
+	s->prefix[n] = '\0';
+}
+
+void snapshot_destroy(snapshot_t *restrict s) {
+	if ( s == NULL ) {
+		return;
+	}
+
+	if ( s->map != NULL ) {
+		munmap(s->map, s->length);
+	} else {
+		free(s->sections);
+		free(s->data);
+	}
+
+	free(s);
+	s = NULL;
+}
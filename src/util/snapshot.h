@@ -0,0 +1,73 @@
+#ifndef H_SNAPSHOT
+#define H_SNAPSHOT
+
+#include <stdint.h>
+
+#include "xutil.h"
+
+// Sections start on a page, such that every table can be mapped in place
+#define SNAPSHOT_PAGE    4096
+#define SNAPSHOT_NAME    48
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_MAGIC   "HHSNAP"
+
+typedef struct {
+	char     name[SNAPSHOT_NAME]; // Path of the section, zero padded
+	uint64_t offset;              // From the start of the file
+	uint64_t size;                // Bytes
+} snapshot_section_t;
+
+// The file starts with the header and the table of its sections, padded to
+// a page
+typedef struct {
+	char     magic[8];
+	uint32_t version;
+	uint32_t count;                 // Sections
+	char     engine[SNAPSHOT_NAME]; // Name of the engine saved
+} snapshot_header_t;
+
+/**
+ * A self-describing file of named tables. While saving, the sections only
+ * point to the tables of the engine, which are written out as a whole by
+ * snapshot_write. While loading, the file is mapped and a section is found
+ * by its name and checked against the size the engine expects. The name of
+ * a nested engine's section starts with the names passed to snapshot_nest.
+ */
+typedef struct {
+	snapshot_section_t *restrict sections;
+	const void        **restrict data;  // Table of every section to write
+	uint32_t            count;
+	uint32_t            size;
+	char                engine[SNAPSHOT_NAME];
+	char                prefix[SNAPSHOT_NAME];
+	uint8_t            *restrict map;   // Mapped file, NULL while saving
+	uint64_t            length;
+} snapshot_t;
+
+// Saving
+snapshot_t *snapshot_create(const char *engine);
+void snapshot_add(snapshot_t *restrict s, const char *name,
+		const uint32_t index, const void *data, const uint64_t size);
+
+// Writes a temporary file renamed to path once complete, such that path
+// always holds a whole snapshot
+void snapshot_write(snapshot_t *restrict s, const char *path);
+
+// Loading
+snapshot_t *snapshot_open(const char *path);
+const void *snapshot_get(snapshot_t *restrict s, const char *name,
+		const uint32_t index, const uint64_t size);
+void snapshot_read(snapshot_t *restrict s, const char *name,
+		const uint32_t index, void *dst, const uint64_t size);
+
+// Fails unless the section holds the bytes of data, for the shape of an engine
+void snapshot_check(snapshot_t *restrict s, const char *name,
+		const uint32_t index, const void *data, const uint64_t size);
+
+// Names of the sections of a nested engine
+void snapshot_nest(snapshot_t *restrict s, const char *name);
+void snapshot_unnest(snapshot_t *restrict s);
+
+void snapshot_destroy(snapshot_t *restrict s);
+
+#endif
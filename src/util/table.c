@@ -0,0 +1,116 @@
+#include <string.h>
+#include <stdint.h>
+
+#include "table.h"
+#include "xutil.h"
+
+extern inline uint32_t table_slot(const table_t *table, const uint32_t key);
+extern inline int64_t *table_find(table_t *table, const uint32_t key);
+extern inline int64_t *table_insert(table_t *table, const uint32_t key);
+extern inline uint32_t table_key(const table_t *table, const uint32_t slot);
+
+table_t *table_create(uint32_t size) {
+	table_t *table = xmalloc( sizeof(table_t) );
+
+	size           = next_pow_2( (size > 1) ? 2*size : 2 );
+
+	table->size    = size;
+	table->count   = 0;
+	table->log     = xceil_log2(size);
+	table->keys    = xmalloc( size * sizeof(uint64_t) );
+	table->vals    = xmalloc( size * sizeof(int64_t) );
+
+	memset(table->keys, '\0', size * sizeof(uint64_t));
+
+	return table;
+}
+
+void table_destroy(table_t *table) {
+	if ( NULL != table ) {
+		if ( NULL != table->keys ) {
+			free(table->keys);
+			table->keys = NULL;
+		}
+		if ( NULL != table->vals ) {
+			free(table->vals);
+			table->vals = NULL;
+		}
+		free(table);
+		table = NULL;
+	}
+}
+
+void table_clear(table_t *table) {
+	memset(table->keys, '\0', table->size * sizeof(uint64_t));
+	table->count = 0;
+}
+
+// Doubles the size of the table and rehashes all keys
+void table_grow(table_t *table) {
+	uint32_t i, j, mask;
+	uint64_t *restrict keys = table->keys;
+	int64_t  *restrict vals = table->vals;
+	const uint32_t size     = table->size;
+
+	table->size  = 2*size;
+	table->log   = table->log + 1;
+	table->keys  = xmalloc( table->size * sizeof(uint64_t) );
+	table->vals  = xmalloc( table->size * sizeof(int64_t) );
+	mask         = table->size - 1;
+
+	memset(table->keys, '\0', table->size * sizeof(uint64_t));
+
+	for (i = 0; i < size; i++) {
+		if ( keys[i] == TABLE_EMPTY ) {
+			continue;
+		}
+
+		j = table_slot(table, (uint32_t)(keys[i] - 1));
+
+		while ( table->keys[j] != TABLE_EMPTY ) {
+			j = (j + 1) & mask;
+		}
+
+		table->keys[j] = keys[i];
+		table->vals[j] = vals[i];
+	}
+
+	free(keys);
+	free(vals);
+}
+
+void table_save(table_t *table, snapshot_t *snap, const uint32_t index) {
+	snapshot_add(snap, "table_size", index, &table->size, sizeof(uint32_t));
+	snapshot_add(snap, "table_count", index, &table->count, sizeof(uint32_t));
+	snapshot_add(snap, "table_keys", index, table->keys,
+			table->size * sizeof(uint64_t));
+	snapshot_add(snap, "table_vals", index, table->vals,
+			table->size * sizeof(int64_t));
+}
+
+void table_load(table_t *table, snapshot_t *snap, const uint32_t index) {
+	uint32_t size;
+
+	snapshot_read(snap, "table_size", index, &size, sizeof(uint32_t));
+
+	if ( size != table->size ) {
+		if ( size < 2 || (size & (size - 1)) != 0 ) {
+			xerror("Snapshot section does not fit the engine.", __LINE__, 
+					__FILE__);
+		}
+
+		free(table->keys);
+		free(table->vals);
+
+		table->size = size;
+		table->log  = xceil_log2(size);
+		table->keys = xmalloc( size * sizeof(uint64_t) );
+		table->vals = xmalloc( size * sizeof(int64_t) );
+	}
+
+	snapshot_read(snap, "table_count", index, &table->count, sizeof(uint32_t));
+	snapshot_read(snap, "table_keys", index, table->keys,
+			size * sizeof(uint64_t));
+	snapshot_read(snap, "table_vals", index, table->vals,
+			size * sizeof(int64_t));
+}
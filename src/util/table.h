@@ -0,0 +1,85 @@
+#ifndef H_TABLE
+#define H_TABLE
+
+#include <stdint.h>
+
+#include "snapshot.h"
+#include "xutil.h"
+
+// A slot holding zero is empty, keys are stored plus one
+#define TABLE_EMPTY 0
+
+/**
+ * An open addressing hash table with linear probing, mapping 32-bit keys to 
+ * 64-bit values. The table is kept at most half full.
+ */
+typedef struct {
+	uint64_t *restrict keys;
+	int64_t  *restrict vals;
+	uint32_t           size;
+	uint32_t           count;
+	uint8_t            log;
+} table_t;
+
+table_t *table_create(uint32_t size);
+
+void table_destroy(table_t *table);
+
+void table_clear(table_t *table);
+
+void table_grow(table_t *table);
+
+// Snapshots, a loaded table takes the size of the saved one
+void table_save(table_t *table, snapshot_t *snap, const uint32_t index);
+void table_load(table_t *table, snapshot_t *snap, const uint32_t index);
+
+inline uint32_t table_slot(const table_t *table, const uint32_t key) {
+	return (uint32_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> 
+			(64 - table->log));
+}
+
+// Returns the value of key or NULL if the key is not in the table
+inline int64_t *table_find(table_t *table, const uint32_t key) {
+	uint32_t i          = table_slot(table, key);
+	const uint32_t mask = table->size - 1;
+
+	while ( table->keys[i] != TABLE_EMPTY ) {
+		if ( table->keys[i] == (uint64_t)key + 1 ) {
+			return &table->vals[i];
+		}
+		i = (i + 1) & mask;
+	}
+
+	return NULL;
+}
+
+// Returns the value of key, a missing key is inserted with the value zero
+inline int64_t *table_insert(table_t *table, const uint32_t key) {
+	uint32_t i, mask;
+
+	if ( unlikely(2*(table->count+1) > table->size) ) {
+		table_grow(table);
+	}
+
+	i    = table_slot(table, key);
+	mask = table->size - 1;
+
+	while ( table->keys[i] != TABLE_EMPTY ) {
+		if ( table->keys[i] == (uint64_t)key + 1 ) {
+			return &table->vals[i];
+		}
+		i = (i + 1) & mask;
+	}
+
+	table->keys[i] = (uint64_t)key + 1;
+	table->vals[i] = 0;
+	table->count++;
+
+	return &table->vals[i];
+}
+
+inline uint32_t table_key(const table_t *table, const uint32_t slot) {
+	return (uint32_t)(table->keys[slot] - 1);
+}
+
+#endif
@@ -14,6 +14,7 @@ uint32_t I2 = 5678;
 extern inline uint32_t next_pow_2(uint32_t v);
 extern inline uint8_t  xceil_log2(uint64_t x);
 extern inline double   xuni_rand(void);
+extern inline uint64_t xuni_rand64(void);
 
 const uint8_t MultiplyDeBruijnBitPosition2[32] = {
 	  0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8, 
@@ -72,3 +73,17 @@ void *xrealloc(void *ptr, size_t size) {
 
 	return p;
 }
+
+void *xmalloc_aligned(size_t alignment, size_t size) {
+	void *p;
+
+	if (size == 0) {
+		return NULL;
+	}
+
+	if (posix_memalign(&p, alignment, size) != 0) {
+		xerror("Unable to allocate aligned memory", __LINE__, __FILE__);
+	}
+
+	return p;
+}
@@ -32,6 +32,13 @@ inline double xuni_rand(void) {
 	return ((I1 << 16)^(I2 & 0177777)) * 2.328306437080797e-10; /* in [0,1) */
 }
 
+// Two uniform draws, for seeds of 64 bits
+inline uint64_t xuni_rand64(void) {
+	const uint64_t hi = (uint32_t)(xuni_rand() * UINT32_MAX);
+
+	return (hi << 32) | (uint32_t)(xuni_rand() * UINT32_MAX);
+}
+
 inline uint8_t xceil_log2(uint64_t x) {
     static const uint64_t t[6] = {
         0xFFFFFFFF00000000ull,
@@ -64,4 +71,6 @@ void *xmalloc(size_t size);
 
 void *xrealloc(void *ptr, size_t size);
 
+void *xmalloc_aligned(size_t alignment, size_t size);
+
 #endif
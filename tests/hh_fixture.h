@@ -0,0 +1,103 @@
+#ifndef H_TEST_HH_FIXTURE
+#define H_TEST_HH_FIXTURE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <criterion/criterion.h>
+
+#include "hh/hh.h"
+
+/**
+ * Keys and counts shared by the tests of the heavy hitter engines. The keys
+ * differ in their top bits and two of them are siblings, such that an engine
+ * over m = UINT32_MAX reaches its sketched layers before the leaves.
+ */
+#define HH_FIXTURE_SIZE 10
+
+// Of the norm 109824, 4 keys are heavy at phi = 0.05
+static const uint32_t hh_fixture[HH_FIXTURE_SIZE][2] = {
+	{0x00000001, 3543},
+	{0x0F000002, 7932},
+	{0x3A000003, 8234},
+	{0x3A000004, 48},
+	{0x51000005, 58},
+	{0x7C000006, 238},
+	{0x90000007, 732},
+	{0xC5000008, 10038},
+	{0xE1000009, 78},
+	{0xFE000147, 78923}
+};
+
+// Heavy hitters at phi = 0.05 in increasing order of key
+static const uint32_t hh_fixture_heavy[4] = {
+	0x0F000002, 0x3A000003, 0xC5000008, 0xFE000147
+};
+
+// Heavy hitters above 10000 and at phi = 0.05 in order of decreasing count
+static const uint32_t hh_fixture_nested[4][2] = {
+	{0xFE000147, 78923},
+	{0xC5000008, 10038},
+	{0x3A000003, 8234},
+	{0x0F000002, 7932}
+};
+
+static void hh_fixture_update(hh_t *hh) {
+	for (int i = 0; i < HH_FIXTURE_SIZE; i++) {
+		heavy_hitter_update(hh, hh_fixture[i][0], hh_fixture[i][1]);
+	}
+}
+
+static void hh_fixture_expect_query(const heavy_hitter_t *result) {
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4",
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(hh_fixture_heavy[i], result->hitters[i],
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32,
+				hh_fixture_heavy[i], result->hitters[i]);
+	}
+}
+
+// The top-3 in order of decreasing count
+static void hh_fixture_expect_topk(const heavy_hitter_t *result) {
+	cr_assert_eq(result->count, 3, "Top-k (%d) should be 3", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(hh_fixture_nested[i][0], result->hitters[i],
+				"Expected %"PRIu32" to be next top-k got: %"PRIu32,
+				hh_fixture_nested[i][0], result->hitters[i]);
+	}
+}
+
+// Of the thresholds 10000 and 0.05, see hh_fixture_query_thresholds
+static void hh_fixture_expect_thresholds(
+		const heavy_hitter_estimates_t *result) {
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4",
+			result->count);
+	cr_expect_eq(result->nested[0], 2, "Hitters above 10000 (%d) should be 2",
+			result->nested[0]);
+	cr_expect_eq(result->nested[1], 4, "Hitters above phi (%d) should be 4",
+			result->nested[1]);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(hh_fixture_nested[i][0], result->hitters[i].id,
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32,
+				hh_fixture_nested[i][0], result->hitters[i].id);
+		cr_expect_leq(llabs(result->hitters[i].count -
+					(int64_t)hh_fixture_nested[i][1]), result->hitters[i].error,
+				"Estimate %"PRId64" of %"PRIu32" is off by more than %"PRId64,
+				result->hitters[i].count, hh_fixture_nested[i][0],
+				result->hitters[i].error);
+	}
+}
+
+static heavy_hitter_estimates_t *hh_fixture_query_thresholds(hh_t *hh) {
+	const heavy_hitter_threshold_t thresholds[2] = {
+		{ .value = 10000, .absolute = true },
+		{ .value = 0.05 }
+	};
+
+	return heavy_hitter_query_thresholds(hh, thresholds, 2);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include <stdint.h>
+#include <criterion/criterion.h>
+
+#include "util/cache.h"
+
+Test(cache, sizes, .disabled=0) {
+	for (uint8_t i = 1; i <= CACHE_LEVELS; i++) {
+		cr_assert_gt(cache_size(i), 0, "Cache L%d should have a size", i);
+	}
+
+	for (uint8_t i = 2; i <= CACHE_LEVELS; i++) {
+		cr_expect_geq(cache_size(i), cache_size(i-1), 
+				"L%d should be at least as large as L%d", i, i-1);
+	}
+}
+
+Test(cache, small_trees_are_exact, .disabled=0) {
+	uint64_t nodes[8];
+
+	for (uint8_t i = 0; i < 8; i++) {
+		nodes[i] = (uint64_t)2 << i;
+	}
+
+	cr_assert_eq(cache_exact_layers(nodes, 8, 8*1024*8, 8, 0, 0), 8, 
+			"A tree of 510 counters should be counted exactly");
+}
+
+Test(cache, large_trees_are_sketched, .disabled=0) {
+	uint8_t t;
+	uint64_t nodes[32];
+
+	for (uint8_t i = 0; i < 32; i++) {
+		nodes[i] = (uint64_t)2 << i;
+	}
+
+	t = cache_exact_layers(nodes, 32, 8*1024*4, 4, 0, 0);
+
+	cr_assert_lt(t, 32, "The leaves of a 32-bit universe should be sketched");
+	cr_assert_leq(((uint64_t)2 << t) * 8, 2*cache_size(CACHE_LEVELS), 
+			"The exact layers (%d) should fit in the last level cache", t);
+}
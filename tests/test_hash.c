@@ -46,17 +46,19 @@ Test(hash, cw_b_gen, .disabled=0) {
 
 Test(hash, ms_a_gen, .disabled=0) {
 	uint64_t a;
+	bool high = false;
 	for (int j = 0; j < GEN_RUNS; j++) {
 		for (int i = CW_IMPLS; i < IMPLS; i++) {
-			a = hashes[i]->agen();
-
-			// a < 2^w
-			cr_assert( a <= UINT32_MAX ) ;
+			a    = hashes[i]->agen();
+			high = high || a > UINT32_MAX;
 
 			// a is odd
 			cr_assert( a&1 ) ;
 		}
 	}
+
+	// The high half is drawn for the hashes of 64-bit keys
+	cr_assert( high ) ;
 }
 
 Test(hash, ms_b_gen, .disabled=0) {
@@ -65,8 +67,8 @@ Test(hash, ms_b_gen, .disabled=0) {
 		for (int i = CW_IMPLS; i < IMPLS; i++) {
 			b = hashes[i]->bgen(8);
 
-			// b < 2^w-M
-			cr_assert( b < pow(2, sizeof(uint32_t)*BYTE-8) ) ;
+			// b < 2^w-M in the low half
+			cr_assert( (uint32_t)b < pow(2, sizeof(uint32_t)*BYTE-8) ) ;
 		}
 	}
 }
@@ -169,7 +171,7 @@ Test(hash, ms_uniform, .disabled=0) {
 	memset(c, '\0', sizeof(uint64_t)*w);
 
 	a = hashes[4]->agen();
-	b = hashes[4]->bgen(0);
+	b = hashes[4]->bgen(M);
 	for (uint32_t i = 0; i < UNI_RUNS; i++) {
 		c[hashes[4]->hash(w, M, (uint32_t)(xuni_rand()*m), a, b)] += 1;
 	}
@@ -275,15 +277,17 @@ Test(hash, sing_cw_pairwise, .disabled=0) {
 
 Test(hash, sign_ms_a_gen, .disabled=0) {
 	uint64_t a;
+	bool high = false;
 	for (int j = 0; j < GEN_RUNS; j++) {
-		a = sign_ms_agen();
-
-		// a < 2^w
-		cr_assert( a <= UINT32_MAX ) ;
+		a    = sign_ms_agen();
+		high = high || a > UINT32_MAX;
 
 		// a is odd
 		cr_assert( a&1 ) ;
 	}
+
+	// The high half is drawn for the hashes of 64-bit keys
+	cr_assert( high ) ;
 }
 
 Test(hash, sign_ms_b_gen, .disabled=0) {
@@ -291,8 +295,8 @@ Test(hash, sign_ms_b_gen, .disabled=0) {
 	for (int j = 0; j < GEN_RUNS; j++) {
 		b = sign_ms_bgen();
 
-		// b < 2^w-M
-		cr_assert( b < pow(2, sizeof(uint32_t)*BYTE-1) ) ;
+		// b < 2^w-M in the low half
+		cr_assert( (uint32_t)b < pow(2, sizeof(uint32_t)*BYTE-1) ) ;
 	}
 }
 
@@ -341,3 +345,31 @@ Test(hash, sing_ms_pairwise, .disabled=0) {
 		}
 	}
 }
+
+Test(hash, hash64_uniform, .disabled=0) {
+	uint64_t a, b, x;
+	const uint32_t w        = 128;
+	const uint32_t M        = floor(log2(w));
+	uint64_t c[w];
+
+	// Keys differing only in their high or only in their low half
+	for (int j = 0; j < IMPLS; j++) {
+		for (int half = 0; half < 2; half++) {
+			memset(c, '\0', sizeof(uint64_t)*w);
+
+			a = hashes[j]->agen();
+			b = hashes[j]->bgen(M);
+			for (uint32_t i = 0; i < UNI_RUNS; i++) {
+				x = (half == 0) ? ((uint64_t)i << 32) : (0xABCDEF0100000000 | i);
+				c[hashes[j]->hash64(w, M, x, a, b)] += 1;
+			}
+
+			for (uint32_t i = 0; i < w; i++) {
+				uint32_t exp = (uint32_t)UNI_RUNS/w;
+				double err = (double)(abs((int32_t)exp-(int32_t)c[i]))/exp;
+				cr_assert( err < EPSILON, "Hash %d is not uniform on half %d", 
+						j, half );
+			}
+		}
+	}
+}
@@ -0,0 +1,292 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/adaptive.h"
+
+// Keys of ranks drawn with probability falling as rank^-1.5
+static uint32_t zipf(uint64_t *restrict state) {
+	double u, r;
+
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	u = (*state >> 11) * 0x1p-53;
+	r = pow(1-u, -2);
+
+	return (r < 1e9) ? (uint32_t)r * 7919 : 0;
+}
+
+Test(hh_adaptive, hh_choose, .disabled=0) {
+	hh_adaptive_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+	};
+	hh_adaptive_stats_t skewed = {
+		.updates  = 65536,
+		.distinct = 20000,
+		.alpha    = 1.5,
+	};
+	hh_adaptive_stats_t flat = {
+		.updates  = 65536,
+		.distinct = 60000,
+		.alpha    = 0.2,
+	};
+	hh_adaptive_stats_t deletions = {
+		.updates  = 65536,
+		.distinct = 20000,
+		.alpha    = 1.5,
+		.negative = true,
+	};
+	hh_adaptive_stats_t repeated = {
+		.updates  = 65536,
+		.distinct = 100,
+		.alpha    = 1.0,
+	};
+	hh_adaptive_choice_t choice;
+
+	choice = hh_adaptive_choose(&params, &skewed);
+	cr_expect_eq(choice.engine, HH_ADAPTIVE_KMIN, "Expected k-tree of Count-Min");
+	cr_expect_eq(choice.gran, 8, "Expected granularity 8 got: %d", choice.gran);
+	cr_expect_eq(choice.sparse, false, "Expected no exact front end");
+
+	choice = hh_adaptive_choose(&params, &flat);
+	cr_expect_eq(choice.engine, HH_ADAPTIVE_CGT, "Expected group testing");
+
+	choice = hh_adaptive_choose(&params, &deletions);
+	cr_expect_eq(choice.engine, HH_ADAPTIVE_KMEDIAN, 
+			"Expected k-tree of Count-Median");
+
+	choice = hh_adaptive_choose(&params, &repeated);
+	cr_expect_eq(choice.engine, HH_ADAPTIVE_KMIN, "Expected k-tree of Count-Min");
+	cr_expect_eq(choice.gran, 4, "Expected granularity 4 got: %d", choice.gran);
+	cr_expect(choice.sparse, "Expected exact front end");
+}
+
+Test(hh_adaptive, hh_skewed, .disabled=0) {
+	uint64_t state = 88172645463325252ull;
+
+	hh_adaptive_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.sample  = 1000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_adaptive,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	for (uint32_t i = 0; i < 20000; i++) {
+		heavy_hitter_update(hh, zipf(&state), 1);
+	}
+
+	cr_assert_not_null(((hh_adaptive_t *)hh->hh)->engine, 
+			"Expected an engine after the sample");
+	cr_expect_eq(((hh_adaptive_t *)hh->hh)->choice.engine, HH_ADAPTIVE_KMIN,
+			"Expected k-tree of Count-Min for a skewed stream");
+
+	heavy_hitter_t *result = heavy_hitter_topk(hh, 3);
+
+	cr_assert_eq(result->count, 3, "Top-k (%d) should be 3", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq((i+1)*7919, result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				(i+1)*7919, result->hitters[i]);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+// Group testing ranks the keys it decodes above epsilon
+Test(hh_adaptive, hh_flat_topk, .disabled=0) {
+	hh_adaptive_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.sample  = 1000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_adaptive,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	// Distinct keys only, then a key in every tenth update
+	for (uint32_t i = 0; i < 5000; i++) {
+		heavy_hitter_update(hh, (i >= 1000 && i % 10 == 0) ? 42 : 
+				5000 + i*7919, 1);
+	}
+
+	cr_expect_eq(((hh_adaptive_t *)hh->hh)->choice.engine, HH_ADAPTIVE_CGT,
+			"Expected group testing for a flat stream");
+
+	heavy_hitter_t *result = heavy_hitter_topk(hh, 3);
+
+	cr_assert_geq(result->count, 1, "Expected the key 42");
+	cr_assert_leq(result->count, 3, "Top-k (%d) should be at most 3", 
+			result->count);
+	cr_expect_eq(result->hitters[0], 42, "Expected 42 to be the top heavy "
+			"hitter got: %"PRIu32, result->hitters[0]);
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_adaptive, hh_reevaluate, .disabled=0) {
+	uint64_t state = 88172645463325252ull;
+
+	hh_adaptive_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.sample  = 1000,
+		.period  = 10000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_adaptive,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	// Distinct keys only
+	for (uint32_t i = 0; i < 5000; i++) {
+		heavy_hitter_update(hh, 5000 + i*7919, 1);
+	}
+
+	cr_expect_eq(((hh_adaptive_t *)hh->hh)->choice.engine, HH_ADAPTIVE_CGT,
+			"Expected group testing for a flat stream");
+
+	for (uint32_t i = 0; i < 20000; i++) {
+		heavy_hitter_update(hh, zipf(&state), 1);
+	}
+
+	cr_expect_eq(((hh_adaptive_t *)hh->hh)->choice.engine, HH_ADAPTIVE_KMIN,
+			"Expected k-tree of Count-Min once the stream is skewed");
+
+	heavy_hitter_t *result = heavy_hitter_topk(hh, 3);
+
+	cr_assert_eq(result->count, 3, "Top-k (%d) should be 3", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq((i+1)*7919, result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				(i+1)*7919, result->hitters[i]);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+// A query before the sample is complete creates the engine early, the
+// periods are counted from there
+Test(hh_adaptive, hh_reevaluate_early, .disabled=0) {
+	uint64_t state = 88172645463325252ull;
+
+	hh_adaptive_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.sample  = 1000,
+		.period  = 10000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_adaptive,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_adaptive_t *adaptive = hh->hh;
+
+	for (uint32_t i = 0; i < 500; i++) {
+		heavy_hitter_update(hh, 5000 + i*7919, 1);
+	}
+
+	heavy_hitter_query(hh);
+
+	cr_expect_eq(adaptive->choice.engine, HH_ADAPTIVE_CGT,
+			"Expected group testing for a flat stream");
+
+	for (uint32_t i = 0; i < 9999; i++) {
+		heavy_hitter_update(hh, zipf(&state), 1);
+	}
+
+	cr_expect_eq(adaptive->choice.engine, HH_ADAPTIVE_CGT,
+			"Expected no re-evaluation before the period ends");
+
+	heavy_hitter_update(hh, zipf(&state), 1);
+
+	cr_expect_eq(adaptive->choice.engine, HH_ADAPTIVE_KMIN,
+			"Expected k-tree of Count-Min at the end of the period");
+
+	heavy_hitter_destroy(hh);
+}
+
+// The mass carried over to the new engine stays on keys of the stream, as
+// checked on the key 0, which never occurs
+Test(hh_adaptive, hh_reevaluate_small, .disabled=0) {
+	uint64_t state = 88172645463325252ull;
+	const uint32_t m = UINT16_MAX;
+
+	hh_adaptive_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = m,
+		.phi     = 0.05,
+		.sample  = 1000,
+		.period  = 10000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_adaptive,
+	};
+	const heavy_hitter_threshold_t threshold = { .value = 50, .absolute = true };
+	hh_t *hh = heavy_hitter_create(&p);
+
+	for (uint32_t i = 0; i < 5000; i++) {
+		heavy_hitter_update(hh, 1 + (5000 + i*7919) % (m-1), 1);
+	}
+
+	for (uint32_t i = 0; i < 20000; i++) {
+		heavy_hitter_update(hh, 1 + zipf(&state) % (m-1), 1);
+	}
+
+	cr_expect_eq(((hh_adaptive_t *)hh->hh)->choice.engine, HH_ADAPTIVE_KMIN,
+			"Expected k-tree of Count-Min once the stream is skewed");
+
+	heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(hh,
+			&threshold, 1);
+
+	cr_assert_gt(result->count, 0, "Expected keys above 50");
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_neq(result->hitters[i].id, 0, "Key 0 (%"PRId64") should "
+				"not gain mass", result->hitters[i].count);
+		cr_expect_leq(result->hitters[i].id, m, "Key %"PRIu32" is beyond m",
+				result->hitters[i].id);
+	}
+
+	heavy_hitter_destroy(hh);
+}
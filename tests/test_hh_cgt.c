@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/alias.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/cgt.h"
+#include "sketch/sketch.h"
+
+#include "hh_fixture.h"
+
+Test(hh_cgt, hh_top_only, .disabled=0) {
+	hh_cgt_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_cgt,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+// Widths are rounded for hashes into 2^M bins
+Test(hh_cgt, hh_top_only_pow2, .disabled=0) {
+	hh_cgt_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_cgt,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_cgt_t *cgt = hh->hh;
+
+	cr_assert_eq(cgt->w & (cgt->w - 1), 0, "Width %"PRIu32" is not a power "
+			"of two", cgt->w);
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_cgt, hh_top_and_bottom, .disabled=0) {
+	double hh_mass   = 0.70;
+	uint32_t m       = pow(2, 20);
+
+	hh_cgt_params_t params = {
+		.b       = 2,
+		.epsilon = (double)1/64,
+		.delta   = 0.2,
+		.m       = m,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_cgt,
+	};
+
+	hh_t *hh = heavy_hitter_create(&p);
+	double *x       = xmalloc( m*sizeof(double) );
+
+	for (uint32_t i = 0; i < m; i++) {
+		x[i] = (1-hh_mass)/(m-7);
+	}
+
+	/**
+	 * 7 heavy hitters
+	 */
+	x[134]     = 0.10;
+	x[2345]    = 0.10;
+	x[374298]  = 0.10;
+	x[374299]  = 0.10;
+	x[1000000] = 0.10;
+	x[38474]   = 0.10;
+	x[3]       = 0.10;
+
+	alias_t * a = alias_preprocess(m, x);
+
+	uint32_t idx;
+	for (uint32_t i = 0; i < pow(2, 25); i++) {
+		idx = alias_draw(a);
+		heavy_hitter_update(hh, idx, 1);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 7, "Heavy hitters (%d) should be 7", result->count);
+
+	uint32_t H[7] = {  // Expected heavy hitters
+		3, 134, 2345, 38474, 374298, 374299, 1000000
+	};
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	alias_free(a);
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_cgt, hh_top_and_bottom_close_non_hh, .disabled=0) {
+	double hh_mass   = 0.7 + 0.04955 + 0.04812 + 0.05023;
+	uint32_t m       = pow(2, 20);
+
+	hh_cgt_params_t params = {
+		.b       = 2,
+		.epsilon = (double)1/128,
+		.delta   = 0.2,
+		.m       = m,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_cgt,
+	};
+
+	hh_t *hh   = heavy_hitter_create(&p);
+	double *x  = xmalloc( m*sizeof(double) );
+
+	for (uint32_t i = 0; i < m; i++) {
+		x[i] = (1-hh_mass)/(m-7);
+	}
+
+	/**
+	 * 7 heavy hitters
+	 */
+	x[134]     = 0.10;
+	x[2345]    = 0.10;
+	x[374298]  = 0.10;
+	x[374299]  = 0.10;
+	x[1000000] = 0.10;
+	x[38474]   = 0.10;
+	x[3]       = 0.10;
+	x[737449]  = 0.05023;
+
+	/**
+	 * High but not heavy hitters
+	 */
+	x[5983]    = 0.04955;
+	x[389449]  = 0.04812;
+
+	alias_t * a = alias_preprocess(m, x);
+
+	uint32_t idx;
+	for (uint32_t i = 0; i < pow(2, 25); i++) {
+		idx = alias_draw(a);
+		heavy_hitter_update(hh, idx, 1);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_expect_eq(result->count, 8, "Heavy hitters (%d) should be 8", result->count);
+
+	uint32_t H[8] = {  // Expected heavy hitters
+		3, 134, 2345, 38474, 374298, 374299, 737449, 1000000
+	};
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	alias_free(a);
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_cgt, hh_thresholds, .disabled=0) {
+	hh_cgt_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_cgt,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+// Keys above m have bits the buckets do not count
+Test(hh_cgt, hh_out_of_range, .exit_code=EXIT_FAILURE) {
+	hh_cgt_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = 1023,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_cgt,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	heavy_hitter_update(hh, 1024, 1);
+	heavy_hitter_destroy(hh);
+}
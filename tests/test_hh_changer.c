@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/changer.h"
+
+Test(hh_changer, hh_heavy_changers, .disabled=0) {
+	uint32_t i;
+	uint8_t exact[2] = { 0, 16 };
+
+	uint32_t H[3] = { 9, 11, 13 }; // Expected heavy changers
+	int64_t  C[3] = { 2500, 800, -600 };
+
+	for (int e = 0; e < 2; e++) {
+		hh_changer_params_t params = {
+			.b       = 4,
+			.epsilon = 0.05,
+			.delta   = 0.2,
+			.m       = UINT16_MAX,
+			.phi     = 0.1,
+			.exact   = exact[e],
+		};
+		heavy_hitter_params_t p = {
+			.hash   = &multiplyShift,
+			.params = &params,
+		};
+		hh_changer_t *hh = hh_changer_create(&p);
+
+		for (int epoch = 0; epoch < 2; epoch++) {
+			if ( epoch > 0 ) {
+				hh_changer_epoch(hh);
+			}
+
+			// Steady items outweighing every changer within an epoch
+			for (i = 0; i < 200; i++) {
+				hh_changer_update(hh, 1000 + 17*i, 50);
+			}
+
+			hh_changer_update(hh, 5, 1000);
+			hh_changer_update(hh, 9, (epoch == 0) ? 500 : 3000);
+			hh_changer_update(hh, (epoch == 0) ? 13 : 11, 
+					(epoch == 0) ? 600 : 800);
+		}
+
+		heavy_changers_t *result = hh_changer_query(hh, 0.1);
+
+		cr_assert_eq(result->count, 3, "Heavy changers (%d) should be 3", 
+				result->count);
+
+		for (i = 0; i < result->count; i++) {
+			cr_expect_eq(result->hitters[i].id, H[i], "Expected %"PRIu32
+					" to be next heavy changer got %"PRIu32, H[i],
+					result->hitters[i].id);
+			cr_expect(llabs(result->hitters[i].change - C[i]) < 100, 
+					"Change of %"PRIu32" should be about %"PRId64, H[i], C[i]);
+		}
+
+		cr_expect(llabs((int64_t)hh_changer_l1(hh) - 3900) < 400,
+				"L1 of the difference should be about 3900");
+
+		hh_changer_destroy(hh);
+	}
+}
+
+// Without a change the threshold is 0, yet no prefix is expanded
+Test(hh_changer, hh_unchanged, .disabled=0) {
+	uint32_t i;
+	uint8_t exact[2] = { 0, 16 };
+
+	for (int e = 0; e < 2; e++) {
+		hh_changer_params_t params = {
+			.b       = 4,
+			.epsilon = 0.05,
+			.delta   = 0.2,
+			.m       = UINT16_MAX,
+			.phi     = 0.1,
+			.exact   = exact[e],
+		};
+		heavy_hitter_params_t p = {
+			.hash   = &multiplyShift,
+			.params = &params,
+		};
+		hh_changer_t *hh = hh_changer_create(&p);
+
+		heavy_changers_t *result = hh_changer_query(hh, 0.1);
+
+		cr_expect_eq(result->count, 0, "Changers of an empty stream (%d) "
+				"should be 0", result->count);
+
+		for (int epoch = 0; epoch < 2; epoch++) {
+			if ( epoch > 0 ) {
+				hh_changer_epoch(hh);
+			}
+
+			for (i = 0; i < 200; i++) {
+				hh_changer_update(hh, 1000 + 17*i, 50);
+			}
+		}
+
+		result = hh_changer_query(hh, 0.1);
+
+		cr_expect_eq(hh_changer_l1(hh), 0, "L1 of equal epochs should be 0");
+		cr_expect_eq(result->count, 0, "Changers of equal epochs (%d) "
+				"should be 0", result->count);
+		cr_expect_eq(hh->cur->count, 0, "No prefix (%d) should be expanded",
+				hh->cur->count);
+
+		hh_changer_destroy(hh);
+	}
+}
@@ -11,6 +11,8 @@
 #include "hh/const_sketch.h"
 #include "sketch/sketch.h"
 
+#include "hh_fixture.h"
+
 Test(hh_const_sketch, hh_top_only, .disabled=0) {
 	uint32_t A[10][2] = {
 		{1, 3543},
@@ -201,3 +203,111 @@ Test(hh_const_sketch, hh_top_and_bottom_close_non_hh, .disabled=0) {
 	alias_free(a);
 	heavy_hitter_destroy(hh);
 }
+
+Test(hh_const_sketch, hh_topk, .disabled=0) {
+	hh_const_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_const_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_const_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->exact_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_topk(heavy_hitter_topk(hh, 3));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_const_sketch, hh_thresholds, .disabled=0) {
+	hh_const_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_const_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_const_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->exact_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+static void hh_const_sketch_count_crossing(void *arg, const uint32_t idx, 
+		const int64_t est) {
+	(void) idx;
+	(void) est;
+	(*(uint32_t *)arg)++;
+}
+
+Test(hh_const_sketch, hh_incremental, .disabled=0) {
+	uint32_t G[3] = {  // Expected heavy hitters after the first key becomes heavy
+		hh_fixture[0][0], 0xC5000008, 0xFE000147
+	};
+
+	uint32_t crossings = 0;
+
+	hh_const_sketch_params_t params = {
+		.b           = 2,
+		.epsilon     = 0.01,
+		.delta       = 0.2,
+		.m           = UINT32_MAX,
+		.phi         = 0.05,
+		.exact       = 4, // Sketch the leaves
+		.incremental = true,
+		.crossing    = hh_const_sketch_count_crossing,
+		.arg         = &crossings,
+		.f           = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_const_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	hh_fixture_update(hh);
+
+	// The first key and the 4 heavy ones were above the threshold right after
+	// their update
+	cr_expect_eq(crossings, 5, "Crossings (%d) should be 5", crossings);
+
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_update(hh, hh_fixture[0][0], 80000);
+
+	cr_expect_eq(crossings, 6, "Crossings (%d) should be 6", crossings);
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 3, "Heavy hitters (%d) should be 3", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(G[i], result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				G[i], result->hitters[i]);
+	}
+
+	heavy_hitter_destroy(hh);
+}
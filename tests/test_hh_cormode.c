@@ -11,6 +11,8 @@
 #include "hh/cormode_cmh.h"
 #include "sketch/sketch.h"
 
+#include "hh_fixture.h"
+
 Test(hh_cormode, hh_top_only, .disabled=0) {
 	uint32_t A[10][2] = {
 		{1, 3543},
@@ -198,3 +200,27 @@ Test(hh_cormode, hh_top_and_bottom_close_non_hh, .disabled=0) {
 	alias_free(a);
 	heavy_hitter_destroy(hh);
 }
+
+Test(hh_cormode, hh_thresholds, .disabled=0) {
+	hh_cormode_cmh_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_cormode_cmh,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	CMH_type *tree = hh->hh;
+
+	cr_assert(tree->freelim > 0, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
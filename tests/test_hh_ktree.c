@@ -11,6 +11,8 @@
 #include "hh/ktree.h"
 #include "sketch/sketch.h"
 
+#include "hh_fixture.h"
+
 Test(hh_ktree, hh_top_only, .disabled=0) {
 	uint32_t A[10][2] = {
 		{1, 3543},
@@ -66,6 +68,96 @@ Test(hh_ktree, hh_top_only, .disabled=0) {
 	heavy_hitter_destroy(hh);
 }
 
+// A leaf after the point where the mass left of its parent ran out is never
+// read, so a counter planted there is not reported, while a heavy leaf after
+// a light sibling still is
+Test(hh_ktree, hh_exact_budget, .disabled=0) {
+	uint8_t G[2] = {1, 8};
+	uint32_t M[2] = {(1 << 10) - 1, (1 << 16) - 1};
+
+	for (int g = 0; g < 2; g++) {
+		hh_ktree_params_t params = {
+			.b       = 4,
+			.epsilon = 0.01,
+			.delta   = 0.2,
+			.m       = M[g],
+			.phi     = 0.5,
+			.gran    = G[g],
+			.exact   = 32,
+			.f       = &countMin,
+		};
+		heavy_hitter_params_t p = {
+			.hash   = &multiplyShift,
+			.params = &params,
+			.f      = &hh_ktree,
+		};
+		hh_t *hh       = heavy_hitter_create(&p);
+		hh_ktree_t *kt = (hh_ktree_t *)hh->hh;
+
+		cr_assert_eq(kt->top_cnt, kt->logm, "Expected only exact layers");
+
+		heavy_hitter_update(hh, 0, 100);
+		kt->top[layout_index(kt->layout, kt->logm, 200)] = 1000;
+
+		heavy_hitter_t *result = heavy_hitter_query(hh);
+
+		cr_expect_eq(result->count, 1, "Heavy hitters (%d) should be 1", 
+				result->count);
+		cr_expect_eq(result->hitters[0], 0, "Expected 0 got: %"PRIu32, 
+				result->hitters[0]);
+
+		kt->top[layout_index(kt->layout, kt->logm, 200)] = 0;
+		heavy_hitter_update(hh, 0, -100);
+		heavy_hitter_update(hh, 200, 10);
+		heavy_hitter_update(hh, 201, 100);
+
+		result = heavy_hitter_query(hh);
+
+		cr_expect_eq(result->count, 1, "Heavy hitters (%d) should be 1", 
+				result->count);
+		cr_expect_eq(result->hitters[0], 201, "Expected 201 got: %"PRIu32, 
+				result->hitters[0]);
+
+		heavy_hitter_destroy(hh);
+	}
+}
+
+// Counts of Count-Median engines may be negative, so the mass left of the
+// parent bounds nothing and every child is read
+Test(hh_ktree, hh_exact_deletions, .disabled=0) {
+	hh_ktree_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = (1 << 16) - 1,
+		.phi     = 0.5,
+		.gran    = 8,
+		.exact   = 32,
+		.f       = &countMedian,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	heavy_hitter_update(hh, 0, 100);
+	heavy_hitter_update(hh, 16, -100);
+	heavy_hitter_update(hh, 32, 80);
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 2, "Heavy hitters (%d) should be 2", 
+			result->count);
+	cr_expect_eq(result->hitters[0], 0, "Expected 0 got: %"PRIu32, 
+			result->hitters[0]);
+	cr_expect_eq(result->hitters[1], 32, "Expected 32 got: %"PRIu32, 
+			result->hitters[1]);
+
+	heavy_hitter_destroy(hh);
+}
+
 Test(hh_ktree, hh_top_and_bottom, .disabled=0) {
 	double hh_mass   = 0.70;
 	uint32_t m       = pow(2, 20);
@@ -204,3 +296,409 @@ Test(hh_ktree, hh_top_and_bottom_close_non_hh, .disabled=0) {
 	alias_free(a);
 	heavy_hitter_destroy(hh);
 }
+
+Test(hh_ktree, hh_parallel_query, .disabled=0) {
+	double hh_mass   = 0.70;
+	uint32_t m       = pow(2, 20);
+
+	hh_ktree_params_t params = {
+		.b       = 4,
+		.epsilon = (double)1/64,
+		.delta   = 0.2,
+		.m       = m,
+		.phi     = 0.05,
+		.gran    = 4,
+		.threads = 4,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+
+	hh_t *hh = heavy_hitter_create(&p);
+	double *x       = xmalloc( m*sizeof(double) );
+
+	for (uint32_t i = 0; i < m; i++) {
+		x[i] = (1-hh_mass)/(m-7);
+	}
+
+	/**
+	 * 7 heavy hitters
+	 */
+	x[134]     = 0.10;
+	x[2345]    = 0.10;
+	x[374298]  = 0.10;
+	x[374299]  = 0.10;
+	x[1000000] = 0.10;
+	x[38474]   = 0.10;
+	x[3]       = 0.10;
+
+	alias_t * a = alias_preprocess(m, x);
+
+	uint32_t idx;
+	for (uint32_t i = 0; i < pow(2, 22); i++) {
+		idx = alias_draw(a);
+		heavy_hitter_update(hh, idx, 1);
+	}
+
+	// Query twice to make sure the pool and worker frontiers are reusable
+	heavy_hitter_query(hh);
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 7, "Heavy hitters (%d) should be 7", result->count);
+
+	uint32_t H[7] = {  // Expected heavy hitters
+		3, 134, 2345, 38474, 374298, 374299, 1000000
+	};
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	heavy_hitter_destroy(hh);
+	alias_free(a);
+	free(x);
+}
+
+Test(hh_ktree, hh_topk, .disabled=0) {
+	hh_ktree_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.gran    = 2,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_ktree_t *tree = hh->hh;
+
+	cr_assert_lt(tree->top_cnt, tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_topk(heavy_hitter_topk(hh, 3));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_ktree, hh_thresholds, .disabled=0) {
+	hh_ktree_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.gran    = 2,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_ktree_t *tree = hh->hh;
+
+	cr_assert_lt(tree->top_cnt, tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+static void hh_ktree_count_crossing(void *arg, const uint32_t idx, 
+		const int64_t est) {
+	(void) idx;
+	(void) est;
+	(*(uint32_t *)arg)++;
+}
+
+Test(hh_ktree, hh_incremental, .disabled=0) {
+	uint32_t G[3] = {  // Expected heavy hitters after the first key becomes heavy
+		hh_fixture[0][0], 0xC5000008, 0xFE000147
+	};
+
+	uint32_t crossings = 0;
+
+	hh_ktree_params_t params = {
+		.b           = 4,
+		.epsilon     = 0.01,
+		.delta       = 0.2,
+		.m           = UINT32_MAX,
+		.phi         = 0.05,
+		.gran        = 2,
+		.exact       = 4, // Sketch the leaves
+		.incremental = true,
+		.crossing    = hh_ktree_count_crossing,
+		.arg         = &crossings,
+		.f           = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	hh_fixture_update(hh);
+
+	// The first key and the 4 heavy ones were above the threshold right after
+	// their update
+	cr_expect_eq(crossings, 5, "Crossings (%d) should be 5", crossings);
+
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_update(hh, hh_fixture[0][0], 80000);
+
+	cr_expect_eq(crossings, 6, "Crossings (%d) should be 6", crossings);
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 3, "Heavy hitters (%d) should be 3", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(G[i], result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				G[i], result->hitters[i]);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_ktree, hh_granularity, .disabled=0) {
+	uint8_t grans[KTREE_LAYERS];
+	uint8_t logm, bits;
+
+	hh_ktree_params_t params = {
+		.m       = pow(2, 10),
+		.phi     = 0.05,
+		.gran    = 2,
+	};
+
+	// The top layer takes the single bit left over by the layers below it
+	logm = hh_ktree_granularity(&params, grans);
+
+	cr_assert_eq(logm, 6, "Layers (%d) should be 6", logm);
+	cr_expect_eq(grans[0], 1, "Top layer (%d) should span 1 bit", grans[0]);
+
+	for (uint8_t i = 1; i < logm; i++) {
+		cr_expect_eq(grans[i], 2, "Layer %d should span 2 bits", i);
+	}
+
+	params.m    = UINT32_MAX;
+	params.gran = 0;
+	logm        = hh_ktree_granularity(&params, grans);
+	bits        = 0;
+
+	for (uint8_t i = 0; i < logm; i++) {
+		bits += grans[i];
+		cr_expect(i == 0 || grans[i] <= grans[0], 
+				"Layer %d should not be wider than the top", i);
+	}
+
+	cr_expect_eq(bits, 32, "Layers should span 32 bits, not %d", bits);
+}
+
+Test(hh_ktree, hh_mixed_granularity, .disabled=0) {
+	uint32_t A[10][2] = {
+		{1, 3543},
+		{2, 7932},
+		{3, 8234},
+		{4, 48},
+		{5, 58},
+		{6, 238},
+		{7, 732},
+		{8, 10038},
+		{9, 78},
+		{327, 78923}
+	};
+
+	uint32_t H[4] = {  // Expected heavy hitters
+		2, 3, 8, 327
+	};
+
+	uint8_t grans[4] = { 4, 3, 2, 2 }; // Wide near the root
+
+	hh_ktree_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = pow(2, 10),
+		.phi     = 0.05,
+		.grans   = grans,
+		.exact   = 1,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	for (int i = 0; i < 10; i++) {
+		heavy_hitter_update(hh, A[i][0], A[i][1]);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	result = heavy_hitter_topk(hh, 3);
+
+	cr_assert_eq(result->count, 3, "Top-k (%d) should be 3", result->count);
+	cr_expect_eq(result->hitters[0], 327, "Expected 327 to be the top");
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_ktree, hh_constant_granularity, .disabled=0) {
+	uint32_t A[10][2] = {
+		{1, 3543},
+		{258, 7932},
+		{3, 8234},
+		{4, 48},
+		{5, 58},
+		{6, 238},
+		{7, 732},
+		{40000, 10038},
+		{9, 78},
+		{65535, 78923}
+	};
+
+	uint32_t H[4] = {  // Expected heavy hitters
+		3, 258, 40000, 65535
+	};
+
+	uint8_t grans[4] = { 1, 2, 4, 8 };
+
+	// Every kernel, with the whole tree counted exactly and with sketches
+	for (uint8_t g = 0; g < 8; g++) {
+		hh_ktree_params_t params = {
+			.b       = 4,
+			.epsilon = 0.01,
+			.delta   = 0.2,
+			.m       = pow(2, 16),
+			.phi     = 0.05,
+			.gran    = grans[g % 4],
+			.exact   = (g < 4) ? KTREE_LAYERS : 1,
+			.f       = &countMin,
+		};
+		heavy_hitter_params_t p = {
+			.hash   = &carterWegman,
+			.params = &params,
+			.f      = &hh_ktree,
+		};
+		hh_t *hh = heavy_hitter_create(&p);
+
+		for (int i = 0; i < 10; i++) {
+			heavy_hitter_update(hh, A[i][0], A[i][1]);
+		}
+
+		heavy_hitter_t *result = heavy_hitter_query(hh);
+
+		cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4 for %d bits", 
+				result->count, grans[g % 4]);
+
+		for (uint32_t i = 0; i < result->count; i++) {
+			cr_expect_eq(
+					H[i], 
+					result->hitters[i], 
+					"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+					H[i], 
+					result->hitters[i]
+			);
+		}
+
+		heavy_hitter_destroy(hh);
+	}
+}
+
+Test(hh_ktree, hh_hierarchical, .disabled=0) {
+	const uint32_t host = (10 << 24) | 1;        // 10.0.0.1
+	const uint32_t net  = (10 << 24) | (1 << 8); // 10.0.1.0/24
+
+	hhh_t H[3] = {  // Expected hierarchical heavy hitters
+		{ host,     32, 3000, 3000 },
+		{ net >> 8, 24, 2000, 2000 },
+		{ 0,         0, 10000, 5000 },
+	};
+
+	hh_ktree_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.gran    = 8,
+		.exact   = 2,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	heavy_hitter_update(hh, host, 3000);
+
+	for (uint32_t i = 0; i < 200; i++) {
+		heavy_hitter_update(hh, net | i, 10);
+	}
+
+	// Light in every /8, heavy only at the root
+	for (uint32_t i = 0; i < 5000; i++) {
+		heavy_hitter_update(hh, ((i % 200 + 20) << 24) | i, 1);
+	}
+
+	heavy_hitter_hhh_t *result = heavy_hitter_query_hhh(hh, 0.1);
+
+	cr_assert_eq(result->count, 3, "Hierarchical heavy hitters (%d) should be 3",
+			result->count);
+	cr_expect_eq(result->bits, 32, "Leaves (%d) should span 32 bits", 
+			result->bits);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(H[i].prefix, result->hitters[i].prefix, 
+				"Expected prefix %"PRIx32" got %"PRIx32, H[i].prefix, 
+				result->hitters[i].prefix);
+		cr_expect_eq(H[i].bits, result->hitters[i].bits, "Wrong prefix bits");
+		cr_expect_geq(result->hitters[i].count, H[i].count, 
+				"Count should not be underestimated");
+		cr_expect(i == 2 || result->hitters[i].discounted >= H[i].discounted, 
+				"Discounted count should not be underestimated");
+	}
+
+	// The root is counted exactly, discounted by the estimates below it
+	cr_expect_eq(result->hitters[2].count, 10000, "Root should hold the norm");
+	cr_expect_leq(result->hitters[2].discounted, 5000, 
+			"Root discounted count should not be overestimated");
+	cr_expect_geq(result->hitters[2].discounted, 4000, 
+			"Root discounted count should be near its noise");
+
+	heavy_hitter_destroy(hh);
+}
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/ktree64.h"
+#include "sketch/sketch.h"
+
+Test(hh_ktree64, hh_wide_keys, .disabled=0) {
+	// Equal in their low 32 bits, which folding keys would merge
+	uint64_t A[10][2] = {
+		{1, 3543},
+		{0x100000002, 7932},
+		{0x200000002, 8234},
+		{4, 48},
+		{5, 58},
+		{0xFFFFFFFF00000006, 238},
+		{7, 732},
+		{0x8000000000000008, 10038},
+		{0x0000000100000008, 78},
+		{0xFFFFFFFFFFFFFFFF, 78923}
+	};
+
+	uint64_t H[4] = {  // Expected heavy hitters
+		0x100000002, 0x200000002, 0x8000000000000008, 0xFFFFFFFFFFFFFFFF
+	};
+
+	sketch_func_t *fs[2] = { &countMin, &countMedian };
+
+	for (int f = 0; f < 2; f++) {
+		hh_ktree64_params_t params = {
+			.b       = 4,
+			.epsilon = 0.01,
+			.delta   = 0.2,
+			.bits    = 64,
+			.phi     = 0.05,
+			.gran    = 8,
+			.exact   = 1,
+			.f       = fs[f],
+		};
+		heavy_hitter_params_t p = {
+			.hash   = &multiplyShift,
+			.params = &params,
+			.f      = &hh_ktree64,
+		};
+		hh_t *hh = heavy_hitter_create(&p);
+
+		for (int i = 0; i < 10; i++) {
+			heavy_hitter_update64(hh, A[i][0], A[i][1]);
+		}
+
+		heavy_hitter64_t *result = heavy_hitter_query64(hh);
+
+		cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", 
+				result->count);
+
+		for (uint32_t i = 0; i < result->count; i++) {
+			cr_expect_eq(
+					H[i], 
+					result->hitters[i], 
+					"Expected %"PRIx64" to be next heavy hitter got: %"PRIx64, 
+					H[i], 
+					result->hitters[i]
+			);
+		}
+
+		heavy_hitter_destroy(hh);
+	}
+}
+
+Test(hh_ktree64, hh_granularity64, .disabled=0) {
+	uint8_t grans[KTREE64_LAYERS];
+	uint8_t logm, bits = 0;
+
+	hh_ktree64_params_t params = {
+		.bits    = 64,
+		.phi     = 0.05,
+		.gran    = 1,
+	};
+
+	logm = hh_ktree64_granularity(&params, grans);
+
+	cr_assert_eq(logm, 64, "Layers (%d) should be 64", logm);
+
+	params.gran = 0;
+	logm        = hh_ktree64_granularity(&params, grans);
+
+	for (uint8_t i = 0; i < logm; i++) {
+		bits += grans[i];
+	}
+
+	cr_expect_eq(bits, 64, "Layers should span 64 bits, not %d", bits);
+}
+
+// Keys of 32 bits are not supported
+Test(hh_ktree64, hh_narrow_update, .exit_code=EXIT_FAILURE) {
+	hh_ktree64_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.bits    = 64,
+		.phi     = 0.05,
+		.gran    = 8,
+		.exact   = 1,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_ktree64,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	heavy_hitter_update(hh, 1, 1);
+	heavy_hitter_destroy(hh);
+}
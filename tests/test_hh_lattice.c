@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/lattice.h"
+
+Test(hh_lattice, hh_pairs, .disabled=0) {
+	// Flows of 10.1.x.x to 192.168.x.x and of 10.2.x.x to many destinations
+	uint32_t src, dst;
+	uint32_t i;
+
+	hh_lattice_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.gran    = 8,
+		.exact   = 16,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+	};
+	hh_lattice_t *hh = hh_lattice_create(&p);
+
+	cr_assert(hh->w && !(hh->w & (hh->w - 1)),
+			"Width (%"PRIu32") should be a power of two", hh->w);
+
+	for (i = 0; i < 10000; i++) {
+		src = 0x0A010000 | (i & 0xFFFF);
+		dst = 0xC0A80000 | ((i*7919) & 0xFFFF);
+		hh_lattice_update(hh, src, dst, 1);
+
+		src = 0x0A020000 | (i & 0xFFFF);
+		dst = i*2654435761u;
+		hh_lattice_update(hh, src, dst, 1);
+	}
+
+	for (i = 0; i < 1000; i++) {
+		hh_lattice_update(hh, xuni_rand()*UINT32_MAX, xuni_rand()*UINT32_MAX,
+				1);
+	}
+	hh_lattice_update(hh, 0x01020304, 0x05060708, 5000);
+
+	heavy_hitter_pairs_t *result = hh_lattice_query(hh, 16, 16, 0.25);
+
+	cr_assert_eq(result->count, 1, "Heavy pairs (%d) should be 1",
+			result->count);
+	cr_expect_eq(result->hitters[0].src, 0x0A01, "Expected source 10.1");
+	cr_expect_eq(result->hitters[0].dst, 0xC0A8, "Expected destination "
+			"192.168");
+	cr_expect_geq(result->hitters[0].count, 10000, "Underestimated pair");
+
+	// Exactly counted node
+	result = hh_lattice_query(hh, 8, 0, 0.25);
+
+	cr_assert_eq(result->count, 1, "Heavy sources (%d) should be 1",
+			result->count);
+	cr_expect_eq(result->hitters[0].src, 0x0A, "Expected source 10");
+	cr_expect_eq(result->hitters[0].dst, 0, "Expected any destination");
+	cr_expect_geq(result->hitters[0].count, 20000, "Miscounted source");
+
+	result = hh_lattice_query(hh, 32, 32, 0.1);
+
+	cr_assert_eq(result->count, 1, "Heavy flows (%d) should be 1",
+			result->count);
+	cr_expect_eq(result->hitters[0].src, 0x01020304, "Expected 1.2.3.4");
+	cr_expect_eq(result->hitters[0].dst, 0x05060708, "Expected 5.6.7.8");
+	cr_expect_geq(hh_lattice_point(hh, 32, 32, 0x01020304, 0x05060708), 5000,
+			"Underestimated flow");
+
+	hh_lattice_destroy(hh);
+}
@@ -11,6 +11,8 @@
 #include "hh/sketch.h"
 #include "sketch/sketch.h"
 
+#include "hh_fixture.h"
+
 Test(hh_sketch, hh_top_only_median, .disabled=0) {
 	uint32_t A[10][2] = {
 		{1, 3543},
@@ -201,3 +203,30 @@ Test(hh_sketch, hh_top_and_bottom_close_non_hh_median, .disabled=0) {
 	alias_free(a);
 	heavy_hitter_destroy(hh);
 }
+
+Test(hh_sketch, hh_thresholds_median, .disabled=0) {
+	hh_sketch_params_t params = {
+		.b       = 6,
+		.epsilon = 0.04,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMedian,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->top_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+
+	// The error of the median holds either way
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
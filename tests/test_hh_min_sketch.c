@@ -11,6 +11,8 @@
 #include "hh/sketch.h"
 #include "sketch/sketch.h"
 
+#include "hh_fixture.h"
+
 Test(hh_sketch, hh_top_only_min, .disabled=0) {
 	uint32_t A[10][2] = {
 		{1, 3543},
@@ -201,3 +203,387 @@ Test(hh_sketch, hh_top_and_bottom_close_non_hh_min, .disabled=0) {
 	heavy_hitter_destroy(hh);
 	alias_free(a);
 }
+
+Test(hh_sketch, hh_topk_min, .disabled=0) {
+	hh_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->top_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_topk(heavy_hitter_topk(hh, 3));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sketch, hh_thresholds_min, .disabled=0) {
+	hh_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->top_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+static void hh_sketch_count_crossing(void *arg, const uint32_t idx, 
+		const int64_t est) {
+	(void) idx;
+	(void) est;
+	(*(uint32_t *)arg)++;
+}
+
+Test(hh_sketch, hh_incremental_min, .disabled=0) {
+	uint32_t G[3] = {  // Expected heavy hitters after the first key becomes heavy
+		hh_fixture[0][0], 0xC5000008, 0xFE000147
+	};
+
+	uint32_t crossings = 0;
+
+	hh_sketch_params_t params = {
+		.b           = 2,
+		.epsilon     = 0.01,
+		.delta       = 0.2,
+		.m           = UINT32_MAX,
+		.phi         = 0.05,
+		.exact       = 4, // Sketch the leaves
+		.incremental = true,
+		.crossing    = hh_sketch_count_crossing,
+		.arg         = &crossings,
+		.f           = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	hh_fixture_update(hh);
+
+	// The first key and the 4 heavy ones were above the threshold right after
+	// their update
+	cr_expect_eq(crossings, 5, "Crossings (%d) should be 5", crossings);
+
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_update(hh, hh_fixture[0][0], 80000);
+
+	cr_expect_eq(crossings, 6, "Crossings (%d) should be 6", crossings);
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 3, "Heavy hitters (%d) should be 3", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(G[i], result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				G[i], result->hitters[i]);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sketch, hh_colocate_min, .disabled=0) {
+	double hh_mass   = 0.40;
+	uint32_t m       = pow(2, 20);
+
+	hh_sketch_params_t params = {
+		.b        = 2,
+		.epsilon  = (double)1/64,
+		.delta    = 0.2,
+		.m        = m,
+		.phi      = 0.05,
+		.exact    = 4,
+		.colocate = true,
+		.f        = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+
+	hh_t *hh = heavy_hitter_create(&p);
+	double *x       = xmalloc( m*sizeof(double) );
+
+	for (uint32_t i = 0; i < m; i++) {
+		x[i] = (1-hh_mass)/(m-4);
+	}
+
+	/**
+	 * 4 heavy hitters, two of them siblings
+	 */
+	x[134]     = 0.10;
+	x[374298]  = 0.10;
+	x[374299]  = 0.10;
+	x[1000000] = 0.10;
+
+	alias_t * a = alias_preprocess(m, x);
+
+	for (uint32_t i = 0; i < pow(2, 22); i++) {
+		heavy_hitter_update(hh, alias_draw(a), 1);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", result->count);
+
+	uint32_t H[4] = {  // Expected heavy hitters
+		134, 374298, 374299, 1000000
+	};
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	heavy_hitter_destroy(hh);
+	alias_free(a);
+	free(x);
+}
+
+Test(hh_sketch, hh_layer_sizes_min, .disabled=0) {
+	uint32_t A[10][2] = {
+		{1, 3543},
+		{2, 7932},
+		{3, 8234},
+		{4, 48},
+		{5, 58},
+		{6, 238},
+		{7, 732},
+		{8, 10038},
+		{9, 78},
+		{327, 78923}
+	};
+
+	uint32_t H[4] = {  // Expected heavy hitters
+		2, 3, 8, 327
+	};
+
+	double deltas[9] = { 0.2, 0.2, 0.2, 0.2, 0.2, 0.5, 0.5, 0.5, 0.2 };
+
+	hh_sketch_params_t params = {
+		.b        = 2,
+		.epsilon  = 0.01,
+		.delta    = 0.2,
+		.m        = pow(2, 9),
+		.phi      = 0.05,
+		.exact    = 2,
+		.deltas   = deltas,
+		.autosize = true,
+		.f        = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_sketch_t *tree = hh->hh;
+
+	// Layer 2 has 8 prefixes while the leaves keep the width of epsilon
+	cr_expect_lt(sketch_width(tree->tree[0]->sketch), 
+			sketch_width(tree->tree[6]->sketch), "Inner layer should be narrower");
+	cr_expect_lt(sketch_depth(tree->tree[3]->sketch), 
+			sketch_depth(tree->tree[6]->sketch), "Layer 5 should be shallower");
+
+	for (int i = 0; i < 10; i++) {
+		heavy_hitter_update(hh, A[i][0], A[i][1]);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sketch, hh_autosize_sketched_min, .disabled=0) {
+	hh_sketch_params_t params = {
+		.b        = 2,
+		.epsilon  = 0.01,
+		.delta    = 0.2,
+		.m        = UINT32_MAX,
+		.phi      = 0.05,
+		.autosize = true,
+		.f        = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_sketch_t *tree = hh->hh;
+	const uint8_t leaf = tree->logm - tree->top_cnt - 1;
+
+	cr_assert(tree->top_cnt < tree->logm - 1, "Expected sketched inner layers");
+
+	// The inner layers only prune the walk, at epsilon phi/2
+	cr_expect_lt(sketch_width(tree->tree[leaf-1]->sketch), 
+			sketch_width(tree->tree[leaf]->sketch), 
+			"Sketched inner layer should be narrower");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sketch, hh_mixed_sketches_min, .disabled=0) {
+	uint32_t A[10][2] = {
+		{1, 3543},
+		{2, 7932},
+		{3, 8234},
+		{4, 48},
+		{5, 58},
+		{6, 238},
+		{7, 732},
+		{8, 10038},
+		{9, 78},
+		{327, 78923}
+	};
+
+	uint32_t H[4] = {  // Expected heavy hitters
+		2, 3, 8, 327
+	};
+
+	sketch_func_t *fs[9] = { 
+		&countMin, &countMin, &countMin, &countMin, &countMin, &countMin, 
+		&countMin, &countMin, &countMinCU
+	};
+
+	hh_sketch_params_t params = {
+		.b        = 2,
+		.epsilon  = 0.01,
+		.delta    = 0.2,
+		.m        = pow(2, 9),
+		.phi      = 0.05,
+		.exact    = 2,
+		.fs       = fs,
+		.f        = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_sketch_t *tree = hh->hh;
+
+	cr_expect_eq(tree->tree[6]->funcs, &countMinCU, 
+			"Leaves should use the conservative update");
+
+	for (int i = 0; i < 10; i++) {
+		heavy_hitter_update(hh, A[i][0], A[i][1]);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sketch, hh_hierarchical_min, .disabled=0) {
+	const uint32_t host = (10 << 24) | 1;        // 10.0.0.1
+	const uint32_t net  = (10 << 24) | (1 << 8); // 10.0.1.0/24
+
+	// No half of the /24 is heavy, and 10.0.0.0/23 is covered by both
+	hhh_t H[2] = {  // Expected hierarchical heavy hitters
+		{ host,     32, 3000, 3000 },
+		{ net >> 8, 24, 1280, 1280 },
+	};
+
+	hh_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	heavy_hitter_update(hh, host, 3000);
+
+	for (uint32_t i = 0; i < 256; i++) {
+		heavy_hitter_update(hh, net | i, 5);
+	}
+
+	heavy_hitter_hhh_t *result = heavy_hitter_query_hhh(hh, 0.2);
+
+	cr_assert_eq(result->count, 2, "Hierarchical heavy hitters (%d) should be 2",
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(H[i].prefix, result->hitters[i].prefix, 
+				"Expected prefix %"PRIx32" got %"PRIx32, H[i].prefix, 
+				result->hitters[i].prefix);
+		cr_expect_eq(H[i].bits, result->hitters[i].bits, "Wrong prefix bits");
+		cr_expect_geq(result->hitters[i].count, H[i].count, 
+				"Count should not be underestimated");
+		cr_expect_geq(result->hitters[i].discounted, H[i].discounted, 
+				"Discounted count should not be underestimated");
+	}
+
+	heavy_hitter_destroy(hh);
+}
@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/ktree.h"
+#include "hh/sample.h"
+#include "sketch/sketch.h"
+
+Test(hh_sample, hh_unweighted, .disabled=0) {
+	uint32_t H[4] = {  // Expected heavy hitters
+		3, 134, 2345, 1000000
+	};
+	heavy_hitter_threshold_t threshold = { .value = 0.05 };
+
+	hh_ktree_params_t params_ktree = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.gran    = 8,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p_ktree = {
+		.hash   = &multiplyShift,
+		.params = &params_ktree,
+		.f      = &hh_ktree,
+	};
+	hh_sample_params_t params = {
+		.p      = 0.1,
+		.engine = &p_ktree,
+	};
+	heavy_hitter_params_t p = {
+		.params = &params,
+		.f      = &hh_sample,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	for (uint32_t i = 0; i < 200000; i++) {
+		heavy_hitter_update(hh, (i % 2 == 0) ? H[(i/2) % 4] : 5000 + i*7919, 1);
+	}
+
+	heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(hh, 
+			&threshold, 1);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", 
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_leq(llabs(result->hitters[i].count - 25000), 
+				result->hitters[i].error, 
+				"Expected 25000 within %"PRId64" got: %"PRId64, 
+				result->hitters[i].error, result->hitters[i].count);
+		cr_expect_gt(result->hitters[i].error, 0, 
+				"Expected the sampling error to be reported");
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sample, hh_weighted, .disabled=0) {
+	uint32_t H[4] = {  // Expected heavy hitters
+		3, 134, 2345, 1000000
+	};
+	heavy_hitter_threshold_t threshold = {
+		.value    = 50000,
+		.absolute = true,
+	};
+
+	hh_ktree_params_t params_ktree = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.gran    = 8,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p_ktree = {
+		.hash   = &multiplyShift,
+		.params = &params_ktree,
+		.f      = &hh_ktree,
+	};
+	hh_sample_params_t params = {
+		.p        = 0.01,
+		.weighted = true,
+		.engine   = &p_ktree,
+	};
+	heavy_hitter_params_t p = {
+		.params = &params,
+		.f      = &hh_sample,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	// Few large counts of the heavy hitters among many small ones
+	for (uint32_t i = 0; i < 100000; i++) {
+		heavy_hitter_update(hh, (i % 100 == 0) ? H[(i/100) % 4] : 
+				5000 + i*7919, (i % 100 == 0) ? 400 : 1);
+	}
+
+	heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(hh, 
+			&threshold, 1);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", 
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_leq(llabs(result->hitters[i].count - 100000), 
+				result->hitters[i].error, 
+				"Expected 100000 within %"PRId64" got: %"PRId64, 
+				result->hitters[i].error, result->hitters[i].count);
+	}
+
+	heavy_hitter_destroy(hh);
+}
+
+// Counts of many units per update, whose kept units are drawn at once
+Test(hh_sample, hh_weighted_large, .disabled=0) {
+	uint32_t H[4] = {  // Expected heavy hitters
+		3, 134, 2345, 1000000
+	};
+	heavy_hitter_threshold_t threshold = {
+		.value    = 5000000,
+		.absolute = true,
+	};
+	double ps[2] = { 0.01, 0.9 };
+
+	for (int j = 0; j < 2; j++) {
+		hh_ktree_params_t params_ktree = {
+			.b       = 4,
+			.epsilon = 0.01,
+			.delta   = 0.2,
+			.m       = UINT32_MAX,
+			.phi     = 0.05,
+			.gran    = 8,
+			.f       = &countMin,
+		};
+		heavy_hitter_params_t p_ktree = {
+			.hash   = &multiplyShift,
+			.params = &params_ktree,
+			.f      = &hh_ktree,
+		};
+		hh_sample_params_t params = {
+			.p        = ps[j],
+			.weighted = true,
+			.engine   = &p_ktree,
+		};
+		heavy_hitter_params_t p = {
+			.params = &params,
+			.f      = &hh_sample,
+		};
+		hh_t *hh = heavy_hitter_create(&p);
+
+		for (uint32_t i = 0; i < 10000; i++) {
+			heavy_hitter_update(hh, (i % 25 == 0) ? H[(i/25) % 4] : 
+					5000 + i*7919, (i % 25 == 0) ? 100000 : 1000);
+		}
+
+		heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(hh, 
+				&threshold, 1);
+
+		cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", 
+				result->count);
+
+		for (uint32_t i = 0; i < result->count; i++) {
+			cr_expect_leq(llabs(result->hitters[i].count - 10000000), 
+					result->hitters[i].error, 
+					"Expected 10000000 within %"PRId64" got: %"PRId64, 
+					result->hitters[i].error, result->hitters[i].count);
+		}
+
+		heavy_hitter_destroy(hh);
+	}
+}
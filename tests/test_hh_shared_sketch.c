@@ -0,0 +1,187 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/alias.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/shared_sketch.h"
+
+#include "hh_fixture.h"
+
+Test(hh_shared_sketch, hh_top_only, .disabled=0) {
+	hh_shared_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.exact   = 2,
+		.share   = 0.5,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_shared_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_shared_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->top_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_query(heavy_hitter_query(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_shared_sketch, hh_top_and_bottom, .disabled=0) {
+	double hh_mass   = 0.70;
+	uint32_t m       = pow(2, 20);
+
+	hh_shared_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = (double)1/64,
+		.delta   = 0.2,
+		.m       = m,
+		.phi     = 0.05,
+		.exact   = 2,
+		.share   = 0.5,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_shared_sketch,
+	};
+
+	hh_t *hh = heavy_hitter_create(&p);
+	double *x       = xmalloc( m*sizeof(double) );
+
+	for (uint32_t i = 0; i < m; i++) {
+		x[i] = (1-hh_mass)/(m-7);
+	}
+
+	/**
+	 * 7 heavy hitters
+	 */
+	x[134]     = 0.10;
+	x[2345]    = 0.10;
+	x[374298]  = 0.10;
+	x[374299]  = 0.10;
+	x[1000000] = 0.10;
+	x[38474]   = 0.10;
+	x[3]       = 0.10;
+
+	alias_t * a = alias_preprocess(m, x);
+
+	uint32_t idx;
+	for (uint32_t i = 0; i < pow(2, 23); i++) {
+		idx = alias_draw(a);
+		heavy_hitter_update(hh, idx, 1);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 7, "Heavy hitters (%d) should be 7", result->count);
+
+	uint32_t H[7] = {  // Expected heavy hitters
+		3, 134, 2345, 38474, 374298, 374299, 1000000
+	};
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(
+				H[i], 
+				result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], 
+				result->hitters[i]
+		);
+	}
+
+	heavy_hitter_destroy(hh);
+	alias_free(a);
+}
+
+Test(hh_shared_sketch, hh_topk, .disabled=0) {
+	hh_shared_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.exact   = 2,
+		.share   = 0.5,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_shared_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_shared_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->top_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_topk(heavy_hitter_topk(hh, 3));
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_shared_sketch, hh_thresholds, .disabled=0) {
+	hh_shared_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.exact   = 2,
+		.share   = 0.5,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &carterWegman,
+		.params = &params,
+		.f      = &hh_shared_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_shared_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->top_cnt < tree->logm, "Expected sketched layers");
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
+
+// The shared table of 30 layers at share 0.5 is rounded up to a power of two
+Test(hh_shared_sketch, hh_width_power_of_two, .disabled=0) {
+	hh_shared_sketch_params_t params = {
+		.b       = 2,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.exact   = 2,
+		.share   = 0.5,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_shared_sketch,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_shared_sketch_t *tree = hh->hh;
+
+	cr_assert(tree->w && !(tree->w & (tree->w - 1)),
+			"Width (%"PRIu32") should be a power of two", tree->w);
+	cr_expect_leq(tree->epsilon, params.epsilon/params.share,
+			"Epsilon (%f) should not grow by rounding", tree->epsilon);
+
+	hh_fixture_update(hh);
+	hh_fixture_expect_thresholds(hh_fixture_query_thresholds(hh));
+
+	heavy_hitter_destroy(hh);
+}
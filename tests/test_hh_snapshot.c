@@ -0,0 +1,176 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/cgt.h"
+#include "hh/ktree.h"
+#include "hh/sparse.h"
+#include "hh/window.h"
+#include "sketch/sketch.h"
+
+#define SNAPSHOT_PATH "test_hh_snapshot.snap"
+
+static void stream(hh_t *hh, hh_t *restored, const uint32_t from,
+		const uint32_t to) {
+	uint32_t H[4] = {
+		3, 134, 2345, 1000000
+	};
+
+	for (uint32_t i = from; i < to; i++) {
+		const uint32_t idx = (i % 2 == 0) ? H[(i/2) % 4] : 5000 + i*7919;
+
+		heavy_hitter_update(hh, idx, 1);
+
+		if ( restored != NULL ) {
+			heavy_hitter_update(restored, idx, 1);
+		}
+	}
+}
+
+// The restored engine answers as the saved one
+static void expect_same(hh_t *hh, hh_t *restored, const double phi) {
+	const heavy_hitter_threshold_t threshold = { .value = phi };
+	heavy_hitter_estimates_t *expected = heavy_hitter_query_thresholds(hh,
+			&threshold, 1);
+	uint32_t count = expected->count;
+	hitter_t hitters[count+1];
+
+	memcpy(hitters, expected->hitters, count*sizeof(hitter_t));
+
+	heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(restored,
+			&threshold, 1);
+
+	cr_assert_eq(result->count, count, "Heavy hitters (%d) should be %d",
+			result->count, count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		cr_expect_eq(result->hitters[i].id, hitters[i].id,
+				"Expected %d got: %d", hitters[i].id, result->hitters[i].id);
+		cr_expect_eq(result->hitters[i].count, hitters[i].count,
+				"Expected %"PRId64" got: %"PRId64, hitters[i].count,
+				result->hitters[i].count);
+	}
+}
+
+Test(hh_snapshot, hh_ktree_restore, .disabled=0) {
+	hh_ktree_params_t params = {
+		.b           = 4,
+		.epsilon     = 0.01,
+		.delta       = 0.2,
+		.m           = UINT32_MAX,
+		.phi         = 0.05,
+		.gran        = 8,
+		.incremental = true,
+		.f           = &countMin,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_ktree,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	stream(hh, NULL, 0, 100000);
+	heavy_hitter_save(hh, SNAPSHOT_PATH);
+
+	hh_t *restored = heavy_hitter_load(&p, SNAPSHOT_PATH);
+
+	expect_same(hh, restored, 0.05);
+
+	// Both go on from the same state
+	stream(hh, restored, 100000, 200000);
+	expect_same(hh, restored, 0.05);
+
+	heavy_hitter_destroy(restored);
+	heavy_hitter_destroy(hh);
+	remove(SNAPSHOT_PATH);
+}
+
+Test(hh_snapshot, hh_sparse_restore, .disabled=0) {
+	hh_cgt_params_t params_cgt = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+	};
+	heavy_hitter_params_t p_cgt = {
+		.hash   = &multiplyShift,
+		.params = &params_cgt,
+		.f      = &hh_cgt,
+	};
+	hh_sparse_params_t params = {
+		.phi    = 0.05,
+		.limit  = 1000,
+		.engine = &p_cgt,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_sparse,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	// Still exact
+	stream(hh, NULL, 0, 1000);
+	heavy_hitter_save(hh, SNAPSHOT_PATH);
+
+	hh_t *restored = heavy_hitter_load(&p, SNAPSHOT_PATH);
+
+	expect_same(hh, restored, 0.05);
+	heavy_hitter_destroy(restored);
+
+	// Migrated to the engine, whose seeds are restored as well
+	stream(hh, NULL, 1000, 100000);
+	heavy_hitter_save(hh, SNAPSHOT_PATH);
+
+	restored = heavy_hitter_load(&p, SNAPSHOT_PATH);
+
+	expect_same(hh, restored, 0.05);
+
+	stream(hh, restored, 100000, 200000);
+	expect_same(hh, restored, 0.05);
+
+	heavy_hitter_destroy(restored);
+	heavy_hitter_destroy(hh);
+	remove(SNAPSHOT_PATH);
+}
+
+Test(hh_snapshot, hh_window_restore, .disabled=0) {
+	hh_window_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.epochs  = 4,
+		.updates = 30000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_window,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	// Saved while the spare slot is being zeroed
+	stream(hh, NULL, 0, 150100);
+	heavy_hitter_save(hh, SNAPSHOT_PATH);
+
+	hh_t *restored = heavy_hitter_load(&p, SNAPSHOT_PATH);
+
+	expect_same(hh, restored, 0.05);
+
+	stream(hh, restored, 150100, 250000);
+	expect_same(hh, restored, 0.05);
+
+	heavy_hitter_destroy(restored);
+	heavy_hitter_destroy(hh);
+	remove(SNAPSHOT_PATH);
+}
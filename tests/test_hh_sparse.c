@@ -0,0 +1,157 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/ktree.h"
+#include "hh/sparse.h"
+#include "sketch/sketch.h"
+
+Test(hh_sparse, hh_exact_while_small, .disabled=0) {
+	uint32_t A[10][2] = {
+		{1, 3543},
+		{2, 7932},
+		{3, 8234},
+		{4, 48},
+		{5, 58},
+		{6, 238},
+		{7, 732},
+		{8, 10038},
+		{9, 78},
+		{327, 78923}
+	};
+
+	uint32_t H[4][2] = {  // Expected heavy hitters in order of decreasing count
+		{327, 78923},
+		{8, 10038},
+		{3, 8234},
+		{2, 7932}
+	};
+
+	heavy_hitter_threshold_t threshold = { .value = 0.05 };
+
+	hh_ktree_params_t params_ktree = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p_ktree = {
+		.hash   = &multiplyShift,
+		.params = &params_ktree,
+		.f      = &hh_ktree,
+	};
+	hh_sparse_params_t params = {
+		.phi     = 0.05,
+		.engine  = &p_ktree,
+	};
+	heavy_hitter_params_t p = {
+		.params = &params,
+		.f      = &hh_sparse,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	for (int i = 0; i < 10; i++) {
+		heavy_hitter_update(hh, A[i][0], A[i][1]);
+	}
+
+	cr_assert_null(((hh_sparse_t *)hh->hh)->engine, 
+			"Expected no engine for few keys");
+
+	heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(hh, 
+			&threshold, 1);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", 
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(H[i][0], result->hitters[i].id, 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i][0], result->hitters[i].id);
+		cr_expect_eq(H[i][1], result->hitters[i].count, 
+				"Expected exact count %"PRIu32" got: %"PRId64, 
+				H[i][1], result->hitters[i].count);
+	}
+
+	heavy_hitter_t *top = heavy_hitter_topk(hh, 2);
+
+	cr_assert_eq(top->count, 2, "Top-k (%d) should be 2", top->count);
+	cr_expect_eq(top->hitters[0], 327, "Expected 327 first");
+	cr_expect_eq(top->hitters[1], 8, "Expected 8 second");
+
+	// An absolute threshold of 1 is a count, not the whole norm
+	threshold.value    = 1;
+	threshold.absolute = true;
+	result             = heavy_hitter_query_thresholds(hh, &threshold, 1);
+
+	cr_expect_eq(result->count, 10, "Hitters above 1 (%d) should be 10", 
+			result->count);
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_sparse, hh_migrate, .disabled=0) {
+	uint32_t H[4] = {  // Expected heavy hitters
+		3, 134, 2345, 1000000
+	};
+
+	hh_ktree_params_t params_ktree = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.05,
+		.gran    = 8,
+		.f       = &countMin,
+	};
+	heavy_hitter_params_t p_ktree = {
+		.hash   = &multiplyShift,
+		.params = &params_ktree,
+		.f      = &hh_ktree,
+	};
+	hh_sparse_params_t params = {
+		.phi     = 0.05,
+		.limit   = 100,
+		.engine  = &p_ktree,
+	};
+	heavy_hitter_params_t p = {
+		.params = &params,
+		.f      = &hh_sparse,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+
+	// Heavy hitters before and after the migration
+	for (uint32_t i = 0; i < 4; i++) {
+		heavy_hitter_update(hh, H[i], 1000);
+	}
+
+	for (uint32_t i = 0; i < 10000; i++) {
+		heavy_hitter_update(hh, 5000 + i*7919, 1);
+	}
+
+	cr_assert_not_null(((hh_sparse_t *)hh->hh)->engine, 
+			"Expected the engine beyond the limit");
+
+	for (uint32_t i = 0; i < 4; i++) {
+		heavy_hitter_update(hh, H[i], 1000);
+	}
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 4, "Heavy hitters (%d) should be 4", 
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_eq(H[i], result->hitters[i], 
+				"Expected %"PRIu32" to be next heavy hitter got: %"PRIu32, 
+				H[i], result->hitters[i]);
+	}
+
+	heavy_hitter_destroy(hh);
+}
@@ -0,0 +1,63 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/spread.h"
+
+Test(hh_spread, hh_superspreader, .disabled=0) {
+	uint32_t i, k;
+	uint8_t exact[2] = { 0, 16 };
+
+	for (int e = 0; e < 2; e++) {
+		hh_spread_params_t params = {
+			.b       = 4,
+			.epsilon = 0.01,
+			.delta   = 0.2,
+			.m       = UINT16_MAX,
+			.phi     = 0.1,
+			.exact   = exact[e],
+		};
+		heavy_hitter_params_t p = {
+			.hash   = &multiplyShift,
+			.params = &params,
+		};
+		hh_spread_t *hh = hh_spread_create(&p);
+
+		// A scan of 2000 destinations
+		for (i = 0; i < 2000; i++) {
+			hh_spread_update(hh, 4242, 0x0A000000 + i);
+		}
+
+		// Many packets to few destinations
+		for (i = 0; i < 20000; i++) {
+			hh_spread_update(hh, 17, 0x0A000000 + (i % 5));
+		}
+
+		for (i = 0; i < 500; i++) {
+			for (k = 0; k < 3; k++) {
+				hh_spread_update(hh, 20000 + i, 0xC0A80000 + k);
+			}
+		}
+
+		heavy_hitter_estimates_t *result = hh_spread_query(hh);
+
+		cr_assert_eq(result->count, 1, "Superspreaders (%d) should be 1",
+				result->count);
+		cr_expect_eq(result->hitters[0].id, 4242, "Expected source 4242 got "
+				"%"PRIu32, result->hitters[0].id);
+		cr_expect(fabs(result->hitters[0].count - 2000.) < 500., 
+				"Distinct destinations %"PRId64" should be about 2000", 
+				result->hitters[0].count);
+		cr_expect(fabs(hh_spread_point(hh, 17) - 5.) < 2., 
+				"Distinct destinations of a heavy sender should be about 5");
+		cr_expect(fabs(hh_spread_total(hh) - 3505.) < 800., 
+				"Distinct pairs should be about 3505");
+
+		hh_spread_destroy(hh);
+	}
+}
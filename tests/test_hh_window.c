@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <criterion/criterion.h>
+
+#include "util/hash.h"
+#include "util/xutil.h"
+
+#include "hh/hh.h"
+#include "hh/window.h"
+
+Test(hh_window, hh_slide_by_updates, .disabled=0) {
+	hh_window_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.2,
+		.epochs  = 2,
+		.updates = 1000,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_window,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_window_t *w = (hh_window_t *)hh->hh;
+
+	// Key 7 is heavy in the first epoch, key 1000000 in the next two
+	for (uint32_t i = 0; i < 3000; i++) {
+		heavy_hitter_update(hh, (i % 2 == 0) ? 5000 + i*7919 : 
+				((i < 1000) ? 7 : 1000000), 1);
+
+		if ( i == 1999 ) {
+			cr_expect_gt(w->dirty, 0, "Expected the expired epoch to be zeroed "
+					"lazily");
+		}
+	}
+
+	cr_expect_eq(hh_window_norm(w), 1000, "Window norm (%"PRIu64") should be "
+			"1000", hh_window_norm(w));
+
+	heavy_hitter_t *result = heavy_hitter_query(hh);
+
+	cr_assert_eq(result->count, 1, "Heavy hitters (%d) should be 1", 
+			result->count);
+	cr_expect_eq(result->hitters[0], 1000000, 
+			"Expected 1000000 got: %"PRIu32, result->hitters[0]);
+	cr_expect_geq(hh_window_point(w, 1000000), 500, 
+			"Estimate should not be below the count");
+
+	// The epoch of key 7 is reused by the current epoch
+	for (uint32_t i = 0; i < 500; i++) {
+		heavy_hitter_update(hh, 5000 + i*7919, 1);
+	}
+
+	cr_expect_eq(w->dirty, 0, "Expected the spare zeroed by the updates");
+	cr_expect_leq(hh_window_point(w, 7), 10, 
+			"Key 7 should have left the window");
+
+	heavy_hitter_destroy(hh);
+}
+
+Test(hh_window, hh_slide_by_time, .disabled=0) {
+	heavy_hitter_threshold_t threshold = { .value = 0.2 };
+
+	hh_window_params_t params = {
+		.b       = 4,
+		.epsilon = 0.01,
+		.delta   = 0.2,
+		.m       = UINT32_MAX,
+		.phi     = 0.2,
+		.epochs  = 3,
+		.span    = 1.0,
+	};
+	heavy_hitter_params_t p = {
+		.hash   = &multiplyShift,
+		.params = &params,
+		.f      = &hh_window,
+	};
+	hh_t *hh = heavy_hitter_create(&p);
+	hh_window_t *w = (hh_window_t *)hh->hh;
+
+	hh_window_time(w, 0.0);
+
+	for (uint32_t t = 0; t < 3; t++) {
+		hh_window_time(w, t + 0.5);
+
+		for (uint32_t i = 0; i < 1000; i++) {
+			heavy_hitter_update(hh, (i % 2 == 0) ? 5000 + i*7919 : 3 + t, 1);
+		}
+	}
+
+	heavy_hitter_estimates_t *result = heavy_hitter_query_thresholds(hh, 
+			&threshold, 1);
+
+	cr_expect_eq(result->count, 0, "Heavy hitters (%d) should be 0", 
+			result->count);
+
+	threshold.value = 0.1;
+	result          = heavy_hitter_query_thresholds(hh, &threshold, 1);
+
+	cr_expect_eq(result->count, 3, "Heavy hitters (%d) should be 3", 
+			result->count);
+
+	for (uint32_t i = 0; i < result->count; i++) {
+		cr_expect_geq(result->hitters[i].count, 500, 
+				"Estimate should not be below the count");
+	}
+
+	// A gap longer than the window leaves it empty
+	hh_window_time(w, 100.0);
+
+	cr_expect_eq(hh_window_norm(w), 0, "Expected an empty window");
+
+	result = heavy_hitter_query_thresholds(hh, &threshold, 1);
+
+	cr_expect_eq(result->count, 0, "Heavy hitters (%d) should be 0", 
+			result->count);
+
+	heavy_hitter_destroy(hh);
+}
@@ -0,0 +1,88 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <criterion/criterion.h>
+
+#include "util/layout.h"
+#include "util/xutil.h"
+
+static void layout_check_bijection(const uint8_t g, const uint8_t depths) {
+	uint8_t gran[depths];
+	uint64_t i, x, nodes;
+	uint8_t depth;
+	bool *used;
+
+	memset(gran, g, depths);
+
+	layout_t *layout = layout_create(gran, depths);
+	used             = xmalloc( layout->size * sizeof(bool) );
+
+	memset(used, '\0', layout->size * sizeof(bool));
+
+	// The root is not stored
+	for (depth = 1, nodes = 1 << g; depth < depths; depth++, nodes <<= g) {
+		for (x = 0; x < nodes; x++) {
+			i = layout_index(layout, depth, x);
+
+			cr_assert_lt(i, layout->size, "Index %"PRIu64" out of bounds", i);
+			cr_assert_not(used[i], "Index %"PRIu64" of node %"PRIu64
+					" at depth %d is used twice", i, x, depth);
+
+			used[i] = true;
+		}
+	}
+
+	free(used);
+	layout_destroy(layout);
+}
+
+Test(layout, bijection_binary, .disabled=0) {
+	layout_check_bijection(1, 13);
+}
+
+Test(layout, bijection_four, .disabled=0) {
+	layout_check_bijection(2, 7);
+}
+
+Test(layout, bijection_sixteen, .disabled=0) {
+	layout_check_bijection(4, 4);
+}
+
+Test(layout, four_size, .disabled=0) {
+	uint8_t gran[5];
+
+	memset(gran, 2, 5);
+
+	layout_t *layout = layout_create(gran, 5);
+
+	// Blocks of a 4-ary node and its children padded from 5 to 8 counters, 
+	// rooted at the 4 nodes of depth 1 and the 64 of depth 3
+	cr_assert_eq(layout->size, 8*(4+64), "Size (%"PRIu64") should be %d", 
+			layout->size, 8*(4+64));
+
+	layout_destroy(layout);
+}
+
+Test(layout, binary_path_lines, .disabled=0) {
+	uint8_t gran[21];
+	uint8_t depth, lines = 0;
+	uint64_t line, last = UINT64_MAX;
+	const uint64_t x = 0xABCDE;
+
+	memset(gran, 1, 21);
+
+	layout_t *layout = layout_create(gran, 21);
+
+	// Three depths of a binary tree share a line
+	for (depth = 1; depth < 21; depth++) {
+		line = layout_index(layout, depth, x >> (20 - depth)) / LAYOUT_LINE;
+		if ( line != last ) {
+			lines++;
+			last = line;
+		}
+	}
+
+	cr_assert_eq(lines, 7, "The path should touch 7 lines, got %d", lines);
+
+	layout_destroy(layout);
+}
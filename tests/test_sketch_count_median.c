@@ -32,6 +32,16 @@ Test(count_median_sketch, expected_w_16, .disabled=0) {
 	sketch_destroy(s);
 }
 
+Test(count_median_sketch, expected_w_pow2, .disabled=0) {
+	sketch_t *s = sketch_create(&countMedian, &multiplyShift, 6, 0.25, 0.2);
+	count_median_t *cm = s->sketch;
+
+	cr_assert_eq(cm->size.w, 128, "Wrong w value, expected %d got %"PRIu32, 
+			128, cm->size.w);
+
+	sketch_destroy(s);
+}
+
 Test(count_median_sketch, update_point, .disabled=0) {
 	uint8_t b         = 6;
 	double  epsilon   = 0.30;
@@ -137,6 +147,70 @@ Test(count_median_sketch, update_point_3, .disabled=0) {
 	sketch_destroy(s);
 }
 
+Test(count_median_sketch, points_equal_point, .disabled=0) {
+	uint32_t i[40];
+	int64_t  est[40];
+
+	sketch_t *s = sketch_create(&countMedian, &multiplyShift, 4, 0.25, 0.2);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		i[j] = j*7919;
+		sketch_update(s, i[j], j+1);
+	}
+
+	sketch_points(s, i, est, 40);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_eq(est[j], sketch_point(s, i[j]), 
+				"Batched estimate (%"PRId64") should equal point estimate", 
+				est[j]);
+	}
+
+	sketch_destroy(s);
+}
+
+Test(count_median_sketch, update_point_equals_point, .disabled=0) {
+	int64_t est;
+
+	sketch_t *s = sketch_create(&countMedian, &multiplyShift, 4, 0.25, 0.2);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		est = sketch_update_point(s, j*7919, j+1);
+
+		cr_expect_eq(est, sketch_point(s, j*7919), 
+				"Updated estimate (%"PRId64") should equal point estimate", 
+				est);
+	}
+
+	sketch_destroy(s);
+}
+
+Test(count_median_sketch, point_diff, .disabled=0) {
+	count_median_t *a = count_median_create(&multiplyShift, 4, 0.25, 0.2);
+	count_median_t *b = count_median_copy_seeds(a);
+	count_median_t *c = count_median_copy_seeds(a);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		count_median_update(a, j*7919, 2*j+1);
+		count_median_update(b, j*7919, j);
+		count_median_update(c, j*7919, j+1);
+	}
+
+	// The sketch of the difference, by linearity
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_eq(count_median_point_diff(a, b, j*7919), 
+				count_median_point(c, j*7919), 
+				"Difference should estimate as the sketch of the difference");
+	}
+
+	count_median_clear(a);
+	cr_expect_eq(count_median_point(a, 7919), 0, "Cleared sketch is empty");
+
+	count_median_destroy(a);
+	count_median_destroy(b);
+	count_median_destroy(c);
+}
+
 Test(count_median_sketch, should_allocate_internals, .disabled=0) {
 	sketch_t *s        = sketch_create(&countMedian, &carterWegman, 3, 0.5, 0.2);
 	count_median_t *cm = s->sketch;
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
 #include <criterion/criterion.h>
 
 #include "util/hash.h"
@@ -24,6 +26,16 @@ Test(count_min_sketch, expected_w_16, .disabled=0) {
 	sketch_destroy(s);
 }
 
+Test(count_min_sketch, expected_w_pow2, .disabled=0) {
+	sketch_t *s = sketch_create(&countMin, &multiplyShift, 4, 0.01, 0.2);
+	count_min_t *cm = s->sketch;
+
+	cr_assert_eq(cm->size.w, 512, "Wrong w value, expected %d got %"PRIu32, 
+			512, cm->size.w);
+
+	sketch_destroy(s);
+}
+
 Test(count_min_sketch, update_point, .disabled=0) {
 	sketch_t *s = sketch_create(&countMin, &carterWegman, 2, 0.3, 0.2);
 
@@ -157,6 +169,169 @@ Test(count_min_sketch, update_range_naive_1, .disabled=0) {
 	sketch_destroy(s);
 }
 
+Test(count_min_sketch, points_equal_point, .disabled=0) {
+	uint32_t i[40];
+	int64_t  est[40];
+
+	sketch_t *s = sketch_create(&countMin, &multiplyShift, 4, 0.25, 0.2);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		i[j] = j*7919;
+		sketch_update(s, i[j], j+1);
+	}
+
+	sketch_points(s, i, est, 40);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_eq(est[j], sketch_point(s, i[j]), 
+				"Batched estimate (%"PRId64") should equal point estimate", 
+				est[j]);
+	}
+
+	sketch_destroy(s);
+}
+
+Test(count_min_sketch, update_point_equals_point, .disabled=0) {
+	int64_t est;
+
+	sketch_t *s = sketch_create(&countMin, &multiplyShift, 4, 0.25, 0.2);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		est = sketch_update_point(s, j*7919, j+1);
+
+		cr_expect_eq(est, sketch_point(s, j*7919), 
+				"Updated estimate (%"PRId64") should equal point estimate", 
+				est);
+	}
+
+	sketch_destroy(s);
+}
+
+Test(count_min_sketch, siblings_share_block, .disabled=0) {
+	uint32_t h, first;
+	bool     seen[8];
+	uint64_t a = multiplyShift.agen();
+	uint64_t b = multiplyShift.bgen(6);
+
+	for (uint32_t parent = 0; parent < 100; parent++) {
+		memset(seen, 0, sizeof(seen));
+		first = sketch_bucket(multiplyShift.hash, 64, 6, 3, parent*8, a, b);
+
+		for (uint32_t j = 0; j < 8; j++) {
+			h = sketch_bucket(multiplyShift.hash, 64, 6, 3, parent*8+j, a, b);
+
+			cr_expect_eq(h >> 3, first >> 3, 
+					"Child %"PRIu32" of %"PRIu32" should share the block", j, parent);
+			cr_expect(!seen[h & 7], "Siblings should not collide");
+			seen[h & 7] = true;
+		}
+	}
+}
+
+Test(count_min_sketch, siblings_never_underestimate, .disabled=0) {
+	sketch_t *s = sketch_create(&countMin, &multiplyShift, 4, 0.25, 0.2);
+
+	sketch_siblings(s->sketch, 2);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		sketch_update(s, j, j+1);
+	}
+
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_geq(sketch_point(s, j), j+1, 
+				"Estimate of %"PRIu32" should not be below its count", j);
+	}
+
+	sketch_destroy(s);
+}
+
+Test(count_min_sketch, conservative_update, .disabled=0) {
+	int64_t est;
+
+	sketch_t *s = sketch_create(&countMinCU, &multiplyShift, 4, 0.25, 0.2);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		est = sketch_update_point(s, j*7919, j+1);
+
+		cr_expect_eq(est, sketch_point(s, j*7919), 
+				"Updated estimate (%"PRId64") should equal point estimate", 
+				est);
+	}
+
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_geq(sketch_point(s, j*7919), j+1, 
+				"Estimate of %"PRIu32" should not be below its count", j*7919);
+	}
+
+	sketch_destroy(s);
+}
+
+// Conservative updates cannot undo a count
+Test(count_min_sketch, conservative_negative, .exit_code=EXIT_FAILURE) {
+	sketch_t *s = sketch_create(&countMinCU, &multiplyShift, 4, 0.25, 0.2);
+
+	sketch_update(s, 7919, 5);
+	sketch_update(s, 7919, -5);
+
+	sketch_destroy(s);
+}
+
+Test(count_min_sketch, wide_keys, .disabled=0) {
+	uint64_t x;
+	int64_t est[40];
+	uint64_t keys[40];
+
+	sketch_t *s = sketch_create(&countMin, &carterWegman, 4, 0.01, 0.2);
+
+	// Keys equal in their low 32 bits keep counts of their own
+	for (uint32_t j = 0; j < 40; j++) {
+		x       = ((uint64_t)j << 32) | 0x5EED;
+		keys[j] = x;
+		sketch_update64(s, x, j+1);
+	}
+
+	sketch_points64(s, keys, est, 40);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_geq(est[j], j+1, 
+				"Estimate of %"PRIu32" should not be below its count", j);
+		cr_expect_eq(est[j], sketch_point64(s, keys[j]), 
+				"Batched estimate should equal point estimate");
+	}
+
+	cr_expect_eq(sketch_point64(s, 0x5EED), 1, "Key 0x5EED was seen once");
+
+	sketch_destroy(s);
+}
+
+Test(count_min_sketch, point_sum, .disabled=0) {
+	count_min_t *s[2];
+	count_min_t *c = count_min_create(&multiplyShift, 4, 0.25, 0.2);
+
+	s[0] = count_min_copy_seeds(c);
+	s[1] = count_min_copy_seeds(c);
+
+	for (uint32_t j = 0; j < 40; j++) {
+		count_min_update(s[0], j*7919, j);
+		count_min_update(s[1], j*7919, j+1);
+		count_min_update(c, j*7919, 2*j+1);
+	}
+
+	// The sketch of the sum, by linearity
+	for (uint32_t j = 0; j < 40; j++) {
+		cr_expect_eq(count_min_point_sum(s, 2, j*7919), 
+				count_min_point(c, j*7919), 
+				"Sum should estimate as the sketch of the sum");
+	}
+
+	count_min_clear(c);
+	cr_expect_eq(count_min_point(c, 7919), 0, "Cleared sketch is empty");
+
+	count_min_destroy(s[0]);
+	count_min_destroy(s[1]);
+	count_min_destroy(c);
+}
+
 Test(count_min_sketch, should_allocate_internals, .disabled=0) {
 	sketch_t *s     = sketch_create(&countMin, &carterWegman, 2, 0.5, 0.2);
 	count_min_t *cm = s->sketch;
@@ -0,0 +1,56 @@
+#include <criterion/criterion.h>
+
+#include "util/table.h"
+
+Test(table, init_and_destroy, .disabled=0) {
+	table_t *table = table_create(10);
+
+	cr_assert_not_null(table, "Table should not be NULL after creation");
+	cr_assert_eq(table->count, 0, "Table should be empty");
+
+	table_destroy(table);
+}
+
+Test(table, insert_and_find, .disabled=0) {
+	table_t *table = table_create(4);
+
+	cr_assert_null(table_find(table, 0), "Key 0 should not be in the table");
+
+	*table_insert(table, 0)   += 3;
+	*table_insert(table, 42)  += 5;
+	*table_insert(table, 0)   += 4;
+
+	cr_assert_eq(table->count, 2, "Expected %d keys got %d", 2, table->count);
+	cr_assert_eq(*table_find(table, 0), 7, "Expected %d got %"PRId64, 7, 
+			*table_find(table, 0));
+	cr_assert_eq(*table_find(table, 42), 5, "Expected %d got %"PRId64, 5, 
+			*table_find(table, 42));
+	cr_assert_null(table_find(table, 43), "Key 43 should not be in the table");
+
+	table_destroy(table);
+}
+
+Test(table, many_keys, .disabled=0) {
+	uint32_t i;
+	table_t *table = table_create(2);
+
+	for (i = 0; i < 1000; i++) {
+		*table_insert(table, i*7919) = i;
+	}
+
+	cr_assert_eq(table->count, 1000, "Expected %d keys got %d", 1000, 
+			table->count);
+
+	for (i = 0; i < 1000; i++) {
+		cr_assert_not_null(table_find(table, i*7919), "Key %d is missing", i);
+		cr_expect_eq(*table_find(table, i*7919), i, "Expected %d got %"PRId64, 
+				i, *table_find(table, i*7919));
+	}
+
+	table_clear(table);
+
+	cr_assert_eq(table->count, 0, "Table should be empty after clear");
+	cr_assert_null(table_find(table, 7919), "Key should be cleared");
+
+	table_destroy(table);
+}